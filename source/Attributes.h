@@ -3,6 +3,45 @@
 //----------------------------------------------------------------------------
 #pragma once
 
+// Perfect hash table over a fixed list of names, mapping each to its index
+// in the list. Building finds a displacement for each bucket of colliding
+// names so that every name gets a slot of its own (hash and displace), after
+// which a lookup is two hashes and one comparison, without allocating. The
+// names must outlive the table. Case insensitive tables fold ASCII only,
+// like _wcsicmp in the C locale. Repeated names keep their first index.
+class NameHashTable
+{
+public:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    NameHashTable() = default;
+    NameHashTable(array_ref<char16_t const* const> names, bool isCaseSensitive);
+
+    // Returns InvalidIndex if absent.
+    uint32_t Find(array_ref<char16_t const> name) const noexcept;
+    uint32_t Find(_In_z_ char16_t const* name) const noexcept;
+
+    uint32_t GetNameCount() const noexcept; // Count of the list built from, including any null or repeated names.
+
+private:
+    struct Slot
+    {
+        char16_t const* name;
+        uint32_t length;
+        uint32_t index; // Into the list, or InvalidIndex if empty.
+    };
+
+    uint32_t GetHash(array_ref<char16_t const> name, uint32_t seed) const noexcept;
+    bool IsEqualName(Slot const& slot, array_ref<char16_t const> name) const noexcept;
+
+    std::vector<int32_t> displacements_; // Per bucket: hash seed of its names (>0), ~slot of a lone name (<0), or 0 if empty.
+    std::vector<Slot> slots_;
+    uint32_t slotMask_ = 0;
+    uint32_t nameCount_ = 0;
+    bool isCaseSensitive_ = true;
+};
+
+
 // Definition of attribute, including the type, name, and default values.
 // The current value is stored separately.
 struct Attribute
@@ -84,6 +123,8 @@ struct Attribute
 
         char16_t const* GetName() const;
 
+        // Searches the list linearly, so it may be a temporary (unlike
+        // Attribute::MapNameToValue, which hashes static lists).
         static HRESULT MapNameToValue(
             array_ref<Attribute::PredefinedValue const> values,
             _In_z_ char16_t const* stringValue,
@@ -169,7 +210,20 @@ struct Attribute
     // Empty string is okay for this function because it returns an empty vector with S_OK.
     HRESULT ParseString(_In_z_ char16_t const* stringValue, _Inout_ std::vector<uint8_t>& data) const;
 
-    // Map a named identifier to a value or vice versa.
+    // Whether this is an array of plain numbers (not tags, enums, or colors),
+    // which ParseNumericArray decodes in bulk.
+    bool IsTypeNumericArray() const noexcept;
+
+    // Count the elements of an array string, separated by spaces or commas.
+    static uint32_t CountArrayElements(array_ref<char16_t const> stringValue) noexcept;
+
+    // Decode a numeric array directly into data sized for CountArrayElements
+    // elements of the type. The string must be followed by a nul.
+    HRESULT ParseNumericArray(array_ref<char16_t const> stringValue, array_ref<uint8_t> data) const;
+
+    // Map a named identifier to a value or vice versa. Names are found in
+    // a hash table built on first use for each predefined value list, which
+    // is cached by the list's address, as the lists are static.
     HRESULT MapNameToValue(_In_z_ char16_t const* stringValue, _Out_ uint32_t& enumValue) const;
     HRESULT MapValueToName(_Out_ uint32_t enumValue, _Out_ std::u16string& stringValue) const;
     HRESULT ParseEnum(_In_z_ char16_t const* stringValue, _Out_ uint32_t& enumValue) const;
@@ -193,22 +247,77 @@ DEFINE_ENUM_FLAG_OPERATORS(Attribute::GetPredefinedValueFlags);
 
 
 // Each attribute value has a string representation and a cached binary form.
-// Note the dataArray is empty if the data has a single element, small
-// enough to just fit in the variant.
+// Single elements are held in the variant. Arrays are held after the string
+// in the same storage, which is inline for short values (most numbers and
+// names) and otherwise one heap block. Heap blocks are immutable once
+// written and shared by copies of the value (copy-on-write), so copying a
+// value never allocates, and objects copied from one shared object hold its
+// long texts and glyph arrays once until they are set. String arrays are not
+// duplicated, since the string already is their data.
 struct AttributeValue
 {
     Attribute::Variant data; // Room for one element, which is the common case.
-    std::vector<uint8_t> dataArray; // Variable length data in case the fixed size variant is too small.
-    std::u16string stringValue; // string representation, typed by user or read from data file.
-    uint32_t cookieValue = 0; // useful to compare for value changes, incremented each time data is changed.
 
-    array_ref<uint8_t> Get(); // Get the data.
+    array_ref<uint8_t const> Get() const; // Get the data.
+
+    // The string representation, typed by user or read from data file.
+    // It is always nul-terminated. Like Get, the data may be shared with
+    // copies of the value, so it must only be changed through Set.
+    array_ref<char16_t const> GetString() const noexcept;
+
+    // Setting the string the value already has keeps its storage (which may
+    // be shared) and parsed data.
     HRESULT Set(Attribute const& attribute, _In_z_ char16_t const* newStringValue);
 
-    AttributeValue()
+    // Same as above, but reusing values the caller already decoded from the
+    // string (such as TextTree::NodeNumber), skipping parsing when they are
+    // exactly what parsing would yield. Either may be null.
+    HRESULT Set(
+        Attribute const& attribute,
+        _In_z_ char16_t const* newStringValue,
+        _In_opt_ uint32_t const* decodedInteger,
+        _In_opt_ float const* decodedFloat
+        );
+
+    AttributeValue() noexcept;
+    AttributeValue(AttributeValue const& other);
+    AttributeValue(AttributeValue&& other) noexcept;
+    AttributeValue& operator=(AttributeValue const& other);
+    AttributeValue& operator=(AttributeValue&& other) noexcept;
+    ~AttributeValue();
+
+private:
+    static constexpr uint32_t InlineStorageSize = 32;
+
+    // Heap storage block, freed when the last value referring to it is. The
+    // capacity bytes follow the header, which is padded so they are aligned
+    // like the inline storage.
+    struct alignas(8) SharedStorage
     {
-        data.type = Attribute::TypeNone;
-    }
+        std::atomic<uint32_t> referenceCount;
+        uint32_t capacity;
+
+        uint8_t* GetBytes() noexcept { return reinterpret_cast<uint8_t*>(this + 1); }
+        uint8_t const* GetBytes() const noexcept { return reinterpret_cast<uint8_t const*>(this + 1); }
+    };
+
+    static uint32_t GetArrayOffset(uint32_t stringLength) noexcept; // Past the string's nul, aligned for any element type.
+    uint8_t* GetStorage() noexcept;
+    uint8_t const* GetStorage() const noexcept;
+
+    // Replaces the storage contents with the string, returning where the
+    // array bytes go for the caller to fill. The string may be the current one.
+    uint8_t* SetStorage(array_ref<char16_t const> stringValue, uint32_t arrayByteCount);
+    void FreeStorage() noexcept;
+
+    uint32_t stringLength_ = 0;
+    uint32_t arrayByteCount_ = 0;
+    bool isSharedStorage_ = false; // Otherwise inline.
+    union
+    {
+        alignas(8) uint8_t inlineStorage_[InlineStorageSize];
+        SharedStorage* sharedStorage_;
+    };
 };
 
 
@@ -224,19 +333,11 @@ struct IAttributeSource
 public:
     // Client implemented. The other two GetString functions are conveniences that just
     // forward to this implementation.
-    virtual HRESULT GetString(uint32_t id, _Out_ array_ref<char16_t>& value) = 0;
+    virtual HRESULT GetString(uint32_t id, _Out_ array_ref<char16_t const>& value) = 0;
 
     // Client implemented. Callers generally use the more convenient helper methods,
     // since the actual implementation just returns raw byte data.
-    virtual HRESULT GetValueData(uint32_t id, _Out_ Attribute::Type& type, _Out_ array_ref<uint8_t>& value) = 0;
-
-    // Retrieve the last update for this attribute, enabling a caller to
-    // cache results for expensive operations. It's okay to update the
-    // cookie value even if the same value was set for an attribute (it just
-    // means the client will lose caching), but the cookieValue must be
-    // updated each time that attribute is changed (incrementing is
-    // simple enough).
-    virtual HRESULT GetCookie(uint32_t id, _Out_ uint32_t& cookieValue) = 0;
+    virtual HRESULT GetValueData(uint32_t id, _Out_ Attribute::Type& type, _Out_ array_ref<uint8_t const>& value) = 0;
 
     ////////////////////////////////////////
     // String form getters.
@@ -247,7 +348,7 @@ public:
 
     // Get a lightweight reference to the indexed string.
     // On error, it returns empty string.
-    array_ref<char16_t> GetString(uint32_t id);
+    array_ref<char16_t const> GetString(uint32_t id);
 
     // Return copy of the string rather than view.
     HRESULT GetString(uint32_t id, _Out_ std::u16string& s);
@@ -268,7 +369,7 @@ public:
     {
         Attribute::Type actualType;
         Attribute::Type desiredType = Attribute::TypeMap<T>::type;
-        array_ref<uint8_t> byteValues;
+        array_ref<uint8_t const> byteValues;
 
         if (FAILED(GetValueData(id, OUT actualType, OUT byteValues)) || byteValues.size() < sizeof(T))
         // todo::: restore once you figure out enums! || !Attribute::AreCompatibleTypes(desiredType, actualType))
@@ -276,7 +377,7 @@ public:
             // Return default value on error ERROR_UNMAPPED_SUBSTITUTION_STRING.
             return defaultValue;
         }
-        return *reinterpret_cast<T*>(byteValues.data());
+        return *reinterpret_cast<T const*>(byteValues.data());
     }
 
     // Returns optional value. The value will be initialized if present, else empty.
@@ -284,13 +385,13 @@ public:
     optional_value<T> GetOptionalValue(uint32_t id)
     {
         Attribute::Type actualType;
-        array_ref<uint8_t> byteValues;
+        array_ref<uint8_t const> byteValues;
         optional_value<T> value;
         if (FAILED(GetValueData(id, OUT actualType, OUT byteValues)) || byteValues.size() < sizeof(T))
         {
             return value;
         }
-        T& t = *reinterpret_cast<T*>(byteValues.data());
+        T const& t = *reinterpret_cast<T const*>(byteValues.data());
         value.emplace(t);
         return value;
     }
@@ -300,7 +401,7 @@ public:
     bool HasValue(uint32_t id)
     {
         Attribute::Type actualType;
-        array_ref<uint8_t> byteValues;
+        array_ref<uint8_t const> byteValues;
         if (FAILED(GetValueData(id, OUT actualType, OUT byteValues)) || byteValues.size() < sizeof(T))
         {
             return false;
@@ -312,11 +413,11 @@ public:
     // If the actual type is incompatible with the desired type, it returns
     // an empty array and HRESULT for ERROR_UNMAPPED_SUBSTITUTION_STRING.
     template <typename T>
-    HRESULT GetValues(uint32_t id, _Out_ array_ref<T>& values)
+    HRESULT GetValues(uint32_t id, _Out_ array_ref<T const>& values)
     {
         Attribute::Type actualType;
         Attribute::Type desiredType = Attribute::TypeMap<T>::type;
-        array_ref<uint8_t> byteValues;
+        array_ref<uint8_t const> byteValues;
 
         IFR(GetValueData(id, OUT actualType, OUT byteValues));
         // // todo::: restore once you figure out enums! || !Attribute::AreCompatibleTypes(desiredType, actualType))
@@ -324,7 +425,7 @@ public:
         //{
         //    return HRESULT_FROM_WIN32(ERROR_UNMAPPED_SUBSTITUTION_STRING);
         //}
-        auto a = byteValues.reinterpret_as<T>();
+        auto a = byteValues.reinterpret_as<T const>();
         values.reset(a);
         return S_OK;
     }
@@ -333,16 +434,16 @@ public:
     // If the actual type is incompatible with the desired type, it returns
     // an empty array.
     template <typename T>
-    array_ref<T> GetValues(uint32_t id)
+    array_ref<T const> GetValues(uint32_t id)
     {
         Attribute::Type actualType;
         Attribute::Type desiredType = Attribute::TypeMap<T>::type;
-        array_ref<uint8_t> byteValues;
-        array_ref<T> values;
+        array_ref<uint8_t const> byteValues;
+        array_ref<T const> values;
 
         if (SUCCEEDED(GetValueData(id, OUT actualType, OUT byteValues)))
         {
-            auto a = byteValues.reinterpret_as<T>();
+            auto a = byteValues.reinterpret_as<T const>();
             values.reset(a);
         }
         // // todo::: restore once you figure out enums! || !Attribute::AreCompatibleTypes(desiredType, actualType))
@@ -352,20 +453,4 @@ public:
         //}
         return values;
     }
-
-    ////////////////////////////////////////
-    // Cookie functions for value modification awareness.
-
-    // Returns true if the setting has been modified, updating the caller's
-    // cookie value to the current one.
-    bool IsCookieSame(uint32_t id, _Inout_ uint32_t& previousCookieValue)
-    {
-        uint32_t cookieValue = 0;
-        GetCookie(id, OUT cookieValue);
-        if (cookieValue == previousCookieValue)
-            return true;
-
-        previousCookieValue = cookieValue;
-        return false;
-    }
 };
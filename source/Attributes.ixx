@@ -26,9 +26,161 @@
     #include "Attributes.h"
 #endif
 
+////////////////////////////////////////
+
+NameHashTable::NameHashTable(array_ref<char16_t const* const> names, bool isCaseSensitive)
+:   nameCount_(static_cast<uint32_t>(names.size())),
+    isCaseSensitive_(isCaseSensitive)
+{
+    // Keep the slots at most half full, so that displacements for the
+    // buckets of colliding names are quickly found.
+    const uint32_t slotCount = std::bit_ceil(std::max(nameCount_ * 2, 1u));
+    slotMask_ = slotCount - 1;
+    displacements_.assign(slotCount, 0);
+    slots_.assign(slotCount, Slot{nullptr, 0, InvalidIndex});
+
+    // Group the names into buckets by their unseeded hash, skipping repeats.
+    std::vector<std::vector<Slot>> buckets(slotCount);
+    for (uint32_t i = 0; i < nameCount_; ++i)
+    {
+        if (names[i] == nullptr)
+            continue;
+
+        array_ref<char16_t const> name(names[i], std::char_traits<char16_t>::length(names[i]));
+        auto& bucket = buckets[GetHash(name, 0) & slotMask_];
+        if (std::none_of(bucket.begin(), bucket.end(), [&](Slot const& slot) { return IsEqualName(slot, name); }))
+        {
+            bucket.push_back(Slot{name.data(), static_cast<uint32_t>(name.size()), i});
+        }
+    }
+
+    // Place the largest buckets first while the most slots are free,
+    // trying successive seeds until all of a bucket's names land in free
+    // and distinct slots.
+    std::vector<uint32_t> bucketOrder(slotCount);
+    std::iota(bucketOrder.begin(), bucketOrder.end(), 0u);
+    std::stable_sort(
+        bucketOrder.begin(),
+        bucketOrder.end(),
+        [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); }
+        );
+
+    std::vector<uint32_t> bucketSlots;
+    uint32_t freeSlotIndex = 0;
+    for (uint32_t bucketIndex : bucketOrder)
+    {
+        auto const& bucket = buckets[bucketIndex];
+        if (bucket.empty())
+            break;
+
+        if (bucket.size() == 1)
+        {
+            // Lone names need no hash. Just take the next free slot.
+            while (slots_[freeSlotIndex].index != InvalidIndex)
+                ++freeSlotIndex;
+            slots_[freeSlotIndex] = bucket.front();
+            displacements_[bucketIndex] = ~int32_t(freeSlotIndex);
+            continue;
+        }
+
+        for (uint32_t seed = 1; ; ++seed)
+        {
+            bucketSlots.clear();
+            for (Slot const& slot : bucket)
+            {
+                uint32_t slotIndex = GetHash({slot.name, slot.length}, seed) & slotMask_;
+                if (slots_[slotIndex].index != InvalidIndex
+                ||  std::find(bucketSlots.begin(), bucketSlots.end(), slotIndex) != bucketSlots.end())
+                {
+                    break;
+                }
+                bucketSlots.push_back(slotIndex);
+            }
+            if (bucketSlots.size() == bucket.size())
+            {
+                for (size_t i = 0; i < bucket.size(); ++i)
+                {
+                    slots_[bucketSlots[i]] = bucket[i];
+                }
+                displacements_[bucketIndex] = int32_t(seed);
+                break;
+            }
+        }
+    }
+}
+
+
+uint32_t NameHashTable::Find(array_ref<char16_t const> name) const noexcept
+{
+    if (slots_.empty())
+        return InvalidIndex;
+
+    int32_t displacement = displacements_[GetHash(name, 0) & slotMask_];
+    if (displacement == 0)
+        return InvalidIndex; // Empty bucket.
+
+    uint32_t slotIndex = (displacement < 0)
+                       ? uint32_t(~displacement)
+                       : GetHash(name, uint32_t(displacement)) & slotMask_;
+    Slot const& slot = slots_[slotIndex];
+    return (slot.index != InvalidIndex && IsEqualName(slot, name)) ? slot.index : InvalidIndex;
+}
+
+
+uint32_t NameHashTable::Find(_In_z_ char16_t const* name) const noexcept
+{
+    return Find({name, std::char_traits<char16_t>::length(name)});
+}
+
+
+uint32_t NameHashTable::GetNameCount() const noexcept
+{
+    return nameCount_;
+}
+
+
+uint32_t NameHashTable::GetHash(array_ref<char16_t const> name, uint32_t seed) const noexcept
+{
+    // FNV-1a, varied by the seed, with a final mix so that every bit of the
+    // masked hash depends on the seed.
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char16_t ch : name)
+    {
+        if (!isCaseSensitive_ && ch >= 'A' && ch <= 'Z')
+            ch += 'a' - 'A';
+        hash = (hash ^ ch) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+
+bool NameHashTable::IsEqualName(Slot const& slot, array_ref<char16_t const> name) const noexcept
+{
+    if (slot.length != name.size())
+        return false;
+
+    for (uint32_t i = 0; i < slot.length; ++i)
+    {
+        char16_t a = slot.name[i], b = name[i];
+        if (!isCaseSensitive_)
+        {
+            if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+            if (b >= 'A' && b <= 'Z') b += 'a' - 'A';
+        }
+        if (a != b)
+            return false;
+    }
+    return true;
+}
+
+
 ////////////////////////////////////////
 
 char16_t const* Attribute::PredefinedValue::GetName() const
+
 {
     return name != nullptr ? name : u"";
 }
@@ -75,6 +227,193 @@ char16_t const* Attribute::GetPredefinedValue(uint32_t valueIndex, GetPredefined
 }
 
 
+// Numeric arrays (glyph ids, advances, offsets, axis values) can hold tens of
+// thousands of elements, so they are decoded in bulk straight into typed
+// storage rather than one Variant at a time through wcstoul/wcstof, using the
+// same locale-free decimal decoding as the text tree parser.
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define ATTRIBUTES_USE_SSE2 1
+#endif
+
+namespace
+{
+    inline bool IsArraySeparator(char16_t ch)
+    {
+        return ch == ' ' || ch == ',' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+
+#if ATTRIBUTES_USE_SSE2
+    using Vector128 = __m128i;
+
+    // Returns a byte mask with two bits set per separator code unit.
+    inline uint32_t GetArraySeparatorMask(Vector128 v)
+    {
+        Vector128 isSeparator = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16(' ')), _mm_cmpeq_epi16(v, _mm_set1_epi16(','))),
+            _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('\t')), _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('\r')), _mm_cmpeq_epi16(v, _mm_set1_epi16('\n'))))
+            );
+        return uint32_t(_mm_movemask_epi8(isSeparator));
+    }
+#endif
+
+    char16_t const* SkipArraySeparators(char16_t const* text, char16_t const* textEnd)
+    {
+        for (; text < textEnd && IsArraySeparator(*text); ++text)
+        { }
+        return text;
+    }
+
+    char16_t const* SkipArrayElement(char16_t const* text, char16_t const* textEnd)
+    {
+        for (; text < textEnd && !IsArraySeparator(*text); ++text)
+        { }
+        return text;
+    }
+
+    // Decodes each element into the typed array. Characters trailing a number
+    // within the same element (like a unit) are ignored, same as the single
+    // value parsing.
+    template <typename T>
+    HRESULT DecodeNumericArray(
+        char16_t const* text,
+        char16_t const* textEnd,
+        _Out_writes_(elementCount) T* elements,
+        uint32_t elementCount
+        )
+    {
+        for (uint32_t i = 0; i < elementCount; ++i)
+        {
+            text = SkipArraySeparators(text, textEnd);
+            char16_t const* numberEnd;
+
+            if constexpr (std::is_same_v<T, float>)
+            {
+                numberEnd = DecodeDecimalFloat(text, textEnd, OUT elements[i]);
+                if (numberEnd == nullptr)
+                {
+                    // Not exactly decodable, so parse it the general way.
+                    char16_t* parsedEnd = const_cast<char16_t*>(text);
+                    elements[i] = std::wcstof(ToWChar(text), OUT ToWChar(&parsedEnd));
+                    numberEnd = (parsedEnd > text) ? parsedEnd : nullptr;
+                }
+            }
+            else
+            {
+                uint32_t integerValue;
+                numberEnd = DecodeDecimalInteger(text, textEnd, OUT integerValue);
+                if (numberEnd == nullptr)
+                {
+                    // Not exactly decodable, so parse it the general way too.
+                    char16_t* parsedEnd = const_cast<char16_t*>(text);
+                    integerValue = std::wcstoul(ToWChar(text), OUT ToWChar(&parsedEnd), 10);
+                    numberEnd = (parsedEnd > text) ? parsedEnd : nullptr;
+                }
+                elements[i] = static_cast<T>(integerValue); // Truncate to the type size, same as copying the low bytes.
+            }
+
+            if (numberEnd == nullptr)
+            {
+                // Leave the remainder zeroed rather than uninitialized.
+                std::fill(elements + i, elements + elementCount, T{});
+                return HRESULT_FROM_WIN32(ERROR_UNMAPPED_SUBSTITUTION_STRING);
+            }
+            text = SkipArrayElement(numberEnd, textEnd);
+        }
+        return S_OK;
+    }
+}
+
+
+bool Attribute::IsTypeNumericArray() const noexcept
+{
+    if (!IsTypeArray())
+        return false;
+
+    switch (GetBaseType(this->type))
+    {
+    case TypeFloat32:
+        return true;
+
+    case TypeInteger8:
+    case TypeUInteger8:
+    case TypeInteger16:
+    case TypeUInteger16:
+    case TypeInteger32:
+    case TypeUInteger32:
+        // Same exclusions as parsing a single value.
+        return this->semantic != SemanticEnum
+            && this->semantic != SemanticEnumExclusive
+            && this->semantic != SemanticColor
+            && this->semantic != SemanticCharacterTags;
+
+    default:
+        return false;
+    }
+}
+
+
+uint32_t Attribute::CountArrayElements(array_ref<char16_t const> stringValue) noexcept
+{
+    // An element begins wherever anything other than a separator follows a
+    // separator or the start.
+    char16_t const* text = stringValue.data();
+    size_t const textLength = stringValue.size();
+    size_t textIndex = 0;
+    uint32_t elementCount = 0;
+    bool isPreviousSeparator = true;
+
+#if ATTRIBUTES_USE_SSE2
+    for (; textIndex + 8 <= textLength; textIndex += 8)
+    {
+        uint32_t separatorMask = GetArraySeparatorMask(_mm_loadu_si128(reinterpret_cast<Vector128 const*>(text + textIndex))) & 0x5555;
+        uint32_t previousSeparatorMask = (separatorMask << 2) | uint32_t(isPreviousSeparator);
+        elementCount += std::popcount(~separatorMask & previousSeparatorMask & 0x5555);
+        isPreviousSeparator = (separatorMask >> 14) & 1;
+    }
+#endif
+
+    for (; textIndex < textLength; ++textIndex)
+    {
+        bool isSeparator = IsArraySeparator(text[textIndex]);
+        elementCount += (!isSeparator && isPreviousSeparator);
+        isPreviousSeparator = isSeparator;
+    }
+
+    return elementCount;
+}
+
+
+HRESULT Attribute::ParseNumericArray(array_ref<char16_t const> stringValue, array_ref<uint8_t> data) const
+{
+    assert(IsTypeNumericArray());
+    assert(stringValue.data()[stringValue.size()] == '\0');
+
+    char16_t const* text = stringValue.data();
+    char16_t const* textEnd = text + stringValue.size();
+    uint32_t const elementCount = static_cast<uint32_t>(data.size() / GetTypeSizeof());
+
+    switch (GetTypeSizeof())
+    {
+    case sizeof(uint8_t):
+        return DecodeNumericArray(text, textEnd, reinterpret_cast<uint8_t*>(data.data()), elementCount);
+
+    case sizeof(uint16_t):
+        return DecodeNumericArray(text, textEnd, reinterpret_cast<uint16_t*>(data.data()), elementCount);
+
+    case sizeof(uint32_t):
+        if (GetBaseType(this->type) == TypeFloat32)
+            return DecodeNumericArray(text, textEnd, reinterpret_cast<float*>(data.data()), elementCount);
+        else
+            return DecodeNumericArray(text, textEnd, reinterpret_cast<uint32_t*>(data.data()), elementCount);
+
+    default:
+        assert(false);
+        return E_UNEXPECTED;
+    }
+}
+
+
 HRESULT Attribute::ParseString(
     _In_z_ char16_t const* stringValue,
     _Inout_ std::vector<uint8_t>& data
@@ -82,7 +421,14 @@ HRESULT Attribute::ParseString(
 {
     data.clear();
 
-    if (IsTypeParsable(this->type))
+    if (IsTypeNumericArray())
+    {
+        // Size the data once for all the elements, and decode them in bulk.
+        array_ref<char16_t const> stringRange(stringValue, wcslen(ToWChar(stringValue)));
+        data.resize(CountArrayElements(stringRange) * GetTypeSizeof());
+        IFR(ParseNumericArray(stringRange, data));
+    }
+    else if (IsTypeParsable(this->type))
     {
         // Read each element from string, parsing into data types.
 
@@ -284,9 +630,56 @@ HRESULT Attribute::PredefinedValue::MapNameToValue(
 }
 
 
+namespace
+{
+    // Predefined value lists with fewer names are just searched linearly.
+    const uint32_t MinimumHashedPredefinedValueCount = 8;
+
+    // Returns the name table of a static predefined value list, building it
+    // on first use. Tables are never removed, so references stay valid.
+    NameHashTable const& GetPredefinedValueNameTable(array_ref<Attribute::PredefinedValue const> values)
+    {
+        static std::shared_mutex mutex;
+        static std::unordered_map<Attribute::PredefinedValue const*, NameHashTable> tables;
+
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto match = tables.find(values.data());
+            if (match != tables.end())
+                return match->second;
+        }
+
+        std::vector<char16_t const*> names;
+        names.reserve(values.size());
+        for (auto const& predefinedValue : values)
+        {
+            names.push_back(predefinedValue.name);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return tables.try_emplace(values.data(), names, /*isCaseSensitive*/false).first->second;
+    }
+}
+
+
 HRESULT Attribute::MapNameToValue(_In_z_ char16_t const* stringValue, _Out_ uint32_t& value) const
 {
-    return PredefinedValue::MapNameToValue(this->predefinedValues, stringValue, OUT value);
+    if (this->predefinedValues.size() < MinimumHashedPredefinedValueCount)
+        return PredefinedValue::MapNameToValue(this->predefinedValues, stringValue, OUT value);
+
+    value = 0;
+
+    // A list at the same address with a different count cannot be static, so search it normally.
+    NameHashTable const& nameTable = GetPredefinedValueNameTable(this->predefinedValues);
+    if (nameTable.GetNameCount() != this->predefinedValues.size())
+        return PredefinedValue::MapNameToValue(this->predefinedValues, stringValue, OUT value);
+
+    uint32_t valueIndex = nameTable.Find(stringValue);
+    if (valueIndex == NameHashTable::InvalidIndex)
+        return HRESULT_FROM_WIN32(ERROR_UNMAPPED_SUBSTITUTION_STRING);
+
+    value = this->predefinedValues[valueIndex].integerValue;
+    return S_OK;
 }
 
 
@@ -639,12 +1032,173 @@ HRESULT Attribute::GetPredefinedValueIndices(
 }
 
 
-HRESULT AttributeValue::Set(Attribute const& attribute, _In_z_ char16_t const* newStringValue)
+AttributeValue::AttributeValue() noexcept
 {
-    // Increment the cookie value so that callers can know when the value is
-    // different lest they cached results.
-    ++this->cookieValue;
+    data.type = Attribute::TypeNone;
+    inlineStorage_[0] = 0; // Empty nul-terminated string.
+    inlineStorage_[1] = 0;
+}
 
+
+AttributeValue::AttributeValue(AttributeValue const& other)
+:   AttributeValue()
+{
+    *this = other;
+}
+
+
+AttributeValue::AttributeValue(AttributeValue&& other) noexcept
+:   AttributeValue()
+{
+    *this = std::move(other);
+}
+
+
+AttributeValue& AttributeValue::operator=(AttributeValue const& other)
+{
+    if (&other != this)
+    {
+        if (other.isSharedStorage_)
+        {
+            // Share the other's immutable block rather than copying it.
+            ++other.sharedStorage_->referenceCount;
+            FreeStorage();
+            sharedStorage_ = other.sharedStorage_;
+            isSharedStorage_ = true;
+        }
+        else
+        {
+            FreeStorage();
+            memcpy(inlineStorage_, other.inlineStorage_, sizeof(inlineStorage_));
+        }
+        stringLength_ = other.stringLength_;
+        arrayByteCount_ = other.arrayByteCount_;
+        data = other.data;
+    }
+    return *this;
+}
+
+
+AttributeValue& AttributeValue::operator=(AttributeValue&& other) noexcept
+{
+    if (&other != this)
+    {
+        FreeStorage();
+        data = other.data;
+        stringLength_ = other.stringLength_;
+        arrayByteCount_ = other.arrayByteCount_;
+        isSharedStorage_ = other.isSharedStorage_;
+        memcpy(inlineStorage_, other.inlineStorage_, sizeof(inlineStorage_)); // Either the inline data or the block pointer.
+
+        // Leave the other empty, without its block.
+        other.isSharedStorage_ = false;
+        other.FreeStorage();
+    }
+    return *this;
+}
+
+
+AttributeValue::~AttributeValue()
+{
+    FreeStorage();
+}
+
+
+uint32_t AttributeValue::GetArrayOffset(uint32_t stringLength) noexcept
+{
+    return ((stringLength + 1) * sizeof(char16_t) + 3) & ~3u;
+}
+
+
+uint8_t* AttributeValue::GetStorage() noexcept
+{
+    return isSharedStorage_ ? sharedStorage_->GetBytes() : inlineStorage_;
+}
+
+
+uint8_t const* AttributeValue::GetStorage() const noexcept
+{
+    return isSharedStorage_ ? sharedStorage_->GetBytes() : inlineStorage_;
+}
+
+
+uint8_t* AttributeValue::SetStorage(array_ref<char16_t const> stringValue, uint32_t arrayByteCount)
+{
+    uint32_t const stringLength = static_cast<uint32_t>(stringValue.size());
+    uint32_t const arrayOffset = GetArrayOffset(stringLength);
+    uint32_t const byteCount = arrayOffset + arrayByteCount;
+
+    // Reuse the current block only if no copy shares it and it is large
+    // enough, preferring the inline storage when the value fits. The string
+    // may come from the current storage, so the old block is released only
+    // after copying.
+    SharedStorage* oldSharedStorage = isSharedStorage_ ? sharedStorage_ : nullptr;
+    SharedStorage* newSharedStorage = nullptr;
+    if (byteCount > InlineStorageSize)
+    {
+        if (oldSharedStorage != nullptr
+        &&  oldSharedStorage->referenceCount.load(std::memory_order_acquire) == 1
+        &&  oldSharedStorage->capacity >= byteCount)
+        {
+            std::swap(newSharedStorage, oldSharedStorage); // Keep it.
+        }
+        else
+        {
+            void* memory = ::operator new(sizeof(SharedStorage) + byteCount);
+            newSharedStorage = new(memory) SharedStorage{};
+            newSharedStorage->referenceCount = 1;
+            newSharedStorage->capacity = byteCount;
+        }
+    }
+    uint8_t* storage = (newSharedStorage != nullptr) ? newSharedStorage->GetBytes() : inlineStorage_;
+
+    memmove(storage, stringValue.data(), stringLength * sizeof(char16_t));
+    reinterpret_cast<char16_t*>(storage)[stringLength] = '\0';
+
+    // The union may hold new inline data now, so release the old block directly.
+    if (oldSharedStorage != nullptr && --oldSharedStorage->referenceCount == 0)
+    {
+        oldSharedStorage->~SharedStorage();
+        ::operator delete(oldSharedStorage);
+    }
+    if (newSharedStorage != nullptr)
+    {
+        sharedStorage_ = newSharedStorage;
+    }
+    isSharedStorage_ = (newSharedStorage != nullptr);
+    stringLength_ = stringLength;
+    arrayByteCount_ = arrayByteCount;
+
+    return storage + arrayOffset;
+}
+
+
+void AttributeValue::FreeStorage() noexcept
+{
+    if (isSharedStorage_)
+    {
+        if (--sharedStorage_->referenceCount == 0)
+        {
+            sharedStorage_->~SharedStorage();
+            ::operator delete(sharedStorage_);
+        }
+        isSharedStorage_ = false;
+    }
+    stringLength_ = 0;
+    arrayByteCount_ = 0;
+    inlineStorage_[0] = 0;
+    inlineStorage_[1] = 0;
+}
+
+
+array_ref<char16_t const> AttributeValue::GetString() const noexcept
+{
+    return {reinterpret_cast<char16_t const*>(GetStorage()), stringLength_};
+}
+
+
+HRESULT AttributeValue::Set(Attribute const& attribute, _In_z_ char16_t const* newStringValue)
+{
     size_t stringLength = wcslen(ToWChar(newStringValue));
 
     // Handle any special cases here.
@@ -664,19 +1218,54 @@ HRESULT AttributeValue::Set(Attribute const& attribute, _In_z_ char16_t const* n
         break;
     }
 
-    this->stringValue.assign(newStringValue, stringLength);
+    array_ref<char16_t const> stringValue(newStringValue, stringLength);
+
+    // The same string parses the same, so keep the storage (which may be
+    // shared with copies) unless it had failed to parse.
+    if (this->data.type == attribute.type && GetString() == stringValue)
+        return S_OK;
 
     HRESULT hr;
-    if (attribute.IsTypeArray())
+    if (attribute.IsTypeArray() && Attribute::GetBaseType(attribute.type) == Attribute::TypeCharacter16)
+    {
+        // The string is the data already.
+        SetStorage(stringValue, 0);
+        hr = S_OK;
+    }
+    else if (attribute.IsTypeNumericArray())
     {
-        // If array type, initialize the variable length data.
-        hr = attribute.ParseString(this->stringValue.c_str(), OUT this->dataArray);
+        // Count the elements first, and then decode them straight into the
+        // array bytes after the string, reading the stored copy of the string
+        // since it is nul-terminated.
+        uint32_t arrayByteCount = Attribute::CountArrayElements(stringValue) * static_cast<uint32_t>(attribute.GetTypeSizeof());
+        uint8_t* arrayData = SetStorage(stringValue, arrayByteCount);
+        hr = attribute.ParseNumericArray(GetString(), {arrayData, arrayByteCount});
+    }
+    else if (attribute.IsTypeArray())
+    {
+        // Other array types (like tags) are parsed into a separate buffer
+        // first, and then stored after the string in one block.
+        std::u16string terminatedString;
+        char16_t const* parsedString = newStringValue;
+        if (newStringValue[stringLength] != '\0')
+        {
+            terminatedString.assign(newStringValue, stringLength);
+            parsedString = terminatedString.c_str();
+        }
+        std::vector<uint8_t> arrayData;
+        hr = attribute.ParseString(parsedString, OUT arrayData);
+        uint8_t* storedArrayData = SetStorage(stringValue, static_cast<uint32_t>(arrayData.size()));
+        if (!arrayData.empty())
+        {
+            memcpy(storedArrayData, arrayData.data(), arrayData.size());
+        }
     }
     else
     {
         // Otherwise just copy a single value out to the single unit variant.
+        SetStorage(stringValue, 0);
         char16_t const* stringEnd = nullptr;
-        hr = attribute.ParseString(this->stringValue.c_str(), OUT &stringEnd, OUT this->data);
+        hr = attribute.ParseString(GetString().data(), OUT &stringEnd, OUT this->data);
     }
 
     // If successfully parsed, update the type. Otherwise leave as empty.
@@ -686,18 +1275,79 @@ HRESULT AttributeValue::Set(Attribute const& attribute, _In_z_ char16_t const* n
 }
 
 
-array_ref<uint8_t> AttributeValue::Get()
+HRESULT AttributeValue::Set(
+    Attribute const& attribute,
+    _In_z_ char16_t const* newStringValue,
+    _In_opt_ uint32_t const* decodedInteger,
+    _In_opt_ float const* decodedFloat
+    )
+{
+    // Only plain numbers can use the decoded value, since the others map
+    // names, tags, or colors, or need the whole string for an array.
+    static_assert(Attribute::TypeTotal == 13, "Update this switch statement.");
+    if (!attribute.IsTypeArray())
+    {
+        switch (Attribute::GetBaseType(attribute.type))
+        {
+        case Attribute::TypeInteger8:
+        case Attribute::TypeUInteger8:
+        case Attribute::TypeInteger16:
+        case Attribute::TypeUInteger16:
+        case Attribute::TypeInteger32:
+        case Attribute::TypeUInteger32:
+            if (decodedInteger == nullptr)
+                break;
+
+            switch (attribute.semantic)
+            {
+            case Attribute::SemanticEnum:
+            case Attribute::SemanticEnumExclusive:
+            case Attribute::SemanticColor:
+            case Attribute::SemanticCharacterTags:
+                break;
+
+            default:
+                SetStorage({newStringValue, std::char_traits<char16_t>::length(newStringValue)}, 0);
+                this->data.ui32 = *decodedInteger;
+                this->data.type = attribute.type;
+                return S_OK;
+            }
+            break;
+
+        case Attribute::TypeFloat32:
+            if (decodedFloat == nullptr)
+                break;
+
+            SetStorage({newStringValue, std::char_traits<char16_t>::length(newStringValue)}, 0);
+            this->data.f32 = *decodedFloat;
+            this->data.type = attribute.type;
+            return S_OK;
+
+        default:
+            break;
+        }
+    }
+
+    return Set(attribute, newStringValue);
+}
+
+
+array_ref<uint8_t const> AttributeValue::Get() const
 {
     if (Attribute::IsTypeArray(data.type))
     {
-        // Return the array data directly.
-        return dataArray;
+        // Return the array data directly, which for strings is the string itself.
+        uint8_t const* storage = GetStorage();
+        if (Attribute::GetBaseType(data.type) == Attribute::TypeCharacter16)
+            return const_byte_array_ref(storage, stringLength_ * sizeof(char16_t));
+
+        return const_byte_array_ref(storage + GetArrayOffset(stringLength_), arrayByteCount_);
     }
     else
     {
         // Return the single instance field (the data array is not allocated).
         auto byteSize = Attribute::GetTypeSizeof(data.type);
-        return byte_array_ref(&data.buffer[0], &data.buffer[byteSize]);
+        return const_byte_array_ref(&data.buffer[0], &data.buffer[byteSize]);
     }
 }
 
@@ -706,16 +1356,16 @@ array_ref<uint8_t> AttributeValue::Get()
 // a lightweight view into the text.
 HRESULT IAttributeSource::GetString(uint32_t id, _Out_ std::u16string& s)
 {
-    array_ref<char16_t> value;
+    array_ref<char16_t const> value;
     IFR(GetString(id, OUT value));
     s.assign(value.data(), value.size());
     return S_OK;
 }
 
 
-array_ref<char16_t> IAttributeSource::GetString(uint32_t id)
+array_ref<char16_t const> IAttributeSource::GetString(uint32_t id)
 {
-    array_ref<char16_t> value;
+    array_ref<char16_t const> value;
     GetString(id, OUT value); // Ignore errors, returning empty value.
     return value;
 }
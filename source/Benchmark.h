@@ -0,0 +1,57 @@
+//----------------------------------------------------------------------------
+//  History:        2026-10-17 Created
+//  Description:    Throughput benchmarks of the settings parsers and writers,
+//                  over generated settings files.
+//----------------------------------------------------------------------------
+#pragma once
+
+
+// Shape of a generated settings file, to approximate larger real ones.
+struct BenchmarkCorpusOptions
+{
+    uint64_t size = 1024;           // Approximate length in code units, which is also the bytes of the (ASCII) file.
+    uint32_t nestingDepth = 0;      // Levels of nested objects inside each object. INI has no nesting.
+    uint32_t stringLength = 24;     // Length of each object's text.
+    uint32_t escapeDensity = 0;     // Percentage of texts containing an escape sequence (or XML reference).
+    uint32_t commentDensity = 0;    // Percentage of objects preceded by a comment.
+};
+
+// Largest corpus size accepted, in code units. Each corpus is generated in
+// memory, along with the several trees read from it.
+const uint64_t MaximumBenchmarkCorpusSize = 64ull << 20;
+
+// Generates a settings file with objects of the given shape until reaching
+// the size. JSONex and XML have the usual content and objects list, whereas
+// INI has a section per object. The same options give the same text.
+void GenerateBenchmarkCorpus(
+    TextTree::Syntax syntax, // SyntaxJsonex, SyntaxWindowsInitialization, or SyntaxXml.
+    BenchmarkCorpusOptions const& options,
+    OUT std::u16string& text
+    );
+
+// Measures reading, caching, walking, loading, storing, and writing a
+// generated file of each size in each syntax, appending a CSV row per
+// measurement:
+//
+//      syntax,size,operation,count,milliseconds,megabytesPerSecond
+//
+// The count is of the nodes, objects, or bytes produced (cache image bytes,
+// or UTF-8 bytes written to a temporary file), and the throughput is relative
+// to the size of the file. Loading includes updating the drawable objects
+// (creating their layouts). Sizes above MaximumBenchmarkCorpusSize, or any
+// failed stage, fail the whole run.
+HRESULT RunBenchmarks(
+    array_ref<uint64_t const> sizes,
+    BenchmarkCorpusOptions const& options,
+    IN OUT std::u16string& results
+    );
+
+// Runs the benchmarks given by the command line options after "/benchmark",
+// writing the results to a UTF-8 CSV file. Sizes may have K/M/G suffixes, up
+// to 64M. Invalid options set the error message.
+//
+//      sizes=1K,1M,64M depth=2 strings=24 escapes=10 comments=5 out=results.csv
+HRESULT RunBenchmarksFromCommandLine(
+    _In_z_ char16_t const* commandLine,
+    OUT std::u16string& errorMessage
+    );
@@ -0,0 +1,572 @@
+//----------------------------------------------------------------------------
+//  History:        2026-10-17 Created
+//  Description:    Throughput benchmarks of the settings parsers and writers,
+//                  over generated settings files.
+//----------------------------------------------------------------------------
+
+#if USE_CPP_MODULES
+    module;
+#endif
+
+#include "precomp.h"
+
+#if USE_CPP_MODULES
+    export module Benchmark;
+    import Common.AutoResource;
+    import Common.AutoResource.Windows;
+    import Common.ArrayRef;
+    import Common.String;
+    import FileHelpers;
+    import Attributes;
+    import DrawableObject;
+    import DrawableObjectAndValues;
+    import TextTreeParser;
+    export
+    {
+        #include "Benchmark.h"
+    }
+#else
+    #include "Common.AutoResource.h"
+    #include "Common.AutoResource.Windows.h"
+    #include "Common.ArrayRef.h"
+    #include "Common.String.h"
+    #include "Common.OptionalValue.h"
+    #include "FileHelpers.h"
+    #include "Attributes.h"
+    #include "DWritEx.h"
+    #include "DrawingCanvas.h"
+    #include "DrawableObject.h"
+    #include "TextTreeParser.h"
+    #include "DrawableObjectAndValues.h"
+    #include "Benchmark.h"
+#endif
+
+
+////////////////////////////////////////
+
+namespace
+{
+    char16_t const g_sampleText[] = u"The quick brown fox jumps over the lazy dog. ";
+
+
+    // Pseudorandom choices, repeatable so that the same options always
+    // generate the same corpus.
+    class ChoiceGenerator
+    {
+    public:
+        bool Choose(uint32_t percentage) noexcept
+        {
+            state_ = state_ * 1103515245 + 12345;
+            return (state_ >> 16) % 100 < percentage;
+        }
+
+    private:
+        uint32_t state_ = 1;
+    };
+
+
+    // Appends the sample text, starting at a different place for each object,
+    // with an escape sequence in the middle if wanted.
+    void AppendSampleText(
+        uint32_t objectIndex,
+        uint32_t length,
+        _In_opt_z_ char16_t const* escapeSequence,
+        IN OUT std::u16string& text
+        )
+    {
+        const uint32_t sampleTextLength = static_cast<uint32_t>(countof(g_sampleText) - 1);
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            text.push_back(g_sampleText[(objectIndex + i) % sampleTextLength]);
+            if (escapeSequence != nullptr && i == length / 2)
+            {
+                text.append(escapeSequence);
+            }
+        }
+    }
+
+
+    // Returns the time in milliseconds from an arbitrary start.
+    double GetMilliseconds() noexcept
+    {
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return double(counter.QuadPart) * 1000.0 / double(frequency.QuadPart);
+    }
+
+
+    char16_t const* GetSyntaxName(TextTree::Syntax syntax) noexcept
+    {
+        switch (syntax)
+        {
+        case TextTree::SyntaxJsonex:                return u"jsonex";
+        case TextTree::SyntaxWindowsInitialization: return u"ini";
+        case TextTree::SyntaxXml:                   return u"xml";
+        default:                                    return u"unknown";
+        }
+    }
+
+
+    // Reads with the same options as settings files are loaded with.
+    TextTreeParser::Options GetParserOptions(TextTree::Syntax syntax) noexcept
+    {
+        return (syntax == TextTree::SyntaxXml)
+             ? TextTreeParser::Options(TextTreeParser::OptionsDecodeNumbers | TextTreeParser::OptionsDiscardPureWhitespace)
+             : TextTreeParser::OptionsDecodeNumbers;
+    }
+
+
+    std::unique_ptr<TextTreeParser> CreateParser(TextTree::Syntax syntax)
+    {
+        switch (syntax)
+        {
+        case TextTree::SyntaxJsonex:                return std::make_unique<JsonexParser>(nullptr, 0, GetParserOptions(syntax));
+        case TextTree::SyntaxWindowsInitialization: return std::make_unique<IniParser>(nullptr, 0, GetParserOptions(syntax));
+        case TextTree::SyntaxXml:                   return std::make_unique<XmlParser>(nullptr, 0, GetParserOptions(syntax));
+        default:                                    return nullptr;
+        }
+    }
+
+
+    // Returns the list of objects to load: the objects list near the top of
+    // JSONex and XML, or the root itself for INI sections.
+    TextTree::NodePointer FindObjectsNode(TextTree& textTree, TextTree::Syntax syntax)
+    {
+        if (syntax != TextTree::SyntaxWindowsInitialization)
+        {
+            for (uint32_t nodeIndex = 1, nodeCount = textTree.GetNodeCount(); nodeIndex < nodeCount; ++nodeIndex)
+            {
+                auto const& node = textTree.GetNode(nodeIndex);
+                uint32_t textLength;
+                auto text = textTree.GetText(node, OUT textLength);
+                if (node.level <= 2
+                &&  node.GetGenericType() == TextTree::Node::TypeKey
+                &&  std::u16string_view(text, textLength) == u"objects")
+                {
+                    return TextTree::NodePointer(textTree, nodeIndex);
+                }
+            }
+        }
+        return TextTree::NodePointer(textTree, 0);
+    }
+
+
+    // Reads events up to the objects list, for loading from the parser.
+    bool ReadEventsToObjectsNode(TextTreeParser& parser)
+    {
+        TextTreeParser::EventType eventType;
+        TextTree::Node node;
+        array_ref<char16_t const> nodeText;
+        while (parser.ReadEvent(OUT eventType, OUT node, OUT nodeText))
+        {
+            if (eventType == TextTreeParser::EventTypeBeginNode
+            &&  std::u16string_view(nodeText.data(), nodeText.size()) == u"objects")
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    HRESULT BenchmarkCorpus(
+        TextTree::Syntax syntax,
+        std::u16string const& corpusText,
+        IN OUT std::u16string& results
+        )
+    {
+        const double megabytes = double(corpusText.size()) / 1000000.0;
+        auto appendResult = [&](_In_z_ char16_t const* operation, size_t count, double milliseconds)
+        {
+            const double megabytesPerSecond = (milliseconds > 0) ? megabytes * 1000.0 / milliseconds : 0;
+            AppendFormattedString(
+                IN OUT results,
+                u"%s,%llu,%s,%llu,%.3f,%.1f\r\n",
+                GetSyntaxName(syntax),
+                uint64_t(corpusText.size()),
+                operation,
+                uint64_t(count),
+                milliseconds,
+                megabytesPerSecond
+                );
+        };
+
+        // The tree adopts the text, so each read gets a fresh copy (not timed).
+        TextTree textTree;
+        std::unique_ptr<TextTreeParser> parser = CreateParser(syntax);
+        {
+            std::u16string inputText(corpusText);
+            double startTime = GetMilliseconds();
+            parser->ReadNodes(IN OUT textTree, std::move(inputText));
+            appendResult(u"read", textTree.GetNodeCount(), GetMilliseconds() - startTime);
+        }
+
+        if (syntax == TextTree::SyntaxJsonex)
+        {
+            TextTree parallelTextTree;
+            JsonexParser jsonexParser(nullptr, 0, TextTreeParser::OptionsDecodeNumbers);
+            std::u16string inputText(corpusText);
+            double startTime = GetMilliseconds();
+            jsonexParser.ReadNodesParallel(IN OUT parallelTextTree, std::move(inputText));
+            appendResult(u"readParallel", parallelTextTree.GetNodeCount(), GetMilliseconds() - startTime);
+        }
+
+        // Write the tree to a binary cache image and read it back, as settings
+        // files are with caching enabled. Reading includes hashing the source
+        // to validate the image, so that it compares directly with read.
+        {
+            auto sourceBytes = make_array_ref(reinterpret_cast<uint8_t const*>(corpusText.data()), corpusText.size() * sizeof(char16_t));
+            std::vector<uint8_t> cacheData;
+            double startTime = GetMilliseconds();
+            textTree.WriteBinary(TextTree::GetSourceHash(sourceBytes, 0), OUT cacheData);
+            appendResult(u"cacheWrite", cacheData.size(), GetMilliseconds() - startTime);
+
+            TextTree cachedTextTree;
+            std::u16string inputText(corpusText);
+            startTime = GetMilliseconds();
+            if (!cachedTextTree.ReadBinary(cacheData, TextTree::GetSourceHash(sourceBytes, 0), std::move(inputText)))
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+            appendResult(u"cacheRead", cachedTextTree.GetNodeCount(), GetMilliseconds() - startTime);
+        }
+
+        // Visit every node's text in order, as loading does.
+        {
+            uint64_t totalTextLength = 0;
+            double startTime = GetMilliseconds();
+            for (auto node = textTree.begin(), nodeEnd = textTree.end(); node != nodeEnd; ++node)
+            {
+                uint32_t textLength;
+                textTree.GetText(*node, OUT textLength);
+                totalTextLength += textLength;
+            }
+            appendResult(u"walk", textTree.GetNodeCount(), GetMilliseconds() - startTime);
+        }
+
+        std::vector<DrawableObjectAndValues> drawableObjects;
+        {
+            double startTime = GetMilliseconds();
+            DrawableObjectAndValues::Load(FindObjectsNode(textTree, syntax), IN OUT drawableObjects);
+            appendResult(u"load", drawableObjects.size(), GetMilliseconds() - startTime);
+        }
+
+        // Loading straight from the events reads the text again too.
+        if (syntax != TextTree::SyntaxWindowsInitialization)
+        {
+            std::vector<DrawableObjectAndValues> eventDrawableObjects;
+            double startTime = GetMilliseconds();
+            parser->Reset(corpusText, GetParserOptions(syntax));
+            if (ReadEventsToObjectsNode(*parser))
+            {
+                DrawableObjectAndValues::Load(*parser, IN OUT eventDrawableObjects);
+            }
+            appendResult(u"loadEvents", eventDrawableObjects.size(), GetMilliseconds() - startTime);
+        }
+
+        // Store as the settings file is, into a new tree.
+        {
+            double startTime = GetMilliseconds();
+            TextTree storedTextTree;
+            storedTextTree.BeginEdits();
+            storedTextTree.Append(TextTree::Node::TypeRoot, 1, u"", 0);
+            TextTree::NodePointer root = storedTextTree.begin();
+            TextTree::NodePointer subroot = root.AppendChild(TextTree::Node::TypeObject, u"", 0);
+            subroot.SetKeyValue(u"content", u"TextLayoutSamplerSettings", uint32_t(countof(u"TextLayoutSamplerSettings")) - 1);
+            auto objectsNode = subroot.AppendChild(TextTree::Node::TypeArray, u"objects", uint32_t(countof(u"objects")) - 1);
+            DrawableObjectAndValues::Store(drawableObjects, objectsNode);
+            storedTextTree.EndEdits();
+            appendResult(u"store", storedTextTree.GetNodeCount(), GetMilliseconds() - startTime);
+        }
+
+        // Write the tree read back out to a file, streaming it through the
+        // sink as the settings file is saved (INI has no writer).
+        std::unique_ptr<TextTreeWriter> writer;
+        switch (syntax)
+        {
+        case TextTree::SyntaxJsonex: writer = std::make_unique<JsonexWriter>(JsonexWriter::OptionsDefault); break;
+        case TextTree::SyntaxXml:    writer = std::make_unique<XmlWriter>(XmlWriter::OptionsDefault);       break;
+        default:                     break;
+        }
+        if (writer != nullptr)
+        {
+            char16_t tempDirectory[MAX_PATH];
+            if (GetTempPath(static_cast<DWORD>(countof(tempDirectory)), OUT ToWChar(tempDirectory)) == 0)
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            std::u16string filePath(tempDirectory);
+            filePath.append(u"TextLayoutSampler.benchmark.tmp");
+
+            uint64_t writtenByteCount = 0;
+            HRESULT hr = S_OK;
+            double startTime = GetMilliseconds();
+            {
+                SequentialFileWriter fileWriter;
+                hr = fileWriter.Create(filePath.c_str());
+                if (SUCCEEDED(hr))
+                {
+                    writer->SetSink(
+                        [&](array_ref<uint8_t const> data) -> HRESULT
+                        {
+                            writtenByteCount += data.size();
+                            return fileWriter.Write(data);
+                        }
+                    );
+                    hr = writer->WriteNodes(textTree);
+                    if (SUCCEEDED(hr))
+                        hr = writer->Flush();
+                }
+            }
+            double endTime = GetMilliseconds();
+            DeleteFile(ToWChar(filePath.c_str()));
+            IFR(hr);
+
+            appendResult(u"write", writtenByteCount, endTime - startTime);
+        }
+
+        return S_OK;
+    }
+
+
+    // Parses a size like 1024, 64K, 16M, or 1G (binary multiples).
+    bool ParseSize(std::u16string_view text, OUT uint64_t& size)
+    {
+        size = 0;
+        if (text.empty())
+            return false;
+
+        uint64_t multiplier = 1;
+        switch (text.back())
+        {
+        case 'K': case 'k': multiplier = 1ull << 10; break;
+        case 'M': case 'm': multiplier = 1ull << 20; break;
+        case 'G': case 'g': multiplier = 1ull << 30; break;
+        }
+        if (multiplier > 1)
+        {
+            text.remove_suffix(1);
+        }
+        if (text.empty())
+            return false;
+
+        for (char16_t ch : text)
+        {
+            if (ch < '0' || ch > '9')
+                return false;
+            size = size * 10 + (ch - '0');
+        }
+        size *= multiplier;
+        return size > 0;
+    }
+
+
+    bool ParseCount(std::u16string_view text, OUT uint32_t& count)
+    {
+        uint64_t value;
+        if (!ParseSize(text, OUT value) && text != u"0")
+            return false;
+
+        count = static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+        return true;
+    }
+}
+
+
+void GenerateBenchmarkCorpus(
+    TextTree::Syntax syntax,
+    BenchmarkCorpusOptions const& options,
+    OUT std::u16string& text
+    )
+{
+    text.clear();
+    text.reserve(static_cast<size_t>(options.size) + 1024);
+
+    ChoiceGenerator escapeChoices;
+    ChoiceGenerator commentChoices;
+
+    switch (syntax)
+    {
+    case TextTree::SyntaxJsonex:
+        text.append(u"{\r\n  \"content\": \"TextLayoutSamplerSettings\",\r\n  \"objects\":[\r\n");
+        for (uint32_t objectIndex = 0; text.size() < options.size; ++objectIndex)
+        {
+            if (commentChoices.Choose(options.commentDensity))
+            {
+                AppendFormattedString(IN OUT text, u"    // Object %u\r\n", objectIndex);
+            }
+            text.append((objectIndex > 0) ? u"    ,{\"text\": \"" : u"    {\"text\": \"");
+            AppendSampleText(objectIndex, options.stringLength, escapeChoices.Choose(options.escapeDensity) ? u"\\\"" : nullptr, IN OUT text);
+            AppendFormattedString(IN OUT text, u"\", \"font_size\": %u, \"font_family\": \"Segoe UI\", \"function\": \"D2D DrawTextLayout\"", 8 + objectIndex % 40);
+            for (uint32_t level = 1; level <= options.nestingDepth; ++level)
+            {
+                AppendFormattedString(IN OUT text, u", \"nested\": {\"level\": %u", level);
+            }
+            text.append(options.nestingDepth, '}');
+            text.append(u"}\r\n");
+        }
+        text.append(u"  ]\r\n}\r\n");
+        break;
+
+    case TextTree::SyntaxWindowsInitialization:
+        for (uint32_t objectIndex = 0; text.size() < options.size; ++objectIndex)
+        {
+            if (commentChoices.Choose(options.commentDensity))
+            {
+                AppendFormattedString(IN OUT text, u"; Object %u\r\n", objectIndex);
+            }
+            text.append(u"[object]\r\ntext = \"");
+            AppendSampleText(objectIndex, options.stringLength, escapeChoices.Choose(options.escapeDensity) ? u"\\\"" : nullptr, IN OUT text);
+            AppendFormattedString(IN OUT text, u"\"\r\nfont_size = %u\r\nfont_family = \"Segoe UI\"\r\nfunction = \"D2D DrawTextLayout\"\r\n\r\n", 8 + objectIndex % 40);
+        }
+        break;
+
+    case TextTree::SyntaxXml:
+        text.append(u"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n<settings content=\"TextLayoutSamplerSettings\">\r\n  <objects>\r\n");
+        for (uint32_t objectIndex = 0; text.size() < options.size; ++objectIndex)
+        {
+            if (commentChoices.Choose(options.commentDensity))
+            {
+                AppendFormattedString(IN OUT text, u"    <!-- Object %u -->\r\n", objectIndex);
+            }
+            text.append(u"    <object text=\"");
+            AppendSampleText(objectIndex, options.stringLength, escapeChoices.Choose(options.escapeDensity) ? u"&amp;" : nullptr, IN OUT text);
+            AppendFormattedString(IN OUT text, u"\" font_size=\"%u\" font_family=\"Segoe UI\" function=\"D2D DrawTextLayout\"", 8 + objectIndex % 40);
+            if (options.nestingDepth == 0)
+            {
+                text.append(u"/>\r\n");
+                continue;
+            }
+            text.push_back('>');
+            for (uint32_t level = 1; level <= options.nestingDepth; ++level)
+            {
+                AppendFormattedString(IN OUT text, u"<nested level=\"%u\">", level);
+            }
+            for (uint32_t level = 1; level <= options.nestingDepth; ++level)
+            {
+                text.append(u"</nested>");
+            }
+            text.append(u"</object>\r\n");
+        }
+        text.append(u"  </objects>\r\n</settings>\r\n");
+        break;
+    }
+}
+
+
+HRESULT RunBenchmarks(
+    array_ref<uint64_t const> sizes,
+    BenchmarkCorpusOptions const& options,
+    IN OUT std::u16string& results
+    )
+{
+    if (results.empty())
+    {
+        results.append(u"syntax,size,operation,count,milliseconds,megabytesPerSecond\r\n");
+    }
+
+    const TextTree::Syntax syntaxes[] = {TextTree::SyntaxJsonex, TextTree::SyntaxWindowsInitialization, TextTree::SyntaxXml};
+
+    std::u16string corpusText;
+    BenchmarkCorpusOptions corpusOptions = options;
+    for (uint64_t size : sizes)
+    {
+        corpusOptions.size = size;
+        if (size > MaximumBenchmarkCorpusSize)
+            return E_INVALIDARG;
+
+        for (auto syntax : syntaxes)
+        {
+            GenerateBenchmarkCorpus(syntax, corpusOptions, OUT corpusText);
+            IFR(BenchmarkCorpus(syntax, corpusText, IN OUT results));
+        }
+    }
+
+    return S_OK;
+}
+
+
+HRESULT RunBenchmarksFromCommandLine(
+    _In_z_ char16_t const* commandLine,
+    OUT std::u16string& errorMessage
+    )
+{
+    errorMessage.clear();
+
+    std::vector<uint64_t> sizes;
+    BenchmarkCorpusOptions options;
+    std::u16string outputFilePath = u"TextLayoutSampler.benchmark.csv";
+
+    // Read each name=value option, which may be quoted if it contains spaces.
+    std::u16string_view remainingText(commandLine);
+    while (true)
+    {
+        size_t optionStart = remainingText.find_first_not_of(u' ');
+        if (optionStart == remainingText.npos)
+            break;
+
+        remainingText.remove_prefix(optionStart);
+        std::u16string_view option;
+        if (remainingText.front() == '"')
+        {
+            size_t optionEnd = remainingText.find(u'"', 1);
+            option = remainingText.substr(1, optionEnd - 1);
+            remainingText.remove_prefix(std::min(optionEnd + 1, remainingText.size()));
+        }
+        else
+        {
+            size_t optionEnd = std::min(remainingText.find(u' '), remainingText.size());
+            option = remainingText.substr(0, optionEnd);
+            remainingText.remove_prefix(optionEnd);
+        }
+
+        size_t equalsIndex = option.find(u'=');
+        if (equalsIndex == option.npos)
+        {
+            errorMessage.assign(u"Options must be name=value: ").append(option);
+            return E_INVALIDARG;
+        }
+
+        std::u16string_view name = option.substr(0, equalsIndex);
+        std::u16string_view value = option.substr(equalsIndex + 1);
+        bool isValid = true;
+        if (name == u"sizes")
+        {
+            while (isValid && !value.empty())
+            {
+                size_t sizeEnd = std::min(value.find(u','), value.size());
+                uint64_t size;
+                isValid = ParseSize(value.substr(0, sizeEnd), OUT size);
+                if (isValid && size > MaximumBenchmarkCorpusSize)
+                {
+                    errorMessage.assign(u"Sizes above 64M are not supported, since each corpus and the trees read from it are held in memory: ").append(value.substr(0, sizeEnd));
+                    return E_INVALIDARG;
+                }
+                sizes.push_back(size);
+                value.remove_prefix(std::min(sizeEnd + 1, value.size()));
+            }
+        }
+        else if (name == u"depth")    isValid = ParseCount(value, OUT options.nestingDepth);
+        else if (name == u"strings")  isValid = ParseCount(value, OUT options.stringLength);
+        else if (name == u"escapes")  isValid = ParseCount(value, OUT options.escapeDensity);
+        else if (name == u"comments") isValid = ParseCount(value, OUT options.commentDensity);
+        else if (name == u"out")      outputFilePath = value;
+        else                          isValid = false;
+
+        if (!isValid)
+        {
+            errorMessage.assign(u"Unknown or invalid option: ").append(option);
+            return E_INVALIDARG;
+        }
+    }
+
+    if (sizes.empty())
+    {
+        sizes = {1ull << 10, 1ull << 20, 32ull << 20};
+    }
+
+    std::u16string results;
+    IFR(RunBenchmarks(sizes, options, IN OUT results));
+    IFR(WriteTextFile(outputFilePath.c_str(), results));
+
+    return S_OK;
+}
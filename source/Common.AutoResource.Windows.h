@@ -47,6 +47,7 @@ using ModuleHandle          = AutoResource<HMODULE, AutoResourceHandlePolicy<HMO
 using WindowHandle          = AutoResource<HWND,    AutoResourceHandlePolicy<HWND,    BOOL (WINAPI*)(HWND),          &DestroyWindow>, HWND>;
 using MemoryViewResource    = AutoResource<void*,   AutoResourceHandlePolicy<void*,   BOOL (WINAPI*)(void const*),   &UnmapViewOfFile>, void*>;
 using MemorySectionResource = AutoResource<HANDLE,  AutoResourceHandlePolicy<HANDLE,  BOOL (WINAPI*)(HANDLE),        &CloseHandle>, HANDLE>;
+using EventHandle           = AutoResource<HANDLE,  AutoResourceHandlePolicy<HANDLE,  BOOL (WINAPI*)(HANDLE),        &CloseHandle>, HANDLE>;
 
 using GdiDeviceContext      = AutoResource<HDC,     AutoResourceHandlePolicy<HDC,     BOOL (WINAPI*)(HDC),           &DeleteDC>, HDC>;
 using GdiPenHandle          = AutoResource<HPEN,    AutoResourceHandlePolicy<HGDIOBJ, BOOL (WINAPI*)(HGDIOBJ),       &DeleteObject>, HGDIOBJ>;
@@ -62,6 +63,7 @@ using ModuleHandle          = AutoResource<HMODULE, AutoResourceHandlePolicy<HMO
 using WindowHandle          = AutoResource<HWND,    AutoResourceHandlePolicy<HWND,    BOOL (WINAPI*)(HWND),          &DestroyWindow>, HWND>;
 using MemoryViewResource    = AutoResource<void*,   AutoResourceHandlePolicy<void*,   BOOL (WINAPI*)(void const*),   &UnmapViewOfFile>, void*>;
 using MemorySectionResource = AutoResource<HANDLE,  AutoResourceHandlePolicy<HANDLE,  BOOL (WINAPI*)(HANDLE),        &CloseHandle>, HANDLE>;
+using EventHandle           = AutoResource<HANDLE,  AutoResourceHandlePolicy<HANDLE,  BOOL (WINAPI*)(HANDLE),        &CloseHandle>, HANDLE>;
 
 ////////////////////////////////////////
 // Basic COM pointer.
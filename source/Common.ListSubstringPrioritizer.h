@@ -41,3 +41,48 @@ private:
     std::u16string filterString_;
     std::u16string majusculeName_;
 };
+
+// Index over a fixed list of names, for filtering them repeatedly while the
+// user types. The names are upper-cased once when added, recording where their
+// words begin, and every three character sequence (trigram) maps to the items
+// containing it, so a filter only checks the items holding its rarest trigram.
+// A filter extending the previous one just rechecks the previous matches.
+class ListSubstringIndex
+{
+public:
+    using WeightValue = ListSubstringPrioritizer::WeightValue;
+
+    void Clear();
+
+    // The item index is the order the names were added.
+    void AddName(array_ref<char16_t const> name);
+
+    uint32_t GetItemCount() const noexcept;
+
+    // Order the items best to worst like ListSubstringPrioritizer, by weight
+    // and then by index, with any mismatches last.
+    array_ref<uint32_t> GetItemIndices(
+        array_ref<char16_t const> filterString,
+        _Out_ array_ref<uint32_t> items,
+        bool excludeMismatches
+        );
+
+private:
+    array_ref<char16_t const> GetMajusculeName(uint32_t itemIndex) const noexcept;
+    WeightValue GetItemWeight(uint32_t itemIndex, array_ref<char16_t const> majusculeFilter) const noexcept;
+    void GetCandidateItems(array_ref<char16_t const> majusculeFilter, _Out_ std::vector<uint32_t>& candidateItems);
+    static uint64_t GetTrigramKey(char16_t const* text) noexcept;
+    static uint64_t HashNextCharacter(uint64_t hash, char16_t ch) noexcept;
+
+private:
+    std::u16string majusculeNames_;         // All names upper-cased, each followed by a nul.
+    std::vector<uint32_t> nameOffsets_;     // Where each name begins in majusculeNames_, plus the end.
+    std::vector<uint32_t> wordOffsets_;     // Offsets in majusculeNames_ of each word following a space.
+    std::vector<uint32_t> wordIndices_;     // Where each item's words begin in wordOffsets_, plus the end.
+    std::unordered_map<uint64_t, std::vector<uint32_t>> trigramItems_; // Trigram -> ascending indices of items containing it.
+    std::unordered_map<uint64_t, std::vector<uint32_t>> nameItems_; // Hash of whole name -> indices of items which may have it.
+
+    std::u16string filterString_;           // Upper-cased filter of the previous call.
+    std::vector<uint32_t> matchingItems_;   // Ascending indices of the items matching filterString_.
+    std::vector<uint32_t> weightedItems_[WeightValue::WeightValueNoMatch]; // Matching items of each weight, reused between calls.
+};
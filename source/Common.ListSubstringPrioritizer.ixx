@@ -9,6 +9,7 @@
 #include "precomp.h"
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #if USE_CPP_MODULES
     export module Common.ListSubstringPrioritizer;
@@ -68,9 +69,15 @@ ListSubstringPrioritizer::WeightValue ListSubstringPrioritizer::GetStringWeight(
         auto searchIndex = majusculeName_.find(filterString_);
         if (searchIndex != std::u16string::npos)
         {
-            // Substrings have next priority.
-            bool beginsWord = (searchIndex == 0 || majusculeName_[searchIndex - 1] == ' ');
-            return beginsWord ? IndexAndWeight::WeightValueWordPrefix : IndexAndWeight::WeightValueSubstring;
+            // Substrings have next priority, after any word beginning with the filter.
+            for (auto wordIndex = searchIndex; wordIndex != std::u16string::npos; wordIndex = majusculeName_.find(filterString_, wordIndex + 1))
+            {
+                if (wordIndex == 0 || majusculeName_[wordIndex - 1] == ' ')
+                {
+                    return IndexAndWeight::WeightValueWordPrefix;
+                }
+            }
+            return IndexAndWeight::WeightValueSubstring;
         }
     }
 
@@ -105,3 +112,269 @@ array_ref<uint32_t> ListSubstringPrioritizer::GetItemIndices(_Out_ array_ref<uin
 
     return array_ref<uint32_t>(items.data(), i);
 }
+
+
+namespace
+{
+    const uint64_t ListSubstringIndexHashBasis = 0xCBF29CE484222325ull; // FNV-1a offset basis.
+}
+
+
+void ListSubstringIndex::Clear()
+{
+    majusculeNames_.clear();
+    nameOffsets_.clear();
+    wordOffsets_.clear();
+    wordIndices_.clear();
+    trigramItems_.clear();
+    nameItems_.clear();
+    filterString_.clear();
+    matchingItems_.clear();
+}
+
+
+void ListSubstringIndex::AddName(array_ref<char16_t const> name)
+{
+    if (nameOffsets_.empty())
+    {
+        nameOffsets_.push_back(0);
+        wordIndices_.push_back(0);
+    }
+
+    uint32_t const itemIndex = GetItemCount();
+    uint32_t const nameOffset = static_cast<uint32_t>(majusculeNames_.size());
+    uint32_t const nameLength = static_cast<uint32_t>(name.size());
+
+    // Capitalize so filters compare without case.
+    majusculeNames_.append(name.data(), name.size());
+    ToUpperCase(IN OUT array_ref<char16_t>(&majusculeNames_[nameOffset], nameLength));
+    majusculeNames_.push_back('\0');
+    nameOffsets_.push_back(static_cast<uint32_t>(majusculeNames_.size()));
+
+    char16_t const* majusculeName = &majusculeNames_[nameOffset];
+    for (uint32_t i = 1; i < nameLength; ++i)
+    {
+        if (majusculeName[i - 1] == ' ')
+        {
+            wordOffsets_.push_back(nameOffset + i);
+        }
+    }
+    wordIndices_.push_back(static_cast<uint32_t>(wordOffsets_.size()));
+
+    uint64_t nameHash = ListSubstringIndexHashBasis;
+    for (uint32_t i = 0; i < nameLength; ++i)
+    {
+        nameHash = HashNextCharacter(nameHash, majusculeName[i]);
+    }
+    nameItems_[nameHash].push_back(itemIndex);
+
+    for (uint32_t i = 0; i + 3 <= nameLength; ++i)
+    {
+        auto& items = trigramItems_[GetTrigramKey(&majusculeName[i])];
+        if (items.empty() || items.back() != itemIndex)
+        {
+            items.push_back(itemIndex);
+        }
+    }
+
+    // Any previous results do not include the new name.
+    filterString_.clear();
+    matchingItems_.clear();
+}
+
+
+uint32_t ListSubstringIndex::GetItemCount() const noexcept
+{
+    return nameOffsets_.empty() ? 0 : static_cast<uint32_t>(nameOffsets_.size() - 1);
+}
+
+
+array_ref<char16_t const> ListSubstringIndex::GetMajusculeName(uint32_t itemIndex) const noexcept
+{
+    // Exclude the nul.
+    return array_ref<char16_t const>(
+        majusculeNames_.data() + nameOffsets_[itemIndex],
+        majusculeNames_.data() + nameOffsets_[itemIndex + 1] - 1
+        );
+}
+
+
+uint64_t ListSubstringIndex::GetTrigramKey(char16_t const* text) noexcept
+{
+    return (uint64_t(text[0]) << 32) | (uint64_t(text[1]) << 16) | uint64_t(text[2]);
+}
+
+
+uint64_t ListSubstringIndex::HashNextCharacter(uint64_t hash, char16_t ch) noexcept
+{
+    // FNV-1a, so that each beginning of the filter is hashed by extending the last.
+    return (hash ^ ch) * 0x100000001B3ull;
+}
+
+
+ListSubstringIndex::WeightValue ListSubstringIndex::GetItemWeight(
+    uint32_t itemIndex,
+    array_ref<char16_t const> majusculeFilter
+    ) const noexcept
+{
+    array_ref<char16_t const> majusculeName = GetMajusculeName(itemIndex);
+    size_t const filterSize = majusculeFilter.size();
+    size_t const minStringSize = std::min(majusculeName.size(), filterSize);
+
+    // Prefix matching has priority, as in ListSubstringPrioritizer::GetStringWeight.
+    if (std::equal(majusculeName.begin(), majusculeName.begin() + minStringSize, majusculeFilter.begin()))
+    {
+        return WeightValue::WeightValueStringPrefix;
+    }
+    if (filterSize > majusculeName.size())
+    {
+        return WeightValue::WeightValueNoMatch;
+    }
+
+    // Then any word beginning with the filter.
+    char16_t const* const nameEnd = majusculeName.end();
+    for (uint32_t i = wordIndices_[itemIndex], wordEnd = wordIndices_[itemIndex + 1]; i < wordEnd; ++i)
+    {
+        char16_t const* word = majusculeNames_.data() + wordOffsets_[i];
+        if (size_t(nameEnd - word) >= filterSize && std::equal(word, word + filterSize, majusculeFilter.begin()))
+        {
+            return WeightValue::WeightValueWordPrefix;
+        }
+    }
+
+    // Substrings have next priority.
+    if (std::search(majusculeName.begin(), nameEnd, majusculeFilter.begin(), majusculeFilter.end()) != nameEnd)
+    {
+        return WeightValue::WeightValueSubstring;
+    }
+
+    return WeightValue::WeightValueNoMatch;
+}
+
+
+void ListSubstringIndex::GetCandidateItems(
+    array_ref<char16_t const> majusculeFilter,
+    _Out_ std::vector<uint32_t>& candidateItems
+    )
+{
+    candidateItems.clear();
+    size_t const filterSize = majusculeFilter.size();
+
+    // A filter extended from the previous one can only match a subset of its matches.
+    if (!filterString_.empty()
+    &&  filterString_.size() <= filterSize
+    &&  std::equal(filterString_.begin(), filterString_.end(), majusculeFilter.begin()))
+    {
+        candidateItems.swap(matchingItems_);
+        return;
+    }
+
+    uint32_t const itemCount = GetItemCount();
+    if (filterSize < 3)
+    {
+        // Too short for trigrams, so check them all.
+        candidateItems.resize(itemCount);
+        std::iota(candidateItems.begin(), candidateItems.end(), 0);
+        return;
+    }
+
+    // Every match contains all the filter's trigrams, so just the items with
+    // the rarest of them need checking.
+    std::vector<uint32_t> const* rarestTrigramItems = nullptr;
+    for (size_t i = 0; i + 3 <= filterSize; ++i)
+    {
+        auto match = trigramItems_.find(GetTrigramKey(&majusculeFilter[i]));
+        if (match == trigramItems_.end())
+        {
+            rarestTrigramItems = nullptr;
+            break;
+        }
+        if (rarestTrigramItems == nullptr || match->second.size() < rarestTrigramItems->size())
+        {
+            rarestTrigramItems = &match->second;
+        }
+    }
+    if (rarestTrigramItems != nullptr)
+    {
+        candidateItems = *rarestTrigramItems;
+    }
+
+    // Names shorter than the filter which begin it also count as prefix
+    // matches, found by looking up each shorter beginning of the filter.
+    // Differing names with the same hash are just checked needlessly.
+    size_t const oldCandidateCount = candidateItems.size();
+    uint64_t prefixHash = ListSubstringIndexHashBasis;
+    for (size_t prefixSize = 0; prefixSize < filterSize; ++prefixSize)
+    {
+        auto match = nameItems_.find(prefixHash);
+        if (match != nameItems_.end())
+        {
+            candidateItems.insert(candidateItems.end(), match->second.begin(), match->second.end());
+        }
+        prefixHash = HashNextCharacter(prefixHash, majusculeFilter[prefixSize]);
+    }
+
+    if (candidateItems.size() > oldCandidateCount)
+    {
+        std::sort(candidateItems.begin(), candidateItems.end());
+        candidateItems.erase(std::unique(candidateItems.begin(), candidateItems.end()), candidateItems.end());
+    }
+}
+
+
+array_ref<uint32_t> ListSubstringIndex::GetItemIndices(
+    array_ref<char16_t const> filterString,
+    _Out_ array_ref<uint32_t> items,
+    bool excludeMismatches
+    )
+{
+    std::u16string majusculeFilter(filterString.data(), filterString.size());
+    ToUpperCase(IN OUT majusculeFilter);
+
+    std::vector<uint32_t> candidateItems;
+    GetCandidateItems(majusculeFilter, OUT candidateItems);
+
+    // Group the matching candidates by weight, keeping them in order.
+    for (auto& weightedItems : weightedItems_)
+    {
+        weightedItems.clear();
+    }
+    matchingItems_.clear();
+    for (uint32_t itemIndex : candidateItems)
+    {
+        WeightValue weight = GetItemWeight(itemIndex, majusculeFilter);
+        if (weight < WeightValue::WeightValueNoMatch)
+        {
+            weightedItems_[weight].push_back(itemIndex);
+            matchingItems_.push_back(itemIndex);
+        }
+    }
+    filterString_ = std::move(majusculeFilter);
+
+    // Copy the item indices out best to worst, then any mismatches.
+    size_t i = 0;
+    size_t const itemCount = std::min(items.size(), size_t(GetItemCount()));
+    for (auto& weightedItems : weightedItems_)
+    {
+        for (size_t j = 0, weightedItemCount = weightedItems.size(); j < weightedItemCount && i < itemCount; ++j)
+        {
+            items[i++] = weightedItems[j];
+        }
+    }
+
+    if (!excludeMismatches)
+    {
+        auto matchingItem = matchingItems_.begin();
+        for (uint32_t itemIndex = 0; i < itemCount; ++itemIndex)
+        {
+            if (matchingItem != matchingItems_.end() && *matchingItem == itemIndex)
+            {
+                ++matchingItem;
+                continue;
+            }
+            items[i++] = itemIndex;
+        }
+    }
+
+    return array_ref<uint32_t>(items.data(), i);
+}
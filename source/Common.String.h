@@ -115,6 +115,15 @@ void EscapeHtmlNamedCharacterReferences(array_ref<char16_t const> text, /*out*/
 void RemoveTrailingZeroes(_Inout_ std::u16string& text) noexcept;
 void WriteZeroPaddedHexNum(uint32_t value, /*out*/ array_ref<char16_t> buffer);
 uint32_t ReadUnsignedNumericValue(_Inout_ array_ref<char16_t const>& text, uint32_t base); // Unlike wcstoul, respects length limit, and doesn't throw exception!
+
+// Decode a plain decimal number from the start of the text, returning its end,
+// or nullptr to parse the usual way. The integer is the same as wcstoul would
+// return (negative values wrap, and too large values saturate). The float is
+// the same as wcstof, but only decoded when exact (mantissa below 2^24, power
+// of ten at most 10), so longer fractions, infinity, or hexadecimal return
+// nullptr. A lone 'e' is not part of the number, same as wcstof.
+char16_t const* DecodeDecimalInteger(char16_t const* text, char16_t const* textEnd, _Out_ uint32_t& integerValue) noexcept;
+char16_t const* DecodeDecimalFloat(char16_t const* text, char16_t const* textEnd, _Out_ float& floatValue) noexcept;
 array_ref<wchar_t> ToWString(int32_t value, /*out*/ array_ref<wchar_t> s);
 
 static_assert(sizeof(wchar_t) == sizeof(char16_t), "These casts only work on platforms where wchar_t is 16 bits.");
@@ -163,6 +163,199 @@ uint32_t ReadUnsignedNumericValue(_Inout_ array_ref<char16_t const>& text, _In_r
 }
 
 
+// Plain decimal numbers (node values, numeric attribute arrays) are decoded
+// here without the locale lookups or nul termination wcstoul and wcstof need.
+// Runs of digits are converted eight at a time with SSE2 where available.
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define STRING_USE_SSE2 1
+#endif
+
+namespace
+{
+    constexpr uint32_t powersOfTenInteger[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    constexpr float powersOfTenFloat[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+    // More digits than this are left to the general parser.
+    const uint32_t MaximumDecodedDigitCount = 18;
+
+    inline bool IsDecimalDigit(char16_t ch) noexcept
+    {
+        return ch >= '0' && ch <= '9';
+    }
+
+#if STRING_USE_SSE2
+    using Vector128 = __m128i;
+
+    // Converts the leading run of up to eight digits, returning the count of
+    // digits read. The text must have eight code units readable.
+    uint32_t ReadEightDigits(_In_reads_(8) char16_t const* text, _Out_ uint32_t& value)
+    {
+        // Digits become 0-9, and anything else a larger unsigned value.
+        Vector128 v = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<Vector128 const*>(text)), _mm_set1_epi16('0'));
+        Vector128 isDigit = _mm_cmpeq_epi16(_mm_subs_epu16(v, _mm_set1_epi16(9)), _mm_setzero_si128());
+        uint32_t nonDigitMask = ~uint32_t(_mm_movemask_epi8(isDigit)) & 0xFFFF;
+        uint32_t digitCount = (nonDigitMask == 0) ? 8 : std::countr_zero(nonDigitMask) / 2;
+
+        // Clear everything from the first non-digit on, and read the digits as
+        // if padded with trailing zeros: pairs, then quads, then all eight.
+        Vector128 isLeading = _mm_cmplt_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16(short(digitCount)));
+        v = _mm_and_si128(v, isLeading);
+        Vector128 pairs = _mm_madd_epi16(v, _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1));
+        Vector128 quads = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs), _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+        uint32_t paddedValue = uint32_t(_mm_cvtsi128_si32(quads)) * 10000 + uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(quads, 4)));
+
+        value = paddedValue / powersOfTenInteger[8 - digitCount];
+        return digitCount;
+    }
+#endif
+
+    // Accumulates a run of digits into the value, returning the new position.
+    // Stops early after MaximumDecodedDigitCount, where the caller falls back.
+    char16_t const* ReadDigits(
+        char16_t const* text,
+        char16_t const* textEnd,
+        IN OUT uint64_t& value,
+        IN OUT uint32_t& digitCount
+        )
+    {
+        while (digitCount <= MaximumDecodedDigitCount)
+        {
+#if STRING_USE_SSE2
+            if (textEnd - text >= 8 && digitCount + 8 <= MaximumDecodedDigitCount)
+            {
+                uint32_t chunkValue;
+                uint32_t chunkDigitCount = ReadEightDigits(text, OUT chunkValue);
+                value = value * powersOfTenInteger[chunkDigitCount] + chunkValue;
+                digitCount += chunkDigitCount;
+                text += chunkDigitCount;
+                if (chunkDigitCount < 8)
+                    break;
+                continue;
+            }
+#endif
+            if (text >= textEnd || !IsDecimalDigit(*text))
+                break;
+
+            value = value * 10 + (*text - '0');
+            ++digitCount;
+            ++text;
+        }
+        return text;
+    }
+}
+
+
+char16_t const* DecodeDecimalInteger(char16_t const* text, char16_t const* textEnd, _Out_ uint32_t& integerValue) noexcept
+{
+    integerValue = 0;
+    bool isNegative = false;
+    if (text < textEnd && (*text == '-' || *text == '+'))
+    {
+        isNegative = (*text == '-');
+        ++text;
+    }
+
+    uint64_t value = 0;
+    uint32_t digitCount = 0;
+    text = ReadDigits(text, textEnd, IN OUT value, IN OUT digitCount);
+    if (digitCount == 0)
+        return nullptr;
+
+    if (digitCount > MaximumDecodedDigitCount)
+    {
+        // Read the excess digits, which saturate unless the earlier ones
+        // were all leading zeros.
+        const uint64_t saturatedValue = uint64_t(UINT32_MAX) + 1;
+        for (value = std::min(value, saturatedValue); text < textEnd && IsDecimalDigit(*text); ++text)
+        {
+            value = std::min(value * 10 + (*text - '0'), saturatedValue);
+        }
+    }
+
+    if (value > UINT32_MAX)
+    {
+        integerValue = UINT32_MAX;
+    }
+    else
+    {
+        integerValue = static_cast<uint32_t>(isNegative ? 0 - value : value);
+    }
+    return text;
+}
+
+
+char16_t const* DecodeDecimalFloat(char16_t const* text, char16_t const* textEnd, _Out_ float& floatValue) noexcept
+{
+    floatValue = 0;
+    bool isNegative = false;
+    if (text < textEnd && (*text == '-' || *text == '+'))
+    {
+        isNegative = (*text == '-');
+        ++text;
+    }
+
+    uint64_t mantissa = 0;
+    uint32_t digitCount = 0;
+    text = ReadDigits(text, textEnd, IN OUT mantissa, IN OUT digitCount);
+    int32_t exponent = 0;
+    if (text < textEnd && *text == '.')
+    {
+        uint32_t integerDigitCount = digitCount;
+        text = ReadDigits(text + 1, textEnd, IN OUT mantissa, IN OUT digitCount);
+        exponent = -int32_t(digitCount - integerDigitCount);
+    }
+    if (digitCount == 0 || digitCount > MaximumDecodedDigitCount)
+        return nullptr;
+    if (text < textEnd && (*text == 'x' || *text == 'X'))
+        return nullptr; // Hexadecimal float.
+
+    if (text < textEnd && (*text == 'e' || *text == 'E'))
+    {
+        char16_t const* exponentText = text + 1;
+        bool isExponentNegative = false;
+        if (exponentText < textEnd && (*exponentText == '-' || *exponentText == '+'))
+        {
+            isExponentNegative = (*exponentText == '-');
+            ++exponentText;
+        }
+        // A lone 'e' is not part of the number, same as wcstof.
+        if (exponentText < textEnd && IsDecimalDigit(*exponentText))
+        {
+            int32_t exponentValue = 0;
+            for (; exponentText < textEnd && IsDecimalDigit(*exponentText); ++exponentText)
+            {
+                exponentValue = std::min(exponentValue * 10 + (*exponentText - '0'), 100000);
+            }
+            exponent += isExponentNegative ? -exponentValue : exponentValue;
+            text = exponentText;
+        }
+    }
+
+    // Drop trailing zeros, so 1.500 or 2000 can still be exact.
+    while (mantissa != 0 && mantissa % 10 == 0 && exponent < 0)
+    {
+        mantissa /= 10;
+        ++exponent;
+    }
+    while (mantissa != 0 && mantissa < (1 << 24) / 10 && exponent > 0)
+    {
+        mantissa *= 10;
+        --exponent;
+    }
+    if (mantissa == 0)
+        exponent = 0;
+
+    if (mantissa >= (1 << 24) || exponent < -10 || exponent > 10)
+        return nullptr;
+
+    float value = static_cast<float>(mantissa);
+    value = (exponent < 0) ? value / powersOfTenFloat[-exponent] : value * powersOfTenFloat[exponent];
+    floatValue = isNegative ? -value : value;
+    return text;
+}
+
+
 // Internal version. Should call the other two overloads publicly.
 void GetFormattedString(_Inout_ std::u16string& returnString, bool shouldConcatenate, _In_z_ const char16_t* formatString, va_list vargs) 
 {
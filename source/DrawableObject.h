@@ -68,6 +68,138 @@ enum DrawableObjectAttribute : uint32_t
 };
 
 
+// Set of attributes, one bit per DrawableObjectAttribute, such as those
+// changed since a drawable object was last updated.
+using DrawableObjectAttributeMask = uint64_t;
+static_assert(DrawableObjectAttributeTotal <= 64, "Attributes no longer fit into DrawableObjectAttributeMask.");
+
+constexpr DrawableObjectAttributeMask DrawableObjectAttributeMaskOf(DrawableObjectAttribute attribute)
+{
+    return DrawableObjectAttributeMask(1) << attribute;
+}
+
+constexpr DrawableObjectAttributeMask DrawableObjectAttributeMaskOf(std::initializer_list<DrawableObjectAttribute> attributes)
+{
+    DrawableObjectAttributeMask mask = 0;
+    for (auto attribute : attributes)
+    {
+        mask |= DrawableObjectAttributeMaskOf(attribute);
+    }
+    return mask;
+}
+
+constexpr DrawableObjectAttributeMask DrawableObjectAttributeMaskAll = (DrawableObjectAttributeMask(1) << DrawableObjectAttributeTotal) - 1;
+
+// Attributes each cached object is created from, so that a drawable object
+// can invalidate just the caches depending on what changed (a single AND
+// with the changed attributes, rather than comparing each attribute).
+constexpr DrawableObjectAttributeMask DrawableObjectDependenciesDWriteFontFace = DrawableObjectAttributeMaskOf({
+    DrawableObjectAttributeFontFilePath,
+    DrawableObjectAttributeFontFamily,
+    DrawableObjectAttributeWeight,
+    DrawableObjectAttributeStretch,
+    DrawableObjectAttributeSlope,
+    DrawableObjectAttributeFontSimulations,
+    DrawableObjectAttributeFontFaceIndex,
+    DrawableObjectAttributeDWriteFontFaceType,
+    DrawableObjectAttributeAxisTags,
+    DrawableObjectAttributeAxisValues,
+});
+
+constexpr DrawableObjectAttributeMask DrawableObjectDependenciesDWriteRenderingParams = DrawableObjectAttributeMaskOf({
+    DrawableObjectAttributeDWriteRenderingMode,
+    DrawableObjectAttributeDWriteGridFitMode,
+});
+
+constexpr DrawableObjectAttributeMask DrawableObjectDependenciesDWriteTextFormat = DrawableObjectAttributeMaskOf({
+    DrawableObjectAttributeFontFamily,
+    DrawableObjectAttributeFontFilePath,
+    DrawableObjectAttributeLanguageList,
+    DrawableObjectAttributeFontSize,
+    DrawableObjectAttributeTabWidth,
+    DrawableObjectAttributeWeight,
+    DrawableObjectAttributeStretch,
+    DrawableObjectAttributeSlope,
+    DrawableObjectAttributeColumnAlignment,
+    DrawableObjectAttributeRowAlignment,
+    DrawableObjectAttributeLineWrappingMode,
+    DrawableObjectAttributeJustification,
+    DrawableObjectAttributeTrimmingGranularity,
+    DrawableObjectAttributeTrimmingDelimiter,
+    DrawableObjectAttributeTrimmingSign,
+    DrawableObjectAttributeDWriteFontFamilyModel,
+    DrawableObjectAttributeReadingDirection,
+    DrawableObjectAttributeFontFallback,
+    DrawableObjectAttributeDWriteVerticalGlyphOrientation,
+});
+
+// The layout is created from the text format too.
+constexpr DrawableObjectAttributeMask DrawableObjectDependenciesDWriteTextLayout = DrawableObjectDependenciesDWriteTextFormat | DrawableObjectAttributeMaskOf({
+    DrawableObjectAttributeFunction,
+    DrawableObjectAttributeText,
+    DrawableObjectAttributeWidth,
+    DrawableObjectAttributeHeight,
+    DrawableObjectAttributeDWriteMeasuringMode,
+    DrawableObjectAttributeTypographicFeatures,
+    DrawableObjectAttributeUnderline,
+    DrawableObjectAttributeStrikethrough,
+    DrawableObjectAttributeAxisTags,
+    DrawableObjectAttributeAxisValues,
+});
+
+constexpr DrawableObjectAttributeMask DrawableObjectDependenciesGdiFont = DrawableObjectAttributeMaskOf({
+    DrawableObjectAttributeFontSize,
+    DrawableObjectAttributeFontFamily,
+    DrawableObjectAttributeFontFilePath,
+    DrawableObjectAttributeUnderline,
+    DrawableObjectAttributeStrikethrough,
+    DrawableObjectAttributeWeight,
+    DrawableObjectAttributeSlope,
+    DrawableObjectAttributeGdiRenderingMode,
+    DrawableObjectAttributeReadingDirection,
+});
+
+constexpr DrawableObjectAttributeMask DrawableObjectDependenciesGdiPlusStringFormat = DrawableObjectAttributeMaskOf({
+    DrawableObjectAttributeReadingDirection,
+    DrawableObjectAttributeColumnAlignment,
+    DrawableObjectAttributeRowAlignment,
+    DrawableObjectAttributeLineWrappingMode,
+    DrawableObjectAttributeHotkeyMode,
+    DrawableObjectAttributeTrimmingGranularity,
+    DrawableObjectAttributeTrimmingDelimiter,
+    DrawableObjectAttributeTrimmingSign,
+    DrawableObjectAttributeClipping,
+    DrawableObjectAttributeFontFallback,
+    DrawableObjectAttributeTabWidth,
+});
+
+constexpr DrawableObjectAttributeMask DrawableObjectDependenciesGdiPlusFont = DrawableObjectAttributeMaskOf({
+    DrawableObjectAttributeUnderline,
+    DrawableObjectAttributeStrikethrough,
+    DrawableObjectAttributeFontSize,
+    DrawableObjectAttributeFontFamily,
+    DrawableObjectAttributeWeight,
+    DrawableObjectAttributeSlope,
+    DrawableObjectAttributeFontFilePath,
+    DrawableObjectAttributeFontFaceIndex,
+});
+
+
+// Cached objects that DrawableObject::Update invalidated, for profiling.
+enum DrawableObjectCaches : uint32_t
+{
+    DrawableObjectCachesNone                    = 0x00000000,
+    DrawableObjectCachesDWriteFontFace          = 0x00000001,
+    DrawableObjectCachesDWriteRenderingParams   = 0x00000002,
+    DrawableObjectCachesDWriteTextFormat        = 0x00000004,
+    DrawableObjectCachesDWriteTextLayout        = 0x00000008,
+    DrawableObjectCachesGdiFont                 = 0x00000010,
+    DrawableObjectCachesGdiPlusStringFormat     = 0x00000020,
+    DrawableObjectCachesGdiPlusFont             = 0x00000040,
+};
+DEFINE_ENUM_FLAG_OPERATORS(DrawableObjectCaches);
+
+
 enum DrawableObjectFunction : uint32_t
 {
     DrawableObjectFunctionNop,
@@ -146,9 +278,14 @@ interface AttributeSource;
 class DrawableObject : public ComObject
 {
 public:
-    // Called when changes occur to the attributes, so the drawable object can
-    // free any cached data or check for changes.
-    virtual HRESULT Update(IAttributeSource& attributeSource);
+    // Called when changes occur to the attributes, given which ones changed
+    // since the last update, so the drawable object can free any cached data
+    // created from them. Returns which caches were invalidated.
+    virtual HRESULT Update(
+        IAttributeSource& attributeSource,
+        DrawableObjectAttributeMask changedAttributes,
+        _Out_ DrawableObjectCaches& invalidatedCaches
+        );
 
     // Returns the bounds of where the object should be drawn and the
     // size/location of the content to draw. The content can exceed the layout
@@ -179,6 +316,7 @@ public:
     static HRESULT ExportFontGlyphData(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas, array_ref<char16_t const> filePath);
     static HRESULT GetFontCharacters(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas, bool getOnlyColorFontCharacters, _Out_ std::u16string& characters);
     static bool IsGdiOrGdiPlusFunction(DrawableObjectFunction functionType) noexcept;
+    static DrawableObjectAttribute FindAttribute(array_ref<char16_t const> name); // DrawableObjectAttributeTotal if unknown.
 
     static const Attribute attributeList[DrawableObjectAttributeTotal];
     static const Attribute::PredefinedValue functions[12];
@@ -237,30 +375,17 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // Cached common data structures shared by some of the drawable objects.
 //
-// Some of these have an Update() method that explicitly compares which
-// attributes changed since the last cached data, to reduce unnecessary work
-// because object creation is more expensive.
-//
-// Others only ensure that a useable object is cached and do not compare
-// current attributes, since object creation is fairly light. So the caller
-// must call Invalidate from its Update, then may lazily call EnsureCached
+// These only ensure that a useable object is cached and do not compare
+// current attributes. Instead the drawable object's Update invalidates the
+// ones whose dependencies (DrawableObjectDependencies*) intersect the
+// changed attributes, and then the caller may lazily call EnsureCached
 // before measuring or drawing.
 
 struct CachedDWriteFontFace
 {
     ComPtr<IDWriteFontFace> fontFace;
-    uint32_t cookieFontFilePath = ~0u;
-    uint32_t cookieFamilyName = ~0u;
-    uint32_t cookieWeight = ~0u;
-    uint32_t cookieStretch = ~0u;
-    uint32_t cookieSlope = ~0u;
-    uint32_t cookieFontSimulations = ~0u;
-    uint32_t cookieFontFaceIndex = ~0u;
-    uint32_t cookieDWriteFontFaceType = ~0u;
-    uint32_t cookieAxisTags = ~0u;
-    uint32_t cookieAxisValues = ~0u;
-
-    HRESULT Update(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas);
+
+    HRESULT EnsureCached(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas);
     void Invalidate() { fontFace.clear(); }
 };
 
@@ -268,10 +393,8 @@ struct CachedDWriteFontFace
 struct CachedDWriteRenderingParams
 {
     ComPtr<IDWriteRenderingParams> renderingParams;
-    uint32_t cookieRenderingMode = ~0;
-    uint32_t cookieGridFitMode = ~0;
 
-    HRESULT Update(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas);
+    HRESULT EnsureCached(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas);
     void Invalidate() { renderingParams.clear(); }
 };
 
@@ -357,6 +480,12 @@ struct CachedGdiPlusStartup
 class DrawableObjectGdiTextOut : public DrawableObject
 {
 public:
+    virtual HRESULT Update(
+        IAttributeSource& attributeSource,
+        DrawableObjectAttributeMask changedAttributes,
+        _Out_ DrawableObjectCaches& invalidatedCaches
+        ) override;
+
     virtual HRESULT GetBounds(
         IAttributeSource& attributeSource,
         DrawingCanvas& drawingCanvas,
@@ -380,6 +509,12 @@ protected:
 class DrawableObjectUser32DrawText : public DrawableObject
 {
 public:
+    virtual HRESULT Update(
+        IAttributeSource& attributeSource,
+        DrawableObjectAttributeMask changedAttributes,
+        _Out_ DrawableObjectCaches& invalidatedCaches
+        ) override;
+
     virtual HRESULT GetBounds(
         IAttributeSource& attributeSource,
         DrawingCanvas& drawingCanvas,
@@ -414,6 +549,12 @@ protected:
 class DrawableObjectDWriteGlyphRun : public DrawableObject
 {
 public:
+    virtual HRESULT Update(
+        IAttributeSource& attributeSource,
+        DrawableObjectAttributeMask changedAttributes,
+        _Out_ DrawableObjectCaches& invalidatedCaches
+        ) override;
+
     virtual HRESULT GetBounds(
         IAttributeSource& attributeSource,
         DrawingCanvas& drawingCanvas,
@@ -483,7 +624,11 @@ public:
 class DrawableObjectDWriteTextLayout : public DrawableObject
 {
 public:
-    virtual HRESULT Update(IAttributeSource& attributeSource) override;
+    virtual HRESULT Update(
+        IAttributeSource& attributeSource,
+        DrawableObjectAttributeMask changedAttributes,
+        _Out_ DrawableObjectCaches& invalidatedCaches
+        ) override;
 
     virtual HRESULT GetBounds(
         IAttributeSource& attributeSource,
@@ -533,7 +678,11 @@ protected:
 class DrawableObjectGdiPlusDrawString : public DrawableObject
 {
 public:
-    virtual HRESULT Update(IAttributeSource& attributeSource) override;
+    virtual HRESULT Update(
+        IAttributeSource& attributeSource,
+        DrawableObjectAttributeMask changedAttributes,
+        _Out_ DrawableObjectCaches& invalidatedCaches
+        ) override;
 
     virtual HRESULT GetBounds(
         IAttributeSource& attributeSource,
@@ -559,7 +708,11 @@ public:
 class DrawableObjectGdiPlusDrawDriverString : public DrawableObject
 {
 public:
-    virtual HRESULT Update(IAttributeSource& attributeSource) override;
+    virtual HRESULT Update(
+        IAttributeSource& attributeSource,
+        DrawableObjectAttributeMask changedAttributes,
+        _Out_ DrawableObjectCaches& invalidatedCaches
+        ) override;
 
     virtual HRESULT GetBounds(
         IAttributeSource& attributeSource,
@@ -986,8 +986,32 @@ HRESULT DrawableObject::GetBounds(
 }
 
 
-HRESULT DrawableObject::Update(IAttributeSource& attributeSource)
+// Invalidates the cached object if any attribute it is created from changed,
+// adding it to the caches reported by Update.
+template <typename CachedObjectType>
+void InvalidateIfChanged(
+    CachedObjectType& cachedObject,
+    DrawableObjectAttributeMask dependencies,
+    DrawableObjectCaches cache,
+    DrawableObjectAttributeMask changedAttributes,
+    IN OUT DrawableObjectCaches& invalidatedCaches
+    )
+{
+    if (changedAttributes & dependencies)
+    {
+        cachedObject.Invalidate();
+        invalidatedCaches |= cache;
+    }
+}
+
+
+HRESULT DrawableObject::Update(
+    IAttributeSource& attributeSource,
+    DrawableObjectAttributeMask changedAttributes,
+    _Out_ DrawableObjectCaches& invalidatedCaches
+    )
 {
+    invalidatedCaches = DrawableObjectCachesNone;
     return S_OK;
 }
 
@@ -1013,6 +1037,25 @@ DrawableObject* DrawableObject::Create(DrawableObjectFunction functionType)
 }
 
 
+DrawableObjectAttribute DrawableObject::FindAttribute(array_ref<char16_t const> name)
+{
+    static NameHashTable const attributeNameTable = []()
+    {
+        std::vector<char16_t const*> names;
+        for (auto const& attribute : attributeList)
+        {
+            names.push_back(attribute.name);
+        }
+        return NameHashTable(names, /*isCaseSensitive*/true);
+    }();
+
+    uint32_t attributeIndex = attributeNameTable.Find(name);
+    return (attributeIndex != NameHashTable::InvalidIndex)
+         ? DrawableObjectAttribute(attributeList[attributeIndex].id)
+         : DrawableObjectAttributeTotal;
+}
+
+
 void DrawableObject::GenerateLabel(IAttributeSource& attributeSource, _Out_ std::u16string& label)
 {
     // Update the current label, either using the explicit one or generating
@@ -1027,14 +1070,6 @@ void DrawableObject::GenerateLabel(IAttributeSource& attributeSource, _Out_ std:
         // Generate a label using the field names.
         label.clear();
 
-        std::map<std::u16string, uint32_t> attributeNameMap;
-        for (auto const& attribute : DrawableObject::attributeList)
-        {
-            attributeNameMap[attribute.name] = attribute.id;
-        }
-        const auto attributeNameMapEnd = attributeNameMap.end();
-        std::u16string fieldName;
-
         // Walk string looking for replaceable parts. e.g. "Family name = $(font_family), Weight = ($weight)"
         for (auto current = defaultLabel.begin(); current != defaultLabel.end();)
         {
@@ -1062,11 +1097,10 @@ void DrawableObject::GenerateLabel(IAttributeSource& attributeSource, _Out_ std:
                 if (endOfEscape == defaultLabel.end())
                     break;
 
-                fieldName.assign(next, endOfEscape);
-                auto nameMapResult = attributeNameMap.find(fieldName);
-                if (nameMapResult != attributeNameMapEnd)
+                DrawableObjectAttribute attributeId = FindAttribute({next, endOfEscape});
+                if (attributeId != DrawableObjectAttributeTotal)
                 {
-                    array_ref<char16_t const> text = attributeSource.GetString(DrawableObjectAttribute(nameMapResult->second));
+                    array_ref<char16_t const> text = attributeSource.GetString(attributeId);
                     label.append(text.begin(), text.end());
                 }
                 next = endOfEscape + 1; // Skip ')'.
@@ -1211,7 +1245,7 @@ HRESULT DrawableObject::GetDWriteFontFace(
     else
     {
         CachedDWriteFontFace dwriteFontFace;
-        IFR(dwriteFontFace.Update(attributeSource, drawingCanvas));
+        IFR(dwriteFontFace.EnsureCached(attributeSource, drawingCanvas));
         *fontFace = dwriteFontFace.fontFace.Detach();
     }
 
@@ -1408,6 +1442,9 @@ public:
 
 HRESULT CachedGdiFont::EnsureCached(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas)
 {
+    if (!font.IsNull())
+        return S_OK;
+
     float fontSize = attributeSource.GetValue(DrawableObjectAttributeFontSize, DrawableObject::defaultFontSize);
 
     array_ref<char16_t const> familyName = attributeSource.GetString(DrawableObjectAttributeFontFamily);
@@ -1461,6 +1498,18 @@ HRESULT CachedGdiFont::EnsureCached(IAttributeSource& attributeSource, DrawingCa
 }
 
 
+HRESULT DrawableObjectGdiTextOut::Update(
+    IAttributeSource& attributeSource,
+    DrawableObjectAttributeMask changedAttributes,
+    _Out_ DrawableObjectCaches& invalidatedCaches
+    )
+{
+    invalidatedCaches = DrawableObjectCachesNone;
+    InvalidateIfChanged(font_, DrawableObjectDependenciesGdiFont, DrawableObjectCachesGdiFont, changedAttributes, IN OUT invalidatedCaches);
+    return S_OK;
+}
+
+
 HRESULT DrawableObjectGdiTextOut::GetBounds(
     IAttributeSource& attributeSource,
     DrawingCanvas& drawingCanvas,
@@ -1576,6 +1625,18 @@ HRESULT DrawableObjectGdiTextOut::Draw(
 }
 
 
+HRESULT DrawableObjectUser32DrawText::Update(
+    IAttributeSource& attributeSource,
+    DrawableObjectAttributeMask changedAttributes,
+    _Out_ DrawableObjectCaches& invalidatedCaches
+    )
+{
+    invalidatedCaches = DrawableObjectCachesNone;
+    InvalidateIfChanged(font_, DrawableObjectDependenciesGdiFont, DrawableObjectCachesGdiFont, changedAttributes, IN OUT invalidatedCaches);
+    return S_OK;
+}
+
+
 HRESULT DrawableObjectUser32DrawText::GetBounds(
     IAttributeSource& attributeSource,
     DrawingCanvas& drawingCanvas,
@@ -1871,24 +1932,12 @@ void GetFontAxisValues(
 }
 
 
-HRESULT CachedDWriteFontFace::Update(
+HRESULT CachedDWriteFontFace::EnsureCached(
     IAttributeSource& attributeSource,
     DrawingCanvas& drawingCanvas
     )
 {
-    // Invalidate the cached face.
-    if (attributeSource.IsCookieSame(DrawableObjectAttributeFontFilePath, IN OUT cookieFontFilePath)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeFontFamily, IN OUT cookieFamilyName)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeWeight, IN OUT cookieWeight)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeStretch, IN OUT cookieStretch)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeSlope, IN OUT cookieSlope)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeFontSimulations, IN OUT cookieFontSimulations)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeFontFaceIndex, IN OUT cookieFontFaceIndex)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeDWriteFontFaceType, IN OUT cookieDWriteFontFaceType)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeAxisTags, IN OUT cookieAxisTags)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeAxisValues, IN OUT cookieAxisValues)
-    &   (fontFace != nullptr)
-        )
+    if (fontFace != nullptr)
     {
         return S_OK;
     }
@@ -1960,12 +2009,9 @@ HRESULT CachedDWriteFontFace::Update(
 }
 
 
-HRESULT CachedDWriteRenderingParams::Update(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas)
+HRESULT CachedDWriteRenderingParams::EnsureCached(IAttributeSource& attributeSource, DrawingCanvas& drawingCanvas)
 {
-    // Invalidate the cached rendering params.
-    if (attributeSource.IsCookieSame(DrawableObjectAttributeDWriteRenderingMode, IN OUT cookieRenderingMode)
-    &   attributeSource.IsCookieSame(DrawableObjectAttributeDWriteGridFitMode, IN OUT cookieGridFitMode)
-    &   (renderingParams != nullptr))
+    if (renderingParams != nullptr)
     {
         return S_OK;
     }
@@ -2417,6 +2463,19 @@ HRESULT CachedDWriteTextLayout::EnsureCached(
 };
 
 
+HRESULT DrawableObjectDWriteGlyphRun::Update(
+    IAttributeSource& attributeSource,
+    DrawableObjectAttributeMask changedAttributes,
+    _Out_ DrawableObjectCaches& invalidatedCaches
+    )
+{
+    invalidatedCaches = DrawableObjectCachesNone;
+    InvalidateIfChanged(fontFace_, DrawableObjectDependenciesDWriteFontFace, DrawableObjectCachesDWriteFontFace, changedAttributes, IN OUT invalidatedCaches);
+    InvalidateIfChanged(renderingParams_, DrawableObjectDependenciesDWriteRenderingParams, DrawableObjectCachesDWriteRenderingParams, changedAttributes, IN OUT invalidatedCaches);
+    return S_OK;
+}
+
+
 HRESULT DrawableObjectDWriteGlyphRun::GetBounds(
     IAttributeSource& attributeSource,
     DrawingCanvas& drawingCanvas,
@@ -2426,7 +2485,7 @@ HRESULT DrawableObjectDWriteGlyphRun::GetBounds(
 {
     layoutBounds = emptyRect;
 
-    IFR(fontFace_.Update(attributeSource, drawingCanvas));
+    IFR(fontFace_.EnsureCached(attributeSource, drawingCanvas));
 
     CachedDWriteGlyphRun cachedGlyphRun;
     IFR(cachedGlyphRun.Update(attributeSource, drawingCanvas, fontFace_.fontFace));
@@ -2498,8 +2557,8 @@ HRESULT DrawableObjectDWriteBitmapRenderTargetDrawGlyphRun::Draw(
     DX_MATRIX_3X2F const& transform
     )
 {
-    IFR(fontFace_.Update(attributeSource, drawingCanvas));
-    IFR(renderingParams_.Update(attributeSource, drawingCanvas));
+    IFR(fontFace_.EnsureCached(attributeSource, drawingCanvas));
+    IFR(renderingParams_.EnsureCached(attributeSource, drawingCanvas));
     CachedDWriteGlyphRun cachedGlyphRun;
     IFR(cachedGlyphRun.Update(attributeSource, drawingCanvas, fontFace_.fontFace));
 
@@ -2557,8 +2616,8 @@ HRESULT DrawableObjectDirect2DDrawGlyphRun::Draw(
     DX_MATRIX_3X2F const& transform
     )
 {
-    IFR(fontFace_.Update(attributeSource, drawingCanvas));
-    IFR(renderingParams_.Update(attributeSource, drawingCanvas));
+    IFR(fontFace_.EnsureCached(attributeSource, drawingCanvas));
+    IFR(renderingParams_.EnsureCached(attributeSource, drawingCanvas));
     CachedDWriteGlyphRun cachedGlyphRun;
     IFR(cachedGlyphRun.Update(attributeSource, drawingCanvas, fontFace_.fontFace));
 
@@ -2667,7 +2726,7 @@ HRESULT DrawableObjectDirect2DDrawColorBitmapGlyphRun::Draw(
 {
     ////////////////////
     // Get the glyph run.
-    IFR(fontFace_.Update(attributeSource, drawingCanvas));
+    IFR(fontFace_.EnsureCached(attributeSource, drawingCanvas));
     CachedDWriteGlyphRun cachedGlyphRun;
     IFR(cachedGlyphRun.Update(attributeSource, drawingCanvas, fontFace_.fontFace));
     if (cachedGlyphRun.glyphIndices == nullptr)
@@ -2734,7 +2793,7 @@ HRESULT DrawableObjectDirect2DDrawSvgGlyphRun::Draw(
 {
     ////////////////////
     // Get the glyph run.
-    IFR(fontFace_.Update(attributeSource, drawingCanvas));
+    IFR(fontFace_.EnsureCached(attributeSource, drawingCanvas));
     CachedDWriteGlyphRun cachedGlyphRun;
     IFR(cachedGlyphRun.Update(attributeSource, drawingCanvas, fontFace_.fontFace));
     if (cachedGlyphRun.glyphIndices == nullptr)
@@ -2780,12 +2839,16 @@ HRESULT DrawableObjectDirect2DDrawSvgGlyphRun::Draw(
 
 
 HRESULT DrawableObjectDWriteTextLayout::Update(
-    IAttributeSource& attributeSource
+    IAttributeSource& attributeSource,
+    DrawableObjectAttributeMask changedAttributes,
+    _Out_ DrawableObjectCaches& invalidatedCaches
     )
 {
-    // Clear cached values.
-    textFormat_.Invalidate();
-    textLayout_.Invalidate();
+    // Clear cached values created from changed attributes.
+    invalidatedCaches = DrawableObjectCachesNone;
+    InvalidateIfChanged(textFormat_, DrawableObjectDependenciesDWriteTextFormat, DrawableObjectCachesDWriteTextFormat, changedAttributes, IN OUT invalidatedCaches);
+    InvalidateIfChanged(textLayout_, DrawableObjectDependenciesDWriteTextLayout, DrawableObjectCachesDWriteTextLayout, changedAttributes, IN OUT invalidatedCaches);
+    InvalidateIfChanged(renderingParams_, DrawableObjectDependenciesDWriteRenderingParams, DrawableObjectCachesDWriteRenderingParams, changedAttributes, IN OUT invalidatedCaches);
     return S_OK;
 }
 
@@ -2837,7 +2900,7 @@ HRESULT DrawableObjectDWriteBitmapRenderTargetLayoutDraw::Draw(
 {
     IFR(textFormat_.EnsureCached(attributeSource, drawingCanvas));
     IFR(textLayout_.EnsureCached(attributeSource, drawingCanvas, textFormat_.textFormat));
-    IFR(renderingParams_.Update(attributeSource, drawingCanvas));
+    IFR(renderingParams_.EnsureCached(attributeSource, drawingCanvas));
 
     // Set color.
     uint32_t bgraTextColor = attributeSource.GetValue(DrawableObjectAttributeTextColor, defaultFontColor);
@@ -2883,7 +2946,7 @@ HRESULT DrawableObjectDirect2DDrawText::Draw(
     )
 {
     IFR(textFormat_.EnsureCached(attributeSource, drawingCanvas));
-    IFR(renderingParams_.Update(attributeSource, drawingCanvas));
+    IFR(renderingParams_.EnsureCached(attributeSource, drawingCanvas));
 
     // Set color.
     auto* brush = drawingCanvas.GetD2DBrushWeakRef();
@@ -3208,10 +3271,15 @@ HRESULT CachedGdiPlusFont::EnsureCached(IAttributeSource& attributeSource, Drawi
 };
 
 
-HRESULT DrawableObjectGdiPlusDrawString::Update(IAttributeSource& attributeSource)
+HRESULT DrawableObjectGdiPlusDrawString::Update(
+    IAttributeSource& attributeSource,
+    DrawableObjectAttributeMask changedAttributes,
+    _Out_ DrawableObjectCaches& invalidatedCaches
+    )
 {
-    cachedStringFormat_.Invalidate();
-    cachedFont_.Invalidate();
+    invalidatedCaches = DrawableObjectCachesNone;
+    InvalidateIfChanged(cachedStringFormat_, DrawableObjectDependenciesGdiPlusStringFormat, DrawableObjectCachesGdiPlusStringFormat, changedAttributes, IN OUT invalidatedCaches);
+    InvalidateIfChanged(cachedFont_, DrawableObjectDependenciesGdiPlusFont, DrawableObjectCachesGdiPlusFont, changedAttributes, IN OUT invalidatedCaches);
     return S_OK;
 }
 
@@ -3301,9 +3369,14 @@ HRESULT DrawableObjectGdiPlusDrawString::Draw(
 }
 
 
-HRESULT DrawableObjectGdiPlusDrawDriverString::Update(IAttributeSource& attributeSource)
+HRESULT DrawableObjectGdiPlusDrawDriverString::Update(
+    IAttributeSource& attributeSource,
+    DrawableObjectAttributeMask changedAttributes,
+    _Out_ DrawableObjectCaches& invalidatedCaches
+    )
 {
-    cachedFont_.Invalidate();
+    invalidatedCaches = DrawableObjectCachesNone;
+    InvalidateIfChanged(cachedFont_, DrawableObjectDependenciesGdiPlusFont, DrawableObjectCachesGdiPlusFont, changedAttributes, IN OUT invalidatedCaches);
     return S_OK;
 }
 
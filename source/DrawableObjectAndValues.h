@@ -29,18 +29,18 @@ public:
     CachedTransform transform_; // Transform from world coordinates to screen.
     D2D_POINT_2F origin_;       // Offset from <0,0>. May be non-zero if rotation exists or content is larger than layout.
     Flags flags_;
+    DrawableObjectAttributeMask changedAttributes_ = DrawableObjectAttributeMaskAll; // Attributes set since the last Update.
+    uint64_t modificationGeneration_ = 0; // Stamp of the last attribute change, unique across all objects but kept by copies, so equal stamps mean equal values.
 
 public:
     DrawableObjectAndValues();
     DrawableObjectAndValues(DrawableObjectAndValues const&) = default;
 
     // IAttributeSource implementation.
-    virtual HRESULT GetString(uint32_t id, _Out_ array_ref<char16_t>& value) override;
+    virtual HRESULT GetString(uint32_t id, _Out_ array_ref<char16_t const>& value) override;
     using IAttributeSource::GetString;
 
-    virtual HRESULT GetValueData(uint32_t id, _Out_ Attribute::Type& type, _Out_ array_ref<uint8_t>& value) override;
-
-    virtual HRESULT GetCookie(uint32_t id, _Inout_ uint32_t& cookieValue);
+    virtual HRESULT GetValueData(uint32_t id, _Out_ Attribute::Type& type, _Out_ array_ref<uint8_t const>& value) override;
 
 public:
     //////////
@@ -48,12 +48,28 @@ public:
 
     HRESULT Set(DrawableObjectAttribute attributeIndex, _In_z_ char16_t const* stringValue);
 
+    // Reuses the number decoded by the parser where the attribute allows,
+    // rather than parsing the string again.
+    HRESULT Set(DrawableObjectAttribute attributeIndex, _In_z_ char16_t const* stringValue, TextTree::NodeNumber const& number);
+
     HRESULT Set(DrawableObjectAttribute attributeIndex, _In_z_ uint32_t value);
 
+    // Copies a value already parsed, sharing its storage, rather than
+    // parsing its string again.
+    HRESULT Set(DrawableObjectAttribute attributeIndex, AttributeValue const& value);
+
     // Call after setting string values (not every single set call, but before Draw).
     // This creates the drawableObject if not already created and forwards the call
-    // to the internal drawableObject::Update.
-    void Update();
+    // to the internal drawableObject::Update with the attributes changed since
+    // the last call. Returns which of its caches were invalidated.
+    DrawableObjectCaches Update();
+
+    // The two halves of Update. Creating the drawable object and generating
+    // the label only read the attribute values, so different objects may do
+    // this on different threads. Updating the caches releases any resources
+    // created from changed attributes, so it stays on the calling thread.
+    void UpdateObjectAndLabel();
+    DrawableObjectCaches UpdateCaches();
 
     // Call when copying from an existing one.
     void Invalidate();
@@ -93,12 +109,22 @@ public:
         );
 
     // Update the given drawable objects. This is usually called after a series
-    // of SetStringValue calls.
-    static void Update(
+    // of SetStringValue calls. Each index should be listed only once, since
+    // the objects are updated like the batched Update below.
+    // Returns the union of the invalidated caches.
+    static DrawableObjectCaches Update(
         array_ref<DrawableObjectAndValues> drawableObjects,
         array_ref<uint32_t const> drawableObjectsIndices
         );
 
+    // Update a batch of drawable objects, such as after loading them. Large
+    // batches run UpdateObjectAndLabel in chunks on the process thread pool,
+    // then update the caches in order on the calling thread. Resources are
+    // still created on demand when the objects are arranged or drawn. The
+    // objects must not share a drawable object (copies of a shared object
+    // should call Invalidate first).
+    static DrawableObjectCaches Update(array_ref<DrawableObjectAndValues> drawableObjects);
+
     // Get the appropriate string value for the given attribute index across
     // multiple objects. If the values are consistent across all interested
     // objects, return that value. Otherwise return the default string.
@@ -109,8 +135,34 @@ public:
         _In_z_ char16_t const* defaultStringIfMixedValues // What to return if values are mixed between the objects.
         );
 
+    // Load the objects list. In settings files, the first object holds the
+    // attributes shared by all the others rather than being drawn, but other
+    // sources (like CSV rows) may have only drawable objects.
     static void Load(
         TextTree::NodePointer node,
+        _Inout_ std::vector<DrawableObjectAndValues>& drawableObjects,
+        bool isFirstObjectShared = true
+        );
+
+    // Load directly from the parser's events, without building a tree. The
+    // parser should have just returned the begin event of the objects list,
+    // and it reads through the list's matching end event. For a CsvParser,
+    // whose rows are the objects, it should not have read anything yet.
+    static void Load(
+        TextTreeParser& parser,
+        _Inout_ std::vector<DrawableObjectAndValues>& drawableObjects,
+        bool isFirstObjectShared = true
+        );
+
+    // Reload just the given range of drawable objects from the objects list,
+    // after rereading their nodes (see TextTreeParser::ReparseNodes). The old
+    // drawable objects are replaced by the new ones, and only those updated.
+    // Drawable object 0 is the second object node, after the shared one.
+    static void Reload(
+        TextTree::NodePointer objectsNode,
+        uint32_t drawableObjectIndex,
+        uint32_t oldDrawableObjectCount,
+        uint32_t newDrawableObjectCount,
         _Inout_ std::vector<DrawableObjectAndValues>& drawableObjects
         );
 
@@ -64,6 +64,69 @@ namespace
     static const COLORREF s_defaultLabelTextColor = 0x00FFFFFF;
     static const COLORREF s_defaultErrorTextColor = 0x004040FF;
     static const COLORREF s_defaultLabelBackColor = 0x00805050;
+    static std::atomic<uint64_t> s_lastModificationGeneration = 0;
+
+    // Maps the interned key ids of a single tree or parser to attributes, so
+    // that each distinct key name is only looked up by string once.
+    class AttributeKeyIdMap
+    {
+    public:
+        // Returns false if the key name has not been resolved yet.
+        bool TryGetAttribute(uint32_t keyId, _Out_ DrawableObjectAttribute& attributeId) const noexcept
+        {
+            attributeId = (keyId < attributeIds_.size()) ? attributeIds_[keyId] : AttributeIdUnresolved;
+            return attributeId != AttributeIdUnresolved;
+        }
+
+        DrawableObjectAttribute ResolveAttribute(uint32_t keyId, array_ref<char16_t const> keyName)
+        {
+            auto attributeId = DrawableObject::FindAttribute(keyName);
+            if (keyId != TextTree::InvalidKeyId)
+            {
+                if (keyId >= attributeIds_.size())
+                {
+                    attributeIds_.resize(keyId + 1, AttributeIdUnresolved);
+                }
+                attributeIds_[keyId] = attributeId;
+            }
+            return attributeId;
+        }
+
+    private:
+        static constexpr DrawableObjectAttribute AttributeIdUnresolved = DrawableObjectAttribute(DrawableObjectAttributeTotal + 1);
+        std::vector<DrawableObjectAttribute> attributeIds_; // Key id -> attribute, or DrawableObjectAttributeTotal if none.
+    };
+
+    bool IsSameString(AttributeValue const& value, _In_z_ char16_t const* stringValue)
+    {
+        auto currentString = value.GetString();
+        return std::u16string_view(currentString.data(), currentString.size()) == stringValue;
+    }
+
+    // Read all key value pairs of the object node, setting object properties.
+    void SetAttributesFromObjectNode(
+        TextTree::NodePointer objectNode,
+        _Inout_ AttributeKeyIdMap& attributeKeyIdMap,
+        _Inout_ DrawableObjectAndValues& drawableObject
+        )
+    {
+        for (TextTree::NodePointer node = objectNode.begin(), nodeEnd = objectNode.end(); node != nodeEnd; ++node)
+        {
+            uint32_t keyId = node.GetKeyId();
+            DrawableObjectAttribute id;
+            if (!attributeKeyIdMap.TryGetAttribute(keyId, OUT id))
+            {
+                id = attributeKeyIdMap.ResolveAttribute(keyId, node.GetText());
+            }
+            if (id != DrawableObjectAttributeTotal)
+            {
+                std::u16string value = node.GetSubvalue();
+                TextTree::NodeNumber number;
+                node.GetSubvalueNumber(OUT number);
+                drawableObject.Set(id, value.c_str(), number);
+            }
+        }
+    }
 }
 
 
@@ -442,21 +505,16 @@ void DrawableObjectAndValues::Arrange(
 
 void DrawableObjectAndValues::Load(
     TextTree::NodePointer objectsNode,
-    _Inout_ std::vector<DrawableObjectAndValues>& drawableObjects
+    _Inout_ std::vector<DrawableObjectAndValues>& drawableObjects,
+    bool isFirstObjectShared
     )
 {
     DrawableObjectAndValues sharedDrawableObject;
-    bool isFirstObject = true;
+    AttributeKeyIdMap attributeKeyIdMap;
+    bool isFirstObject = isFirstObjectShared;
 
     // The node points to the beginning of the objects list.
 
-    std::map<std::u16string, uint32_t> attributeNameMap;
-    for (auto const& attribute : DrawableObject::attributeList)
-    {
-        attributeNameMap[attribute.name] = attribute.id;
-    }
-    auto attributeNameMapEnd = attributeNameMap.end();
-
     size_t oldDrawableObjectsSize = drawableObjects.size();
 
     for (TextTree::NodePointer objectNode = objectsNode.begin(), objectNodeEnd = objectsNode.end(); objectNode != objectNodeEnd; ++objectNode)
@@ -472,29 +530,178 @@ void DrawableObjectAndValues::Load(
         DrawableObjectAndValues& drawableObject = isFirstObject ? sharedDrawableObject : drawableObjects.back();
         isFirstObject = false;
 
-        // Read all key value pairs, setting new object properties.
-        for (TextTree::NodePointer node = objectNode.begin(), nodeEnd = objectNode.end(); node != nodeEnd; ++node)
+        SetAttributesFromObjectNode(objectNode, IN OUT attributeKeyIdMap, IN OUT drawableObject);
+    }
+
+    size_t newDrawableObjectsSize = drawableObjects.size();
+
+    // Update all the newly created objects, now that their attribute strings have been set.
+    // Invalidating first gives each copy of the shared object its own drawable object.
+    for (auto& drawableObject : make_iterator_range(drawableObjects.data(), oldDrawableObjectsSize, newDrawableObjectsSize))
+    {
+        drawableObject.Invalidate();
+    }
+    Update(make_array_ref(drawableObjects.data() + oldDrawableObjectsSize, drawableObjects.data() + newDrawableObjectsSize));
+}
+
+
+void DrawableObjectAndValues::Load(
+    TextTreeParser& parser,
+    _Inout_ std::vector<DrawableObjectAndValues>& drawableObjects,
+    bool isFirstObjectShared
+    )
+{
+    DrawableObjectAndValues sharedDrawableObject;
+    DrawableObjectAndValues* drawableObject = nullptr;
+    AttributeKeyIdMap attributeKeyIdMap;
+    bool isFirstObject = isFirstObjectShared;
+
+    size_t oldDrawableObjectsSize = drawableObjects.size();
+
+    // The parser just began the objects list, so a depth of 0 is directly
+    // within the list, 1 within an object, and 2 within an object's key.
+    TextTreeParser::EventType eventType;
+    TextTree::Node node;
+    array_ref<char16_t const> nodeText;
+    std::u16string value;
+    TextTree::NodeNumber valueNumber = {};
+    uint32_t depth = 0;
+    DrawableObjectAttribute attributeId = DrawableObjectAttributeTotal;
+    bool hasValue = false;
+    bool isSingleValue = false;
+
+    while (parser.ReadEvent(/*out*/ eventType, /*out*/ node, /*out*/ nodeText))
+    {
+        if (eventType == TextTreeParser::EventTypeEndNode)
         {
-            std::u16string text = node.GetText();
-            std::u16string value = node.GetSubvalue();
+            if (depth == 0)
+                break; // End of the objects list.
 
-            auto nameMapResult = attributeNameMap.find(text);
-            if (nameMapResult != attributeNameMapEnd)
+            // Set the attribute once its key ends, same as the tree's
+            // GetSubvalue, only using the value if it was the only one.
+            if (--depth == 1 && attributeId != DrawableObjectAttributeTotal)
             {
-                auto id = DrawableObjectAttribute(nameMapResult->second);
-                drawableObject.Set(id, value.c_str());
+                if (!hasValue || !isSingleValue)
+                {
+                    value.clear();
+                    valueNumber = {};
+                }
+
+                drawableObject->Set(attributeId, value.c_str(), valueNumber);
             }
+            continue;
+        }
+
+        auto genericType = node.GetGenericType();
+
+        if (depth == 0)
+        {
+            // The very first object is the shared object of attributes common
+            // to all objects, just like the tree loading above.
+            if (!isFirstObject)
+            {
+                drawableObjects.push_back(sharedDrawableObject);
+            }
+            drawableObject = isFirstObject ? &sharedDrawableObject : &drawableObjects.back();
+            isFirstObject = false;
+        }
+        else if (depth == 1)
+        {
+            const uint32_t keyId = parser.GetEventKeyId();
+            if (!attributeKeyIdMap.TryGetAttribute(keyId, OUT attributeId))
+            {
+                attributeId = attributeKeyIdMap.ResolveAttribute(keyId, nodeText);
+            }
+            value.clear();
+            valueNumber = {};
+            hasValue = false;
+            isSingleValue = true;
+
+            // A plain value has no subvalue, so clear the attribute now.
+            if (eventType == TextTreeParser::EventTypeValue && attributeId != DrawableObjectAttributeTotal)
+            {
+                drawableObject->Set(attributeId, u"");
+            }
+        }
+        else if (depth == 2 && genericType == TextTree::Node::TypeValue && !hasValue)
+        {
+            value.assign(nodeText.begin(), nodeText.end());
+            parser.GetEventNumber(OUT valueNumber);
+            hasValue = true;
+        }
+        else if (hasValue ? (genericType != TextTree::Node::TypeComment && genericType != TextTree::Node::TypeIgnorable)
+                          : depth != 2)
+        {
+            isSingleValue = false; // Nested children before the value, or more than one value.
+        }
+
+        if (eventType == TextTreeParser::EventTypeBeginNode)
+        {
+            ++depth;
         }
     }
 
     size_t newDrawableObjectsSize = drawableObjects.size();
 
     // Update all the newly created objects, now that their attribute strings have been set.
-    for (auto& drawableObject : make_iterator_range(drawableObjects.data(), oldDrawableObjectsSize, newDrawableObjectsSize))
+    // Invalidating first gives each copy of the shared object its own drawable object.
+    for (auto& newDrawableObject : make_iterator_range(drawableObjects.data(), oldDrawableObjectsSize, newDrawableObjectsSize))
+    {
+        newDrawableObject.Invalidate();
+    }
+    Update(make_array_ref(drawableObjects.data() + oldDrawableObjectsSize, drawableObjects.data() + newDrawableObjectsSize));
+}
+
+
+void DrawableObjectAndValues::Reload(
+    TextTree::NodePointer objectsNode,
+    uint32_t drawableObjectIndex,
+    uint32_t oldDrawableObjectCount,
+    uint32_t newDrawableObjectCount,
+    _Inout_ std::vector<DrawableObjectAndValues>& drawableObjects
+    )
+{
+    assert(drawableObjectIndex + oldDrawableObjectCount <= drawableObjects.size());
+
+    // Every object starts from the shared first object, as in Load.
+    TextTree::NodePointer objectNode = objectsNode.begin();
+    TextTree::NodePointer objectNodeEnd = objectsNode.end();
+    DrawableObjectAndValues sharedDrawableObject;
+    AttributeKeyIdMap attributeKeyIdMap;
+    if (objectNode != objectNodeEnd)
+    {
+        SetAttributesFromObjectNode(objectNode, IN OUT attributeKeyIdMap, IN OUT sharedDrawableObject);
+        ++objectNode;
+    }
+
+    for (uint32_t i = 0; i < drawableObjectIndex && objectNode != objectNodeEnd; ++i)
+    {
+        ++objectNode;
+    }
+
+    std::vector<DrawableObjectAndValues> newDrawableObjects;
+    newDrawableObjects.reserve(newDrawableObjectCount);
+    for (uint32_t i = 0; i < newDrawableObjectCount && objectNode != objectNodeEnd; ++i, ++objectNode)
+    {
+        newDrawableObjects.push_back(sharedDrawableObject);
+        SetAttributesFromObjectNode(objectNode, IN OUT attributeKeyIdMap, IN OUT newDrawableObjects.back());
+    }
+
+    // Replace the old objects, and update only the new ones.
+    auto oldDrawableObjectsBegin = drawableObjects.begin() + drawableObjectIndex;
+    drawableObjects.erase(oldDrawableObjectsBegin, oldDrawableObjectsBegin + oldDrawableObjectCount);
+    drawableObjects.insert(
+        drawableObjects.begin() + drawableObjectIndex,
+        std::make_move_iterator(newDrawableObjects.begin()),
+        std::make_move_iterator(newDrawableObjects.end())
+        );
+
+    auto reloadedDrawableObjects = make_array_ref(drawableObjects.data() + drawableObjectIndex, newDrawableObjects.size());
+    for (auto& drawableObject : reloadedDrawableObjects)
     {
         drawableObject.Invalidate();
-        drawableObject.Update();
     }
+    Update(reloadedDrawableObjects);
 }
 
 
@@ -506,20 +713,20 @@ void DrawableObjectAndValues::Merge(
     for (uint32_t attributeId = 0; attributeId < countof(DrawableObject::attributeList); ++attributeId)
     {
         AttributeValue const& newValue = overridingDrawableObject.values_[attributeId];
-        if (newValue.stringValue.empty())
+        if (newValue.GetString().empty())
             continue;
 
         for (auto& drawableObject : drawableObjects)
         {
-            drawableObject.Set(DrawableObjectAttribute(attributeId), newValue.stringValue.c_str());
+            drawableObject.Set(DrawableObjectAttribute(attributeId), newValue);
         }
     }
 
     for (auto& drawableObject : drawableObjects)
     {
         drawableObject.Invalidate();
-        drawableObject.Update();
     }
+    Update(drawableObjects);
 }
 
 
@@ -531,12 +738,12 @@ void StoreDrawableObject(
 {
     for (uint32_t attributeId = 0; attributeId < countof(DrawableObject::attributeList); ++attributeId)
     {
-        AttributeValue const& value = drawableObject.values_[attributeId];
-        if (value.stringValue.empty())
+        array_ref<char16_t const> valueString = drawableObject.values_[attributeId].GetString();
+        if (valueString.empty())
             continue; // Don't store empty strings in the settings file.
 
         if (sharedDrawableObject != nullptr
-        &&  sharedDrawableObject->values_[attributeId].stringValue == value.stringValue)
+        &&  sharedDrawableObject->values_[attributeId].GetString() == valueString)
         {
             continue; // Skip this attribute since it's identical to the shared object.
         }
@@ -544,8 +751,8 @@ void StoreDrawableObject(
         Attribute const& attribute = DrawableObject::attributeList[attributeId];
         objectNode.SetKeyValue(
             attribute.name,
-            value.stringValue.c_str(),
-            static_cast<uint32_t>(value.stringValue.size())
+            valueString.data(),
+            static_cast<uint32_t>(valueString.size())
             );
     }
 }
@@ -565,10 +772,10 @@ void DrawableObjectAndValues::Store(
         {
             // Find all attributes that are shared between drawable objects.
             // That way we can store them just once in the settings file.
-            array_ref<char16_t> previousValueData;
+            array_ref<char16_t const> previousValueData;
             for (auto& drawableObject : drawableObjects)
             {
-                array_ref<char16_t> valueData = drawableObject.values_[attributeId].stringValue;
+                array_ref<char16_t const> valueData = drawableObject.values_[attributeId].GetString();
                 if (previousValueData.empty())
                 {
                     // Keep track if the first time.
@@ -604,7 +811,14 @@ void DrawableObjectAndValues::Store(
 }
 
 
-void DrawableObjectAndValues::Update()
+DrawableObjectCaches DrawableObjectAndValues::Update()
+{
+    UpdateObjectAndLabel();
+    return UpdateCaches();
+}
+
+
+void DrawableObjectAndValues::UpdateObjectAndLabel()
 {
     // Create the drawable object on demand.
     if (drawableObject_ == nullptr)
@@ -614,15 +828,135 @@ void DrawableObjectAndValues::Update()
     }
 
     DrawableObject::GenerateLabel(*this, IN OUT label_);
+}
 
+
+DrawableObjectCaches DrawableObjectAndValues::UpdateCaches()
+{
+    DrawableObjectCaches invalidatedCaches = DrawableObjectCachesNone;
     if (drawableObject_ != nullptr)
     {
-        drawableObject_->Update(*this);
+        drawableObject_->Update(*this, changedAttributes_, OUT invalidatedCaches);
     }
+    changedAttributes_ = 0;
+
+    return invalidatedCaches;
+}
+
+
+namespace
+{
+    const uint32_t UpdateParallelMinimumChunkObjectCount = 256;
+    const uint32_t UpdateParallelChunksPerThread = 4; // Smaller chunks even out uneven objects.
+
+    // Calls a function for every index up to a count on the process thread
+    // pool, whose threads persist between calls, unlike threads started per
+    // call with std::async. Chunks of indices are claimed in turn by the pool
+    // callbacks and the calling thread alike, so the loop still finishes if
+    // no callback could be submitted. The first exception is rethrown on the
+    // calling thread once all callbacks have returned.
+    class ThreadPoolIndexLoop
+    {
+    public:
+        ThreadPoolIndexLoop(uint32_t count, std::function<void(uint32_t)>&& function)
+        :   count_(count),
+            function_(std::move(function))
+        {
+        }
+
+        void Run()
+        {
+            const uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+            const uint32_t chunkCount = std::min(threadCount * UpdateParallelChunksPerThread, count_ / UpdateParallelMinimumChunkObjectCount);
+            chunkSize_ = (chunkCount > 1) ? (count_ + chunkCount - 1) / chunkCount : std::max(count_, 1u);
+            const uint32_t callbackCount = (chunkCount > 1) ? std::min(threadCount, chunkCount) - 1 : 0; // This thread is one of them.
+
+            if (callbackCount > 0)
+            {
+                callbacksFinishedEvent_ = CreateEvent(nullptr, /*bManualReset*/ TRUE, /*bInitialState*/ FALSE, nullptr);
+            }
+            if (callbacksFinishedEvent_ != nullptr)
+            {
+                // Whoever brings the pending count to zero signals the event,
+                // including this thread if submissions failed.
+                pendingCallbackCount_ = callbackCount;
+                for (uint32_t i = 0; i < callbackCount; ++i)
+                {
+                    if (!TrySubmitThreadpoolCallback(&ThreadPoolIndexLoop::RunCallback, this, nullptr)
+                    &&  --pendingCallbackCount_ == 0)
+                    {
+                        SetEvent(callbacksFinishedEvent_);
+                    }
+                }
+            }
+
+            RunChunks();
+
+            if (callbacksFinishedEvent_ != nullptr)
+            {
+                WaitForSingleObject(callbacksFinishedEvent_, INFINITE);
+            }
+            if (exception_ != nullptr)
+            {
+                std::rethrow_exception(exception_);
+            }
+        }
+
+    private:
+        static void CALLBACK RunCallback(PTP_CALLBACK_INSTANCE instance, void* context)
+        {
+            // The event is only set once the callback has returned, after
+            // which the loop (on the waiting thread's stack) may be gone.
+            auto& loop = *static_cast<ThreadPoolIndexLoop*>(context);
+            loop.RunChunks();
+            if (--loop.pendingCallbackCount_ == 0)
+            {
+                SetEventWhenCallbackReturns(instance, loop.callbacksFinishedEvent_);
+            }
+        }
+
+        void RunChunks() noexcept
+        {
+            try
+            {
+                while (true)
+                {
+                    const uint32_t chunkBegin = nextIndex_.fetch_add(chunkSize_);
+                    if (chunkBegin >= count_)
+                        break;
+
+                    const uint32_t chunkEnd = std::min(count_, chunkBegin + chunkSize_);
+                    for (uint32_t i = chunkBegin; i < chunkEnd; ++i)
+                    {
+                        function_(i);
+                    }
+                }
+            }
+            catch (...)
+            {
+                // Keep the first one, and leave the remaining chunks unclaimed.
+                std::lock_guard<std::mutex> lock(exceptionMutex_);
+                if (exception_ == nullptr)
+                {
+                    exception_ = std::current_exception();
+                }
+                nextIndex_ = count_;
+            }
+        }
+
+        uint32_t count_;
+        uint32_t chunkSize_ = 0;
+        std::function<void(uint32_t)> function_;
+        std::atomic<uint32_t> nextIndex_ = 0;
+        std::atomic<uint32_t> pendingCallbackCount_ = 0;
+        EventHandle callbacksFinishedEvent_;
+        std::mutex exceptionMutex_;
+        std::exception_ptr exception_;
+    };
 }
 
 
-void DrawableObjectAndValues::Update(
+DrawableObjectCaches DrawableObjectAndValues::Update(
     array_ref<DrawableObjectAndValues> drawableObjects,
     array_ref<uint32_t const> drawableObjectsIndices
     )
@@ -631,8 +965,35 @@ void DrawableObjectAndValues::Update(
     for (uint32_t i : drawableObjectsIndices)
     {
         ThrowIf(i >= totalDrawableObjects, "Drawing object index is not consistent with internal array size!");
-        drawableObjects[i].Update();
     }
+
+    ThreadPoolIndexLoop(
+        static_cast<uint32_t>(drawableObjectsIndices.size()),
+        [&](uint32_t i) { drawableObjects[drawableObjectsIndices[i]].UpdateObjectAndLabel(); }
+        ).Run();
+
+    DrawableObjectCaches invalidatedCaches = DrawableObjectCachesNone;
+    for (uint32_t i : drawableObjectsIndices)
+    {
+        invalidatedCaches |= drawableObjects[i].UpdateCaches();
+    }
+    return invalidatedCaches;
+}
+
+
+DrawableObjectCaches DrawableObjectAndValues::Update(array_ref<DrawableObjectAndValues> drawableObjects)
+{
+    ThreadPoolIndexLoop(
+        static_cast<uint32_t>(drawableObjects.size()),
+        [&](uint32_t i) { drawableObjects[i].UpdateObjectAndLabel(); }
+        ).Run();
+
+    DrawableObjectCaches invalidatedCaches = DrawableObjectCachesNone;
+    for (auto& drawableObject : drawableObjects)
+    {
+        invalidatedCaches |= drawableObject.UpdateCaches();
+    }
+    return invalidatedCaches;
 }
 
 
@@ -655,7 +1016,7 @@ char16_t const* DrawableObjectAndValues::GetStringValue(
 
         auto const& drawableObject = drawableObjects[drawableObjectIndex];
         auto const& objectValue = drawableObject.values_[attributeIndex];
-        array_ref<char16_t const> currentString = objectValue.stringValue;
+        array_ref<char16_t const> currentString = objectValue.GetString();
         if (previousString.empty())
         {
             previousString = currentString;
@@ -699,13 +1060,12 @@ void DrawableObjectAndValues::Set(
         if (i == firstMatchingIndex)
         {
             // If the first index, set the new text and cache the numeric values too.
-            firstObjectValue.Set(DrawableObject::attributeList[attributeIndex], newText.c_str());
+            drawableObjectAndValues.Set(DrawableObjectAttribute(attributeIndex), newText.c_str());
         }
         else
         {
-            // Otherwise just copy what we already have.
-            auto& objectValue = drawableObjectAndValues.values_[attributeIndex];
-            objectValue = firstObjectValue;
+            // Otherwise just share what we already have.
+            drawableObjectAndValues.Set(DrawableObjectAttribute(attributeIndex), firstObjectValue);
         }
 
         // If the drawing function is being changed, then clear the old object.
@@ -722,8 +1082,7 @@ bool DrawableObjectAndValues::IsVisible() const
     if (drawableObject_ == nullptr)
         return false;
 
-    auto& mutableThis = const_cast<DrawableObjectAndValues&>(*this);
-    array_ref<uint8_t> data = mutableThis.values_[DrawableObjectAttributeVisibility].Get();
+    array_ref<uint8_t const> data = values_[DrawableObjectAttributeVisibility].Get();
     if (data.empty())
         return true;
     
@@ -745,10 +1104,60 @@ HRESULT DrawableObjectAndValues::Set(DrawableObjectAttribute attributeIndex, _In
         drawableObject_.clear();
     }
 
+    // Setting the same string again (like the text edit echoing the loaded
+    // text) leaves the object as it was.
+    if (!IsSameString(values_[attributeIndex], stringValue))
+    {
+        modificationGeneration_ = ++s_lastModificationGeneration;
+    }
+
+    changedAttributes_ |= DrawableObjectAttributeMaskOf(attributeIndex);
     return values_[attributeIndex].Set(DrawableObject::attributeList[attributeIndex], stringValue);
 }
 
 
+HRESULT DrawableObjectAndValues::Set(DrawableObjectAttribute attributeIndex, _In_z_ char16_t const* stringValue, TextTree::NodeNumber const& number)
+{
+    if (attributeIndex >= countof(values_))
+        return E_INVALIDARG;
+
+    if (attributeIndex == DrawableObjectAttributeFunction)
+    {
+        drawableObject_.clear();
+    }
+
+    if (!IsSameString(values_[attributeIndex], stringValue))
+    {
+        modificationGeneration_ = ++s_lastModificationGeneration;
+    }
+
+    changedAttributes_ |= DrawableObjectAttributeMaskOf(attributeIndex);
+    return values_[attributeIndex].Set(
+        DrawableObject::attributeList[attributeIndex],
+        stringValue,
+        (number.flags & TextTree::NodeNumber::FlagsInteger) ? &number.integerValue : nullptr,
+        (number.flags & TextTree::NodeNumber::FlagsFloat) ? &number.floatValue : nullptr
+        );
+}
+
+
+HRESULT DrawableObjectAndValues::Set(DrawableObjectAttribute attributeIndex, AttributeValue const& value)
+{
+    if (attributeIndex >= countof(values_))
+        return E_INVALIDARG;
+
+    if (attributeIndex == DrawableObjectAttributeFunction)
+    {
+        drawableObject_.clear();
+    }
+
+    modificationGeneration_ = ++s_lastModificationGeneration;
+    changedAttributes_ |= DrawableObjectAttributeMaskOf(attributeIndex);
+    values_[attributeIndex] = value;
+    return S_OK;
+}
+
+
 HRESULT DrawableObjectAndValues::Set(DrawableObjectAttribute attributeIndex, _In_z_ uint32_t value)
 {
     wchar_t buffer[12];
@@ -773,23 +1182,24 @@ bool DrawableObjectAndValues::IsPointInside(float x, float y) const
 }
 
 
-HRESULT DrawableObjectAndValues::GetString(uint32_t id, _Out_ array_ref<char16_t>& value)
+HRESULT DrawableObjectAndValues::GetString(uint32_t id, _Out_ array_ref<char16_t const>& value)
 {
     value.clear();
 
     if (id >= countof(values_))
         E_INVALIDARG;
 
-    value = values_[id].stringValue;
+    value = values_[id].GetString();
 
     return S_OK;
 }
 
 
-HRESULT DrawableObjectAndValues::GetValueData(uint32_t id, _Out_ Attribute::Type& type, _Out_ array_ref<uint8_t>& value)
+HRESULT DrawableObjectAndValues::GetValueData(uint32_t id, _Out_ Attribute::Type& type, _Out_ array_ref<uint8_t const>& value)
 {
     // Return a direct ranged pointer to the data, which may be found in the
-    // data field, dataArray, or stringValue, depending on attribute type.
+    // data field, the array after the string, or the string itself, depending
+    // on attribute type.
     // This function may be called often during drawing. So except for some
     // minor input checking, it needs to just return the value quickly.
 
@@ -804,15 +1214,3 @@ HRESULT DrawableObjectAndValues::GetValueData(uint32_t id, _Out_ Attribute::Type
 
     return S_OK;
 }
-
-
-HRESULT DrawableObjectAndValues::GetCookie(uint32_t id, _Inout_ uint32_t& cookieValue)
-{
-    cookieValue = 0;
-
-    if (id >= countof(values_))
-        E_INVALIDARG;
-
-    cookieValue = values_[id].cookieValue;
-    return S_OK;
-}
@@ -6,6 +6,7 @@
 #pragma once
 
 HRESULT ReadTextFile(const char16_t* filename, OUT std::u16string& text) noexcept; // Read UTF-8 or ASCII
+HRESULT ReadTextFileData(array_ref<uint8_t const> fileBytes, OUT std::u16string& text) noexcept; // Convert UTF-8 or ASCII file contents already in memory
 HRESULT WriteTextFile(const char16_t* filename, array_ref<char16_t const> text) noexcept;
 HRESULT WriteTextFile(const char16_t* filename, __in_ecount(textLength) const char16_t* text, uint32_t textLength) noexcept; // Write as UTF-8
 HRESULT ReadBinaryFile(const char16_t* filename, OUT std::vector<uint8_t>& fileBytes);
@@ -13,6 +14,51 @@ HRESULT WriteBinaryFile(const char16_t* filename, const std::vector<uint8_t>& fi
 HRESULT WriteBinaryFile(const char16_t* filename, array_ref<uint8_t const> fileData);
 HRESULT WriteBinaryFile(_In_z_ const char16_t* filename, _In_reads_bytes_(fileDataSize) const void* fileData, uint32_t fileDataSize);
 
+// Read-only view of an entire file mapped into memory, so that the contents
+// can be used without first copying them into an intermediate buffer.
+// The bytes remain valid until Close or destruction.
+class MappedFileView
+{
+public:
+    MappedFileView() = default;
+    MappedFileView(MappedFileView const&) = delete;
+    MappedFileView& operator=(MappedFileView const&) = delete;
+    ~MappedFileView();
+
+    HRESULT Open(_In_z_ const char16_t* filename) noexcept;
+    void Close() noexcept;
+    array_ref<uint8_t const> GetBytes() const noexcept;
+    uint64_t GetLastWriteTime() const noexcept; // FILETIME as a single integer.
+
+protected:
+    void const* view_ = nullptr;
+    size_t size_ = 0;
+    uint64_t lastWriteTime_ = 0;
+};
+
+// Convert the UTF-8 or ASCII contents of a mapped file. Unlike converting
+// the bytes directly, failing to read the file in (such as a network file
+// becoming unavailable) returns an error rather than raising an exception.
+HRESULT ReadTextFileData(MappedFileView const& fileView, OUT std::u16string& text) noexcept;
+
+// Writes a new file sequentially in pieces, so that large output need not
+// first be gathered into a single buffer. Close or destruction ends the file.
+class SequentialFileWriter
+{
+public:
+    SequentialFileWriter() = default;
+    SequentialFileWriter(SequentialFileWriter const&) = delete;
+    SequentialFileWriter& operator=(SequentialFileWriter const&) = delete;
+    ~SequentialFileWriter();
+
+    HRESULT Create(_In_z_ const char16_t* filename) noexcept;
+    HRESULT Write(array_ref<uint8_t const> data) noexcept;
+    void Close() noexcept;
+
+protected:
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+};
+
 std::u16string GetActualFileName(array_ref<const char16_t> fileName);
 std::u16string GetFullFileName(array_ref<const char16_t> fileName);
 
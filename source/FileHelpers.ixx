@@ -37,13 +37,90 @@
 
 ////////////////////////////////////////
 
+namespace
+{
+    // Reading a mapped view raises EXCEPTION_IN_PAGE_ERROR if the pages cannot
+    // be read in, where ReadFile would have returned an error. The text must
+    // already be large enough, so that nothing here needs unwinding.
+    HRESULT ConvertMappedTextFileData(array_ref<char const> fileData, IN OUT std::u16string& text) noexcept
+    {
+        __try
+        {
+            ConvertTextUtf8ToUtf16(fileData, OUT text);
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            text.clear();
+            return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+        }
+
+        return S_OK;
+    }
+}
+
+
 HRESULT ReadTextFile(const char16_t* filename, OUT std::u16string& text) noexcept
 {
-    unsigned long bytesRead;
-    std::vector<char> fileData;
+    ////////////////////
+    // Map the file rather than reading it into an intermediate buffer, so the
+    // only copy made is the UTF-16 text itself.
+
+    MappedFileView fileView;
+    IFR(fileView.Open(filename));
+    return ReadTextFileData(fileView, OUT text);
+}
+
+
+HRESULT ReadTextFileData(MappedFileView const& fileView, OUT std::u16string& text) noexcept
+{
+    auto fileData = fileView.GetBytes().reinterpret_as<char const>();
+
+    try
+    {
+        text.resize(fileData.size());
+    }
+    catch (...)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    return ConvertMappedTextFileData(fileData, IN OUT text);
+}
+
+
+HRESULT ReadTextFileData(array_ref<uint8_t const> fileBytes, OUT std::u16string& text) noexcept
+{
+    auto fileData = fileBytes.reinterpret_as<char const>();
+
+    try
+    {
+        text.resize(fileData.size());
+    }
+    catch (...)
+    {
+        return E_OUTOFMEMORY;
+    }
 
     ////////////////////
-    // Open the file handle, and read the contents.
+    // Convert UTF-8 to UTF-16. Note 'text' already has capacity at least
+    // equal to fileData. So no out-of-memory exceptions will occur.
+
+    assert(text.size() >= fileData.size());
+    ConvertTextUtf8ToUtf16(fileData, OUT text);
+
+    return S_OK;
+}
+
+
+MappedFileView::~MappedFileView()
+{
+    Close();
+}
+
+
+HRESULT MappedFileView::Open(_In_z_ const char16_t* filename) noexcept
+{
+    Close();
 
     HANDLE file = CreateFile(
                     ToWChar(filename),
@@ -61,36 +138,131 @@ HRESULT ReadTextFile(const char16_t* filename, OUT std::u16string& text) noexcep
         return HRESULT_FROM_WIN32(GetLastError());
     }
 
-    const unsigned long fileSize = GetFileSize(file, nullptr);
-    try
+    LARGE_INTEGER fileSize;
+    FILETIME lastWriteTime;
+    if (!GetFileSizeEx(file, OUT &fileSize)
+    ||  !GetFileTime(file, nullptr, nullptr, OUT &lastWriteTime))
     {
-        fileData.resize(fileSize);
-        text.resize(fileSize);
+        return HRESULT_FROM_WIN32(GetLastError());
     }
-    catch (...)
+    lastWriteTime_ = (uint64_t(lastWriteTime.dwHighDateTime) << 32) | lastWriteTime.dwLowDateTime;
+
+    if (uint64_t(fileSize.QuadPart) > SIZE_MAX)
     {
         return E_OUTOFMEMORY;
     }
+    if (fileSize.QuadPart == 0)
+    {
+        return S_OK; // Empty files cannot be mapped, but there is nothing to read anyway.
+    }
 
-    if (!ReadFile(file, OUT fileData.data(), fileSize, OUT &bytesRead, nullptr))
+    // The view keeps the section alive, so neither handle is needed afterward.
+    MemorySectionResource section(CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (section == nullptr)
     {
-        text.clear();
         return HRESULT_FROM_WIN32(GetLastError());
     }
 
-    scopedHandle.Clear();
+    view_ = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+    if (view_ == nullptr)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    size_ = static_cast<size_t>(fileSize.QuadPart);
 
-    ////////////////////
-    // Convert UTF-8 to UTF-16. Note 'text' already has capacity at least
-    // equal to fileData. So no out-of-memory exceptions will occur.
+    return S_OK;
+}
 
-    assert(text.size() >= fileData.size());
-    ConvertTextUtf8ToUtf16(fileData, OUT text);
+
+void MappedFileView::Close() noexcept
+{
+    if (view_ != nullptr)
+    {
+        UnmapViewOfFile(view_);
+    }
+    view_ = nullptr;
+    size_ = 0;
+    lastWriteTime_ = 0;
+}
+
+
+array_ref<uint8_t const> MappedFileView::GetBytes() const noexcept
+{
+    return array_ref<uint8_t const>(static_cast<uint8_t const*>(view_), size_);
+}
+
+
+uint64_t MappedFileView::GetLastWriteTime() const noexcept
+{
+    return lastWriteTime_;
+}
+
+
+SequentialFileWriter::~SequentialFileWriter()
+{
+    Close();
+}
+
+
+HRESULT SequentialFileWriter::Create(_In_z_ const char16_t* filename) noexcept
+{
+    Close();
+
+    file_ = CreateFile(
+                ToWChar(filename),
+                GENERIC_WRITE,
+                0, // No FILE_SHARE_READ
+                nullptr,
+                CREATE_ALWAYS,
+                FILE_FLAG_SEQUENTIAL_SCAN,
+                nullptr
+                );
+
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
 
     return S_OK;
 }
 
 
+HRESULT SequentialFileWriter::Write(array_ref<uint8_t const> data) noexcept
+{
+    if (file_ == INVALID_HANDLE_VALUE)
+        return E_HANDLE;
+
+    // WriteFile takes at most 4GB at once, and may write less than asked
+    // without failing (such as when the disk is full).
+    while (!data.empty())
+    {
+        unsigned long const byteCount = static_cast<unsigned long>(std::min<size_t>(data.size(), 0x80000000));
+        unsigned long bytesWritten;
+        if (!WriteFile(file_, data.data(), byteCount, OUT &bytesWritten, nullptr))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        if (bytesWritten == 0)
+        {
+            return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+        }
+        data.remove_prefix(bytesWritten);
+    }
+
+    return S_OK;
+}
+
+
+void SequentialFileWriter::Close() noexcept
+{
+    if (file_ != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file_);
+    }
+    file_ = INVALID_HANDLE_VALUE;
+}
+
+
 HRESULT WriteTextFile(
     const char16_t* filename,
     array_ref<char16_t const> text
@@ -96,9 +96,15 @@ public:
 
     void InitializeDefaultDrawableObjects();
     HRESULT LoadTextFileIntoDrawableObjects(_In_z_ char16_t const* filePath);
+    HRESULT LoadCsvFileIntoDrawableObjects(_In_z_ char16_t const* filePath, bool clearExistingItems = true);
     HRESULT StoreTextFileFromDrawableObjects(_In_z_ char16_t const* filePath);
     HRESULT LoadFontFileIntoDrawableObjects(_In_z_ char16_t const* filePath);
     HRESULT LoadDrawableObjectsSettings(_In_z_ char16_t const* filePath, bool clearExistingItems = true, bool merge = false);
+    HRESULT StreamDrawableObjectsSettings(_In_z_ char16_t const* filePath, bool clearExistingItems, bool merge); // Loads without keeping a settings tree.
+    void EnableSettingsCache(bool isEnabled) { isSettingsCacheEnabled_ = isEnabled; } // Reuse parsed settings from a per-user binary cache.
+    HRESULT ReloadChangedDrawableObjectsSettings(_In_z_ char16_t const* filePath, _Out_ bool& reloadedOnlyChanged);
+    void RecordSettingsTreeGenerations(); // Call after loading drawableObjects_ from settingsTree_.
+    bool IsSettingsTreeCurrent() const; // Whether drawableObjects_ are still exactly as loaded from settingsTree_.
     HRESULT StoreDrawableObjectsSettings(_In_z_ char16_t const* filePath);
     HRESULT SaveSelectedFontFile();
     HRESULT SaveUnpackedWoffFontFile();
@@ -188,11 +194,17 @@ protected:
     SettingsVisibility settingsVisibility_ = SettingsVisibilityLight;
     std::u16string attributeFilter_;
     std::u16string selectedAttributeValue_;
+    ListSubstringIndex attributesFilterIndex_; // Attribute display names, built on first use.
+    ListSubstringIndex attributeValuesFilterIndex_; // Predefined value names of the last attribute filtered.
+    Attribute::PredefinedValue const* attributeValuesFilterIndexSource_ = nullptr; // Which predefined values attributeValuesFilterIndex_ holds.
     std::u16string previousSettingsFilePath_;
     TextEscapeMode textEscapeMode_ = TextEscapeModeNone;
     WindowDpiScaler dpiScaler_;
 
     std::vector<DrawableObjectAndValues> drawableObjects_;
+    bool isSettingsCacheEnabled_ = false;
+    TextTree settingsTree_; // Last settings file loaded into drawableObjects_, so reloading it rereads only changed objects.
+    std::vector<uint64_t> settingsTreeGenerations_; // Modification generation of each drawable object as loaded from settingsTree_.
 };
 
 DEFINE_ENUM_FLAG_OPERATORS(MainWindow::NeededUiUpdate);
@@ -28,6 +28,7 @@
     import Application;
     import DrawableObjectAndValues;
     import TextTreeParser; // for DrawableObjectAndValues
+    import Benchmark;
     export
     {
         #include "MainWindow.h"
@@ -52,6 +53,7 @@
     #include "TextTreeParser.h"
     #include "DrawableObjectAndValues.h"
     #include "TextTreeParser.h"
+    #include "Benchmark.h"
     #include "MainWindow.h"
 #endif
 
@@ -97,6 +99,16 @@ int APIENTRY wWinMain(
     std::u16string trimmedCommandLine(ToChar16(commandLine));
     TrimSpaces(IN OUT trimmedCommandLine);
 
+    // Caching parsed settings is opt-in, since the cache files take space.
+    bool wantSettingsCache = false;
+    if (_wcsnicmp(ToWChar(trimmedCommandLine.c_str()), L"/cache", 6) == 0
+    &&  (trimmedCommandLine.size() == 6 || trimmedCommandLine[6] == ' '))
+    {
+        wantSettingsCache = true;
+        trimmedCommandLine.erase(0, 6);
+        TrimSpaces(IN OUT trimmedCommandLine);
+    }
+
     if (!trimmedCommandLine.empty())
     {
         if (_wcsicmp(ToWChar(trimmedCommandLine.c_str()), L"/?"    ) == 0
@@ -105,7 +117,23 @@ int APIENTRY wWinMain(
         ||  _wcsicmp(ToWChar(trimmedCommandLine.c_str()), L"--help") == 0
             )
         {
-            MessageBox(nullptr, L"TextLayoutSampler.exe [SomeFile.TextLayoutSamplerSettings].", APPLICATION_TITLE, MB_OK);
+            MessageBox(nullptr, L"TextLayoutSampler.exe [/cache] [SomeFile.TextLayoutSamplerSettings].\r\n"
+                                L"TextLayoutSampler.exe /benchmark [sizes=1K,1M,64M] [depth=2] [strings=24] [escapes=10] [comments=5] [out=results.csv]", APPLICATION_TITLE, MB_OK);
+            return (int)0;
+        }
+        else if (_wcsnicmp(ToWChar(trimmedCommandLine.c_str()), L"/benchmark", 10) == 0
+             &&  (trimmedCommandLine.size() == 10 || trimmedCommandLine[10] == ' '))
+        {
+            // Runs without any window, writing the results to a file.
+            std::u16string errorMessage;
+            HRESULT hr = RunBenchmarksFromCommandLine(trimmedCommandLine.c_str() + 10, OUT errorMessage);
+            if (FAILED(hr))
+            {
+                if (errorMessage.empty())
+                    Application::Fail(trimmedCommandLine.c_str(), u"Could not run the benchmarks.\r\n\r\n\"%s\"\r\n%08X", hr);
+                else
+                    Application::Fail(errorMessage.c_str(), u"Could not run the benchmarks.\r\n\r\n%s\r\n%08X", hr);
+            }
             return (int)0;
         }
         else if (_wcsicmp(ToWChar(trimmedCommandLine.c_str()), L"/blank") == 0)
@@ -133,6 +161,7 @@ int APIENTRY wWinMain(
     SendMessage(Application::g_mainHwnd, WM_CHANGEUISTATE, UIS_CLEAR | UISF_HIDEACCEL | UISF_HIDEFOCUS, (LPARAM)nullptr); // Always shows the focus rectangle.
 
     MainWindow& mainWindow = *MainWindow::GetClass(Application::g_mainHwnd);
+    mainWindow.EnableSettingsCache(wantSettingsCache);
 
     if (!trimmedCommandLine.empty())
     {
@@ -644,14 +673,15 @@ void MainWindow::UpdateDrawableObjectsListView()
 
         for (uint32_t i = 0; i < DrawableObjectAttributeTotal; ++i)
         {
-            auto* text = &drawableObject.values_[i].stringValue;
-            if (text->size() > 256)
+            array_ref<char16_t const> text = drawableObject.values_[i].GetString();
+            char16_t const* displayedText = text.data();
+            if (text.size() > 256)
             {
-                truncatedString.assign(text->c_str(), 256);
-                text = &truncatedString;
+                truncatedString.assign(text.data(), 256);
+                displayedText = truncatedString.c_str();
             }
             isRecursing_ = true; // Stop pointless LVN_ITEMCHANGED messages.
-            lw.SetItemText(i, text->c_str());
+            lw.SetItemText(i, displayedText);
             isRecursing_ = false;
         }
         lw.AdvanceItem();
@@ -693,16 +723,16 @@ void MainWindow::FillAttributesListView()
     lw.mask |= LVIF_PARAM;
 
     uint32_t listIndices[countof(DrawableObject::attributeList)];
-    ListSubstringPrioritizer substringPrioritizer(attributeFilter_, static_cast<uint32_t>(countof(DrawableObject::attributeList)));
 
-    // Get the filtered list.
-    for (uint32_t i = 0; i < countof(DrawableObject::attributeList); ++i)
+    // Get the filtered list, indexing the attribute names the first time.
+    if (attributesFilterIndex_.GetItemCount() == 0)
     {
-        auto& attribute = DrawableObject::attributeList[i];
-        auto weight = substringPrioritizer.GetStringWeight(ToChar16ArrayRef(attribute.display));
-        substringPrioritizer.SetItemWeight(i, weight);
+        for (auto& attribute : DrawableObject::attributeList)
+        {
+            attributesFilterIndex_.AddName(ToChar16ArrayRef(attribute.display));
+        }
     }
-    auto listIndicesSubset = substringPrioritizer.GetItemIndices(OUT listIndices, /*excludeMismatches*/false);
+    auto listIndicesSubset = attributesFilterIndex_.GetItemIndices(attributeFilter_, OUT listIndices, /*excludeMismatches*/false);
 
     // Add matching items to the ListView.
     for (auto& index : listIndicesSubset)
@@ -804,8 +834,19 @@ void MainWindow::UpdateAttributeValuesListView()
         else
         {
             // For single line, reorder the list by best match typed so far
-            // (if recently editing the value).
-            attribute.GetPredefinedValueIndices(selectedAttributeValue_.c_str(), OUT orderedIndices);
+            // (if recently editing the value). Attributes sharing the same
+            // predefined values (like the colors) share the index too.
+            if (attributeValuesFilterIndexSource_ != attribute.predefinedValues.data()
+            ||  attributeValuesFilterIndex_.GetItemCount() != predefinedValuesCount)
+            {
+                attributeValuesFilterIndex_.Clear();
+                for (uint32_t i = 0; i < predefinedValuesCount; ++i)
+                {
+                    attributeValuesFilterIndex_.AddName(ToChar16ArrayRef(attribute.predefinedValues[i].GetName()));
+                }
+                attributeValuesFilterIndexSource_ = attribute.predefinedValues.data();
+            }
+            attributeValuesFilterIndex_.GetItemIndices(selectedAttributeValue_, OUT orderedIndices, /*excludeMismatches*/false);
         }
         isTypingAttributeValueToFilter_ = false; // Reset once used.
 
@@ -1217,8 +1258,8 @@ void MainWindow::CreateDrawableObjectsListViewSelected()
     for (auto& drawableObject : make_iterator_range(drawableObjects_.data(), originalDrawableObjectsCount, newDrawableObjectsCount))
     {
         drawableObject.Invalidate();
-        drawableObject.Update();
     }
+    DrawableObjectAndValues::Update(make_array_ref(drawableObjects_.data() + originalDrawableObjectsCount, drawableObjects_.data() + newDrawableObjectsCount));
 
     // Deselect any previous selected objects.
     for (auto& drawableObject : make_iterator_range(drawableObjects_.data(), 0, originalDrawableObjectsCount))
@@ -1315,7 +1356,8 @@ MainWindow::DialogProcResult CALLBACK MainWindow::OnDragAndDrop(HWND hwnd, UINT
         {
             auto* filenameExtension = FindFileNameExtension(fileName);
 
-            if (_wcsicmp(ToWChar(filenameExtension), L"TextLayoutSamplerSettings") == 0)
+            if (_wcsicmp(ToWChar(filenameExtension), L"TextLayoutSamplerSettings") == 0
+            ||  _wcsicmp(ToWChar(filenameExtension), L"xml") == 0)
             {
                 hr = LoadDrawableObjectsSettings(fileName.data(), clearExistingItems, /*merge*/false);
             }
@@ -1323,6 +1365,10 @@ MainWindow::DialogProcResult CALLBACK MainWindow::OnDragAndDrop(HWND hwnd, UINT
             {
                 hr = LoadTextFileIntoDrawableObjects(fileName.data());
             }
+            else if (_wcsicmp(ToWChar(filenameExtension), L"csv") == 0)
+            {
+                hr = LoadCsvFileIntoDrawableObjects(fileName.data(), clearExistingItems);
+            }
             else if (_wcsicmp(ToWChar(filenameExtension), L"ttf") == 0
                 ||   _wcsicmp(ToWChar(filenameExtension), L"otf") == 0
                 ||   _wcsicmp(ToWChar(filenameExtension), L"tte") == 0
@@ -1345,7 +1391,7 @@ MainWindow::DialogProcResult CALLBACK MainWindow::OnDragAndDrop(HWND hwnd, UINT
     DragFinish(hDrop);
 
     if (hr == HRESULT_FROM_WIN32(ERROR_BAD_FORMAT))
-        ShowMessageAndAppendLog(u"Unknown file format '%s' (TextLayoutSamplerSettings, txt, ttf, otf, tte, ttc, otc), 0x%08X", fileName.c_str(), hr);
+        ShowMessageAndAppendLog(u"Unknown file format '%s' (TextLayoutSamplerSettings, xml, txt, csv, ttf, otf, tte, ttc, otc), 0x%08X", fileName.c_str(), hr);
     else if (FAILED(hr))
         ShowMessageAndAppendLog(u"Failed to load file '%s', 0x%08X", fileName.c_str(), hr);
 
@@ -1826,7 +1872,8 @@ HRESULT MainWindow::LoadDrawableObjectsSettings(bool clearExistingItems, bool me
     HRESULT hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
     auto* filenameExtension = FindFileNameExtension(filePath);
 
-    if (_wcsicmp(ToWChar(filenameExtension), L"TextLayoutSamplerSettings") == 0)
+    if (_wcsicmp(ToWChar(filenameExtension), L"TextLayoutSamplerSettings") == 0
+    ||  _wcsicmp(ToWChar(filenameExtension), L"xml") == 0)
     {
         hr = LoadDrawableObjectsSettings(filePath.c_str(), clearExistingItems, merge);
     }
@@ -1834,6 +1881,10 @@ HRESULT MainWindow::LoadDrawableObjectsSettings(bool clearExistingItems, bool me
     {
         hr = LoadTextFileIntoDrawableObjects(filePath.c_str());
     }
+    else if (_wcsicmp(ToWChar(filenameExtension), L"csv") == 0)
+    {
+        hr = LoadCsvFileIntoDrawableObjects(filePath.c_str(), clearExistingItems);
+    }
 
     if (hr == HRESULT_FROM_WIN32(ERROR_BAD_FORMAT))
         ShowMessageAndAppendLog(u"Unknown file format '%s', 0x%08X", filePath.c_str(), hr);
@@ -1844,13 +1895,146 @@ HRESULT MainWindow::LoadDrawableObjectsSettings(bool clearExistingItems, bool me
 }
 
 
-HRESULT MainWindow::LoadDrawableObjectsSettings(_In_z_ char16_t const* filePath, bool clearExistingItems, bool merge)
+namespace
 {
-    TextTree data;
-    std::u16string inputText;
+    // Settings may also be written as XML, where each element holds its
+    // settings as attributes or child elements, like a JSONex object:
+    //
+    //      <settings content="TextLayoutSamplerSettings">
+    //          <objects>
+    //              <object fontSize="12"/>
+    //              <object text="Hello" fontFamily="Segoe UI"/>
+    //          </objects>
+    //      </settings>
+    //
+    // The whitespace between elements is not read, so only elements remain
+    // in the objects list.
+    const TextTreeParser::Options g_xmlSettingsParserOptions = TextTreeParser::Options(
+        TextTreeParser::OptionsDecodeNumbers | TextTreeParser::OptionsDiscardPureWhitespace
+        );
+
+
+    bool IsXmlSettingsText(std::u16string const& text)
+    {
+        return TextTreeParser::DetermineType(text.data(), static_cast<uint32_t>(text.size())) == TextTree::SyntaxXml;
+    }
 
+
+    // Returns the node holding the settings, skipping any comments or XML
+    // declaration before it.
+    TextTree::NodePointer FindSettingsSubroot(TextTree& settingsTree)
+    {
+        TextTree::NodePointer subroot = settingsTree.BeginFirstChild();
+        while (subroot.IsValid())
+        {
+            auto genericType = (*subroot).GetGenericType();
+            if (genericType != TextTree::Node::TypeComment && genericType != TextTree::Node::TypeIgnorable)
+                break;
+
+            ++subroot;
+        }
+        return subroot;
+    }
+
+
+    // Returns where the binary cache of a settings file goes: a per-user
+    // folder rather than beside the file, named by a hash of the full path
+    // so that each settings file has at most one cache file.
+    HRESULT GetSettingsCacheFilePath(_In_z_ char16_t const* filePath, OUT std::u16string& cacheFilePath)
+    {
+        cacheFilePath.clear();
+
+        std::u16string cacheFolderPath;
+        wchar_t* localAppDataPath = nullptr;
+        HRESULT hr = SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, OUT &localAppDataPath);
+        if (SUCCEEDED(hr))
+        {
+            cacheFolderPath = ToChar16(localAppDataPath);
+            cacheFolderPath += u"\\TextLayoutSampler\\SettingsCache";
+        }
+        CoTaskMemFree(localAppDataPath);
+        IFR(hr);
+
+        int result = SHCreateDirectoryEx(nullptr, ToWChar(cacheFolderPath.c_str()), nullptr);
+        if (result != ERROR_SUCCESS && result != ERROR_ALREADY_EXISTS)
+            return HRESULT_FROM_WIN32(result);
+
+        // File names are case insensitive, so the same file maps to the same cache.
+        std::u16string fullFilePath = GetFullFileName(ToChar16ArrayRef(filePath));
+        ToUpperCase(IN OUT fullFilePath);
+        auto pathBytes = make_array_ref(reinterpret_cast<uint8_t const*>(fullFilePath.data()), fullFilePath.size() * sizeof(char16_t));
+        AppendFormattedString(IN OUT cacheFolderPath, u"\\%016llX.cache", TextTree::GetSourceHash(pathBytes, 0));
+        cacheFilePath = std::move(cacheFolderPath);
+
+        return S_OK;
+    }
+
+
+    // Reads the settings file into an empty tree. If caching, the tree is read
+    // directly from the binary cache when that was written for the same file
+    // contents and time. Otherwise the file is parsed, and the cache rewritten.
+    HRESULT ReadSettingsTree(_In_z_ char16_t const* filePath, bool useCache, OUT TextTree& textTree)
+    {
+        MappedFileView fileView;
+        IFR(fileView.Open(filePath));
+
+        // The tree adopts the text, referring to it directly rather than copying.
+        std::u16string inputText;
+        IFR(ReadTextFileData(fileView, OUT inputText));
+
+        uint64_t sourceHash = 0;
+        std::u16string cacheFilePath;
+        if (useCache && SUCCEEDED(GetSettingsCacheFilePath(filePath, OUT cacheFilePath)))
+        {
+            sourceHash = TextTree::GetSourceHash(fileView.GetBytes(), fileView.GetLastWriteTime());
+
+            MappedFileView cacheFileView;
+            if (SUCCEEDED(cacheFileView.Open(cacheFilePath.c_str()))
+            &&  textTree.ReadBinary(cacheFileView.GetBytes(), sourceHash, std::move(inputText)))
+            {
+                return S_OK;
+            }
+        }
+        fileView.Close();
+
+        // Large object lists are split across threads. Decoding numbers while
+        // reading spares the attributes parsing them again.
+        if (IsXmlSettingsText(inputText))
+        {
+            XmlParser parser(nullptr, 0, g_xmlSettingsParserOptions);
+            parser.ReadNodes(IN OUT textTree, std::move(inputText));
+        }
+        else
+        {
+            JsonexParser parser(nullptr, 0, TextTreeParser::OptionsDecodeNumbers);
+            parser.ReadNodesParallel(IN OUT textTree, std::move(inputText));
+        }
+
+        // Failing to write the cache only costs parsing again next time.
+        if (!cacheFilePath.empty())
+        {
+            std::vector<uint8_t> cacheData;
+            textTree.WriteBinary(sourceHash, OUT cacheData);
+            WriteBinaryFile(cacheFilePath.c_str(), cacheData);
+        }
+
+        return S_OK;
+    }
+}
+
+
+HRESULT MainWindow::LoadDrawableObjectsSettings(_In_z_ char16_t const* filePath, bool clearExistingItems, bool merge)
+{
     AppendLog(u"Reading settings file '%s'\r\n", filePath);
 
+    // Reloading the same file replaces the loaded objects again, so only the
+    // objects whose text changed need rereading, provided nothing else has
+    // changed the drawable objects since.
+    bool isReload = clearExistingItems
+                 && !merge
+                 && IsSettingsTreeCurrent()
+                 && previousSettingsFilePath_ == filePath;
+
     // todo: Store the base path so that relative resources like font files can be found regardless of the current path.
     previousSettingsFilePath_ = filePath;
 
@@ -1864,18 +2048,41 @@ HRESULT MainWindow::LoadDrawableObjectsSettings(_In_z_ char16_t const* filePath,
         NeededUiUpdateTextEdit
         );
 
-    // Read file and parse.
-    IFR(ReadTextFile(filePath, OUT inputText));
+    // Only keep the tree for reloading when it alone describes the objects.
+    // Otherwise there is no need for one, so just stream through the file.
+    if (!clearExistingItems || merge)
+    {
+        settingsTree_.Clear();
+        return StreamDrawableObjectsSettings(filePath, clearExistingItems, merge);
+    }
 
-    JsonexParser parser(inputText, JsonexParser::OptionsDefault);
-    parser.ReadNodes(IN OUT data);
+    if (isReload)
+    {
+        bool reloadedOnlyChanged = false;
+        HRESULT hr = ReloadChangedDrawableObjectsSettings(filePath, OUT reloadedOnlyChanged);
+        if (FAILED(hr))
+        {
+            settingsTree_.Clear();
+            return hr;
+        }
+        if (reloadedOnlyChanged)
+        {
+            RecordSettingsTreeGenerations();
+            return S_OK;
+        }
 
-    if (clearExistingItems)
+        // Otherwise the tree was reread in full, so load all the objects from it.
+    }
+    else
     {
-        drawableObjects_.clear();
+        // Read file and parse (or load the cached tree).
+        settingsTree_.Clear();
+        IFR(ReadSettingsTree(filePath, isSettingsCacheEnabled_, OUT settingsTree_));
     }
 
-    TextTree::NodePointer subroot = data.BeginFirstChild();
+    drawableObjects_.clear();
+
+    TextTree::NodePointer subroot = FindSettingsSubroot(settingsTree_);
 
     Attribute::PredefinedValue recognizedSettings[] = {
         {1,u"content"},
@@ -1897,14 +2104,105 @@ HRESULT MainWindow::LoadDrawableObjectsSettings(_In_z_ char16_t const* filePath,
             if (value.compare(u"TextLayoutSamplerSettings") != 0)
             {
                 AppendLog(u"File did not contain expected content. '%s' != TextLayoutSamplerSettings\r\n", value.c_str());
+                settingsTree_.Clear();
                 return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
             }
             break;
         case 2: // objects
+            DrawableObjectAndValues::Load(node, IN OUT drawableObjects_);
+            break;
+        }
+    }
+    RecordSettingsTreeGenerations();
+
+    return S_OK;
+}
+
+
+// Loads the objects straight from the parser's events rather than building a
+// tree of the whole file first, for when the tree would not be kept anyway.
+HRESULT MainWindow::StreamDrawableObjectsSettings(_In_z_ char16_t const* filePath, bool clearExistingItems, bool merge)
+{
+    std::u16string inputText;
+    IFR(ReadTextFile(filePath, OUT inputText));
+
+    JsonexParser jsonexParser(inputText, JsonexParser::OptionsDefault);
+    XmlParser xmlParser(inputText, g_xmlSettingsParserOptions);
+    TextTreeParser& parser = IsXmlSettingsText(inputText) ? static_cast<TextTreeParser&>(xmlParser) : jsonexParser;
+
+    if (clearExistingItems)
+    {
+        drawableObjects_.clear();
+    }
+
+    Attribute::PredefinedValue recognizedSettings[] = {
+        {1,u"content"},
+        {2,u"objects"},
+    };
+
+    // The settings are the children of the first top level node, skipping
+    // any comments or XML declaration before it.
+    TextTreeParser::EventType eventType;
+    TextTree::Node node;
+    array_ref<char16_t const> nodeText;
+    std::u16string text;
+    std::u16string value;
+    uint32_t depth = 0;
+    uint32_t settingEnumValue = 0;
+
+    while (parser.ReadEvent(OUT eventType, OUT node, OUT nodeText))
+    {
+        if (eventType == TextTreeParser::EventTypeValue)
+        {
+            if (depth == 0)
+            {
+                auto genericType = node.GetGenericType();
+                if (genericType == TextTree::Node::TypeComment || genericType == TextTree::Node::TypeIgnorable)
+                    continue;
+
+                break; // The first top level node has no settings.
+            }
+
+            if (depth == 2)
+                value.assign(nodeText.begin(), nodeText.end());
+
+            continue;
+        }
+
+        if (eventType == TextTreeParser::EventTypeEndNode)
+        {
+            if (depth == 2 && settingEnumValue == 1) // content
+            {
+                if (value.compare(u"TextLayoutSamplerSettings") != 0)
+                {
+                    AppendLog(u"File did not contain expected content. '%s' != TextLayoutSamplerSettings\r\n", value.c_str());
+                    return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+                }
+            }
+            if (--depth == 0)
+                break;
+
+            continue;
+        }
+
+        if (++depth != 2)
+            continue;
+
+        text.assign(nodeText.begin(), nodeText.end());
+        value.clear();
+        if (FAILED(Attribute::PredefinedValue::MapNameToValue({recognizedSettings, countof(recognizedSettings)}, text.c_str(), OUT settingEnumValue)))
+        {
+            settingEnumValue = 0;
+            continue;
+        }
+
+        if (settingEnumValue == 2) // objects
+        {
+            // Loading reads through the end of the objects list.
             if (merge)
             {
                 std::vector<DrawableObjectAndValues> drawableObjects;
-                DrawableObjectAndValues::Load(node, OUT drawableObjects);
+                DrawableObjectAndValues::Load(parser, OUT drawableObjects);
                 if (!drawableObjects.empty())
                 {
                     DrawableObjectAndValues::Merge(*drawableObjects.data(), IN OUT drawableObjects_);
@@ -1912,12 +2210,152 @@ HRESULT MainWindow::LoadDrawableObjectsSettings(_In_z_ char16_t const* filePath,
             }
             else
             {
-                DrawableObjectAndValues::Load(node, IN OUT drawableObjects_);
+                DrawableObjectAndValues::Load(parser, IN OUT drawableObjects_);
             }
-            break;
+            --depth;
+        }
+    }
+
+    return S_OK;
+}
+
+
+void MainWindow::RecordSettingsTreeGenerations()
+{
+    settingsTreeGenerations_.resize(drawableObjects_.size());
+    for (size_t i = 0; i < drawableObjects_.size(); ++i)
+    {
+        settingsTreeGenerations_[i] = drawableObjects_[i].modificationGeneration_;
+    }
+}
+
+
+bool MainWindow::IsSettingsTreeCurrent() const
+{
+    // Any set attribute gives its object a new generation, and adding,
+    // removing, or reordering objects changes the sequence, so reloading can
+    // update just the changed objects only if the sequence is the same.
+    if (settingsTree_.empty() || settingsTreeGenerations_.size() != drawableObjects_.size())
+        return false;
+
+    for (size_t i = 0; i < drawableObjects_.size(); ++i)
+    {
+        if (settingsTreeGenerations_[i] != drawableObjects_[i].modificationGeneration_)
+            return false;
+    }
+    return true;
+}
+
+
+namespace
+{
+    // Finds the objects list in the settings tree, returning its node index
+    // and the number of objects in it, or 0 if there is not exactly one list.
+    uint32_t FindSettingsObjectsNode(TextTree& settingsTree, _Out_ uint32_t& objectsCount)
+    {
+        uint32_t objectsNodeIndex = 0;
+        objectsCount = 0;
+
+        TextTree::NodePointer subroot = FindSettingsSubroot(settingsTree);
+        for (TextTree::NodePointer node = subroot.begin(), nodeEnd = subroot.end(); node != nodeEnd; ++node)
+        {
+            if (node.GetText() != u"objects")
+                continue;
+            if (objectsNodeIndex != 0)
+                return 0; // Several lists, whose objects are appended together.
+
+            objectsNodeIndex = static_cast<uint32_t>(&*node - &settingsTree.GetNode(0));
+            for (TextTree::NodePointer objectNode = node.begin(), objectNodeEnd = node.end(); objectNode != objectNodeEnd; ++objectNode)
+            {
+                ++objectsCount;
+            }
+        }
+
+        return objectsNodeIndex;
+    }
+}
+
+
+// Rereads the previously loaded settings file into settingsTree_, reparsing
+// only the object nodes that enclose the changed text. If those are all
+// within the objects list, only their drawable objects are reloaded, and
+// reloadedOnlyChanged is set. Otherwise the caller reloads all the objects
+// from the updated tree.
+HRESULT MainWindow::ReloadChangedDrawableObjectsSettings(_In_z_ char16_t const* filePath, _Out_ bool& reloadedOnlyChanged)
+{
+    reloadedOnlyChanged = false;
+
+    std::u16string inputText;
+    IFR(ReadTextFile(filePath, OUT inputText));
+
+    // The first object is the shared one, not a drawable object.
+    const bool isXml = IsXmlSettingsText(inputText);
+    JsonexParser jsonexParser(nullptr, 0, TextTreeParser::OptionsDecodeNumbers);
+    XmlParser xmlParser(nullptr, 0, g_xmlSettingsParserOptions);
+    TextTreeParser& parser = isXml ? static_cast<TextTreeParser&>(xmlParser) : jsonexParser;
+    uint32_t oldObjectsCount;
+    uint32_t objectsNodeIndex = FindSettingsObjectsNode(settingsTree_, OUT oldObjectsCount);
+    if (objectsNodeIndex == 0 || oldObjectsCount == 0 || oldObjectsCount - 1 != drawableObjects_.size())
+    {
+        settingsTree_.Clear();
+        if (isXml)
+            xmlParser.ReadNodes(IN OUT settingsTree_, std::move(inputText));
+        else
+            jsonexParser.ReadNodesParallel(IN OUT settingsTree_, std::move(inputText));
+        return S_OK;
+    }
+
+    uint32_t objectLevel = settingsTree_.GetNode(objectsNodeIndex).level + 1;
+    uint32_t firstNodeIndex, oldNodeCount, newNodeCount;
+    parser.ReparseNodes(IN OUT settingsTree_, std::move(inputText), objectLevel, OUT firstNodeIndex, OUT oldNodeCount, OUT newNodeCount);
+
+    if (firstNodeIndex == 0 && oldNodeCount == 0 && newNodeCount == 0)
+    {
+        reloadedOnlyChanged = true; // Nothing changed.
+        return S_OK;
+    }
+
+    // Any change before the objects list affects all the objects (as does a
+    // fallback to reading the whole tree), and otherwise the list is found at
+    // the same index.
+    if (firstNodeIndex <= objectsNodeIndex)
+        return S_OK;
+
+    // Find which objects the new nodes are.
+    uint32_t newObjectsCount = 0;
+    uint32_t firstObjectIndex = ~0u;
+    uint32_t newObjectCount = 0;
+    TextTree::NodePointer objectsNode(settingsTree_, objectsNodeIndex);
+    for (TextTree::NodePointer objectNode = objectsNode.begin(), objectNodeEnd = objectsNode.end(); objectNode != objectNodeEnd; ++objectNode, ++newObjectsCount)
+    {
+        uint32_t nodeIndex = static_cast<uint32_t>(&*objectNode - &settingsTree_.GetNode(0));
+        if (nodeIndex == firstNodeIndex)
+        {
+            firstObjectIndex = newObjectsCount;
+        }
+        if (nodeIndex >= firstNodeIndex && nodeIndex < firstNodeIndex + newNodeCount)
+        {
+            ++newObjectCount;
         }
     }
 
+    // Changing the shared first object affects all the objects too, and the
+    // changed nodes may not be objects at all.
+    if (firstObjectIndex == ~0u || firstObjectIndex == 0)
+        return S_OK;
+
+    uint32_t oldObjectCount = newObjectCount + oldObjectsCount - newObjectsCount;
+    DrawableObjectAndValues::Reload(
+        objectsNode,
+        firstObjectIndex - 1,
+        oldObjectCount,
+        newObjectCount,
+        IN OUT drawableObjects_
+        );
+
+    AppendLog(u"Reloaded %d changed objects\r\n", newObjectCount);
+    reloadedOnlyChanged = true;
+
     return S_OK;
 }
 
@@ -1948,10 +2386,62 @@ HRESULT MainWindow::LoadTextFileIntoDrawableObjects(_In_z_ char16_t const* fileP
         InitializeDefaultDrawableObjectAndValues(drawableObject);
     }
 
-    for (auto& drawableObject : drawableObjects_)
+    // Set the text once, sharing it with the other objects rather than copying
+    // it into each, then update them all together.
+    drawableObjects_[0].Set(DrawableObjectAttributeText, inputText.c_str());
+    AttributeValue const& textValue = drawableObjects_[0].values_[DrawableObjectAttributeText];
+    for (auto& drawableObject : make_iterator_range(drawableObjects_.data(), 1, drawableObjects_.size()))
     {
-        drawableObject.Set(DrawableObjectAttributeText, inputText.c_str());
-        drawableObject.Update();
+        drawableObject.Set(DrawableObjectAttributeText, textValue);
+    }
+    DrawableObjectAndValues::Update(drawableObjects_);
+
+    return S_OK;
+}
+
+
+HRESULT MainWindow::LoadCsvFileIntoDrawableObjects(_In_z_ char16_t const* filePath, bool clearExistingItems)
+{
+    std::u16string inputText;
+
+    AppendLog(u"Reading CSV file '%s'\r\n", filePath);
+
+    DeferUpdateUi(
+        NeededUiUpdateDrawableObjectsListView |
+        NeededUiUpdateAttributesListView |
+        NeededUiUpdateAttributeValuesListView |
+        NeededUiUpdateAttributeValuesEdit |
+        NeededUiUpdateAttributeValuesSlider |
+        NeededUiUpdateDrawableObjectsCanvas |
+        NeededUiUpdateTextEdit
+        );
+
+    IFR(ReadTextFile(filePath, OUT inputText));
+
+    if (clearExistingItems)
+    {
+        drawableObjects_.clear();
+    }
+
+    // Each row is a drawable object with attributes named by the header row,
+    // read straight from the parser without building a tree.
+    CsvParser parser(inputText, TextTreeParser::OptionsDecodeNumbers);
+    parser.SetErrorLimit(1);
+    DrawableObjectAndValues::Load(parser, IN OUT drawableObjects_, /*isFirstObjectShared*/ false);
+
+    if (parser.GetErrorCount() > 0)
+    {
+        uint32_t errorTextIndex;
+        char16_t const* errorMessage;
+        std::vector<TextTreeParser::TextPosition> errorPositions;
+        parser.GetErrorDetails(0, OUT errorTextIndex, OUT &errorMessage);
+        parser.GetErrorPositions(OUT errorPositions);
+        AppendLog(u"%d errors reading CSV file. First at line %d column %d: %s\r\n",
+            parser.GetTotalErrorCount(),
+            errorPositions[0].line + 1,
+            errorPositions[0].column + 1,
+            errorMessage
+            );
     }
 
     return S_OK;
@@ -2349,7 +2839,9 @@ HRESULT MainWindow::StoreDrawableObjectsSettings(_In_z_ char16_t const* filePath
 
     previousSettingsFilePath_ = filePath;
 
-    // Create the text tree root node and outermost object.
+    // Create the text tree root node and outermost object. The whole tree is
+    // built by appending, so group it as one run of edits.
+    data.BeginEdits();
     data.Append(TextTree::Node::TypeRoot, 1, u"", 0);
     TextTree::NodePointer root = data.begin();
     TextTree::NodePointer subroot = root.AppendChild(TextTree::Node::TypeObject, u"", 0);
@@ -2358,12 +2850,17 @@ HRESULT MainWindow::StoreDrawableObjectsSettings(_In_z_ char16_t const* filePath
     subroot.SetKeyValue(u"content", u"TextLayoutSamplerSettings", uint32_t(countof(u"TextLayoutSamplerSettings"))-1);
     auto objectsNode = subroot.AppendChild(TextTree::Node::TypeArray, u"objects", uint32_t(countof(u"objects")-1));
     DrawableObjectAndValues::Store(drawableObjects_, objectsNode);
+    data.EndEdits();
+
+    // Serialize and write the file, streaming the UTF-8 out in fixed size
+    // pieces rather than building the whole document first.
+    SequentialFileWriter fileWriter;
+    IFR(fileWriter.Create(filePath));
 
-    // Serialize and write the file.
     JsonexWriter writer(JsonexWriter::OptionsDefault);
-    writer.WriteNodes(data);
-    array_ref<char16_t const> outputJson = writer.GetText();
-    IFR(WriteTextFile(filePath, outputJson.data(), static_cast<uint32_t>(outputJson.size())));
+    writer.SetSink([&](array_ref<uint8_t const> data) -> HRESULT { return fileWriter.Write(data); });
+    IFR(writer.WriteNodes(data));
+    IFR(writer.Flush());
 
     return S_OK;
 }
@@ -2505,6 +3002,7 @@ MainWindow::DialogProcResult CALLBACK MainWindow::OnCommand(HWND hwnd, int id, H
                 std::vector<uint32_t> drawableObjectIndices = GetSelectedDrawableObjectIndices();
                 GetWindowText(GetWindowFromId(hwnd_, IdcEditText), OUT text);
                 UnescapeText(IN OUT text);
+
                 DrawableObjectAndValues::Set(drawableObjects_, drawableObjectIndices, DrawableObjectAttributeText, text.c_str());
                 DrawableObjectAndValues::Update(drawableObjects_, drawableObjectIndices);
 
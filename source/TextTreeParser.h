@@ -13,6 +13,11 @@ class TextTreeParser;
 // Limitations:
 //      Combined text of all names and attributes cannot exceed 4GB (which
 //      implies too that all individuals name and values are < 4GB).
+//
+// Threading:
+//      Any number of threads may read the same tree concurrently through the
+//      const methods (including Find, which may lazily build a child key
+//      index). Modifying the tree requires exclusive access.
 class TextTree
 {
     friend TextTreeParser;
@@ -23,12 +28,14 @@ public:
         SyntaxUnknown,
         SyntaxJsonex, // Read/write support
         SyntaxWindowsInitialization, // Read support
-        SyntaxXml, // Write support
+        SyntaxXml, // Read/write support
         SyntaxBibTeX, // No support
-        SyntaxCommaSeparatedValue, // No support
+        SyntaxCommaSeparatedValue, // Read support
         SyntaxBibTex, // No support
     };
 
+    static const uint32_t InvalidKeyId = 0xFFFFFFFF;
+
     struct Node
     {
         // What type the parsed node is.
@@ -83,6 +90,24 @@ public:
         inline void GetText(const TextTree& textTree, OUT std::u16string& text) const { textTree.GetText(*this, OUT text); };
     };
 
+    // Binary form of a value node's text that is entirely a plain decimal
+    // number, decoded while reading with TextTreeParser::OptionsDecodeNumbers.
+    // Each value is exactly what wcstoul (base 10) or wcstof would return for
+    // the text, and is only present if it could be decoded exactly.
+    struct NodeNumber
+    {
+        enum Flags : uint32_t
+        {
+            FlagsNone       = 0x00000000,
+            FlagsInteger    = 0x00000001,   // integerValue is valid (no fraction or exponent).
+            FlagsFloat      = 0x00000002,   // floatValue is valid.
+        };
+
+        Flags flags;
+        uint32_t integerValue;
+        float floatValue;
+    };
+
     enum AdvanceNodeDirection : uint32_t
     {
         // todo: Add pure increment/decrement in pre-order.
@@ -129,6 +154,8 @@ public:
         std::u16string GetSubvalue() const; // Returns empty string if it does not exist.
         std::u16string GetSubvalue(const std::u16string& defaultText) const; // Supply a default value if the value is not found.
         std::u16string GetSubvalue(__in_ecount(defaultTextLength) const char16_t* defaultText, uint32_t defaultTextLength) const;
+        bool GetSubvalueNumber(OUT NodeNumber& number) const; // Decoded number of the single subvalue, if any.
+        uint32_t GetKeyId() const; // Interned name of a key node (see GetKeyId below), else InvalidKeyId.
 
         NodePointer AppendChild(
             TextTree::Node::Type type,
@@ -157,8 +184,41 @@ public:
     // http://www.cplusplus.com/reference/iterator/
     using iterator = NodePointer;
 
+    // Interns key names, so that each distinct name is stored once and
+    // identified by a small id (assigned in order of first appearance) that
+    // callers can map to their own data without comparing strings again.
+    // Names are case sensitive.
+    class KeyNameTable
+    {
+    public:
+        uint32_t Intern(__in_ecount(textLength) char16_t const* text, uint32_t textLength);
+        uint32_t Find(__in_ecount(textLength) char16_t const* text, uint32_t textLength) const noexcept; // InvalidKeyId if absent.
+        array_ref<char16_t const> GetName(uint32_t keyId) const noexcept;
+        uint32_t GetCount() const noexcept;
+        void Clear();
+
+    private:
+        struct Entry
+        {
+            uint32_t start;     // Offset into namesText_.
+            uint32_t length;
+            uint32_t hash;
+        };
+
+        uint32_t FindBucket(__in_ecount(textLength) char16_t const* text, uint32_t textLength, uint32_t hash) const noexcept;
+        void Rehash(uint32_t bucketCount);
+
+        std::u16string namesText_;
+        std::vector<Entry> entries_;
+        std::vector<uint32_t> buckets_; // Open addressed by hash, holding the key id + 1, or 0 if empty.
+    };
+
 public:
-    void Clear();
+    // Empties the tree. Releasing the memory is best for a long lived tree,
+    // whereas keeping it lets a tree that is reused to read many small files
+    // (along with a reused parser, which keeps its own capacity across Reset)
+    // fill without regrowing its storage each time.
+    void Clear(bool shouldReleaseMemory = true);
     uint32_t GetNodeCount() const noexcept;
     bool empty() const noexcept; // Node there exists a virtual root. So after calling ReadNodes, it will be non-empty even if the file was empty.
     iterator begin();   // Iterator walks entire tree, top down (pre-order).
@@ -166,6 +226,7 @@ public:
     iterator BeginFirstChild(); // You cannot deference this iterator, but you can use it to search from.
 
     // Returns reference that remains valid until the tree is modified.
+    // Changing a node's level or text directly requires calling InvalidateIndices.
     Node& GetNode(uint32_t nodeIndex);
     const Node& GetNode(uint32_t nodeIndex) const;
 
@@ -289,6 +350,15 @@ public:
         OUT std::u16string& text
         ) const;
 
+    // Reads the number decoded from the node's text while parsing.
+    // Returns false if it was not decoded, or the tree was modified since.
+    bool GetNodeNumber(uint32_t nodeIndex, OUT NodeNumber& number) const noexcept;
+
+    // Returns the interned name of a key node (see GetKeyNames), so callers
+    // can map names to their own data without comparing strings. Other nodes,
+    // including the root, have InvalidKeyId.
+    uint32_t GetKeyId(uint32_t nodeIndex) const noexcept;
+
     // Get the value of a named key, starting from firstNodeIndex (a sibling at the same level).
     //
     // Returns:
@@ -358,9 +428,116 @@ public:
     bool SkipEmptyNodes(__inout uint32_t& nodeIndex) const;
     bool SkipRootNode(__inout uint32_t& nodeIndex) const;
 
+    // Rebuild the navigation links and discard the key indices so that they
+    // are rebuilt on demand. Only needed if nodes were changed directly.
+    void InvalidateIndices();
+
+    // Groups a run of edits, such as building a tree node by node with
+    // AppendChild and SetKeyValue. The expected counts (beyond the current
+    // size) reserve room up front, and child key lookups are indexed from the
+    // first lookup, since appending at the end of the tree keeps the indices
+    // current rather than discarding them. Calls may nest.
+    void BeginEdits(uint32_t expectedNodeCount = 0, uint32_t expectedTextLength = 0);
+    void EndEdits() noexcept;
+
+    // Serializes the nodes and their decoded text into a compact binary image,
+    // which can be read back directly without parsing. Where each node began
+    // in the source text is kept too, so a tree read back can still be
+    // reparsed incrementally (see TextTreeParser::ReparseNodes), as are the
+    // decoded node numbers (see GetNodeNumber). The source text is not kept,
+    // only its length. The source hash identifies what the tree was parsed
+    // from, so that a stale image can be detected.
+    void WriteBinary(uint64_t sourceHash, OUT std::vector<uint8_t>& data) const;
+
+    // Replaces the tree with an image from WriteBinary, adopting the source
+    // text it was parsed from. Returns false, leaving the tree and the source
+    // text unchanged, if the image is malformed, from another version, or was
+    // written for a different source hash or text length.
+    bool ReadBinary(array_ref<uint8_t const> data, uint64_t sourceHash, std::u16string&& sourceText);
+
+    // Hashes the source data for WriteBinary/ReadBinary, mixing in a salt
+    // like the file's modification time.
+    static uint64_t GetSourceHash(array_ref<uint8_t const> sourceData, uint64_t salt) noexcept;
+
+    // The names of key nodes, by GetKeyId.
+    KeyNameTable const& GetKeyNames() const noexcept;
+
+private:
+    const char16_t* GetTextPointer(uint32_t textStart) const noexcept;
+    uint32_t AppendNodeText(__in_ecount(textLength) const char16_t* text, uint32_t textLength);
+    uint32_t SetNodeText(__inout Node& node, __in_ecount(textLength) const char16_t* text, uint32_t textLength); // Returns the node's key id.
+    void InternKeyNames(uint32_t firstNodeIndex);
+    uint32_t FindSingleSubvalue(uint32_t keyNodeIndex) const; // InvalidNodeIndex if not exactly one.
+
+private:
+    // Side index parallel to nodes_, so that moving between siblings,
+    // parents, and the end of a subtree does not need to scan the level of
+    // every node in between. The next sibling (if any) is the node at
+    // subtreeEnd, when that node's level equals this node's level.
+    struct NodeLinks
+    {
+        uint32_t parent;        // Index of parent node, or InvalidNodeIndex for top level nodes.
+        uint32_t subtreeEnd;    // Index just after the last descendant.
+    };
+
+    static const uint32_t InvalidNodeIndex = 0xFFFFFFFF;
+
+    void EnsureNodeLinks();
+    void RebuildNodeLinks();
+    void UpdateNodeLinksAfterInsert(uint32_t nodeIndex);
+    void UpdateNodeLinksAfterRemove(uint32_t nodeIndex, uint32_t endNodeIndex);
+    void UpdateNodeLinksAfterFlatten(uint32_t firstNodeIndex, uint32_t endNodeIndex, uint32_t parentNodeIndex);
+    void UpdateIndicesAfterAppend(uint32_t nodeIndex);
+    uint32_t GetPreviousSiblingNode(uint32_t nodeIndex, uint32_t nodeLevel) const;
+
+    // Hash index of the children under a single parent, keyed by the case
+    // folded hash of their text. Only built for parents with many children,
+    // and only once a parent has been searched more than once since the last
+    // modification, so that alternating lookups and inserts (like SetKey)
+    // do not pay for building an index that is immediately discarded. Only
+    // parents with enough children to be indexed ever have an entry.
+    struct ChildKeyIndex
+    {
+        uint32_t lookupCount = 0; // 1 after the first lookup, 3 once built.
+        std::unordered_multimap<uint32_t, uint32_t> childNodeIndices; // hash -> child node index
+    };
+
+    static const uint32_t MinimumIndexedChildCount = 8;
+
+    // Guards childKeyIndices_ during const lookups. Copying a tree gives the
+    // copy its own unlocked mutex.
+    struct ChildKeyIndicesMutex : std::shared_mutex
+    {
+        ChildKeyIndicesMutex() = default;
+        ChildKeyIndicesMutex(ChildKeyIndicesMutex const&) noexcept {}
+        ChildKeyIndicesMutex& operator=(ChildKeyIndicesMutex const&) noexcept { return *this; }
+    };
+
+    ChildKeyIndex const* GetChildKeyIndex(uint32_t parentNodeIndex) const;
+    static uint32_t GetKeyNameHash(__in_ecount(textLength) char16_t const* text, uint32_t textLength) noexcept;
+    static bool IsEqualKeyName(__in_ecount(textLength) char16_t const* text, __in_ecount(textLength) char16_t const* otherText, uint32_t textLength) noexcept;
+    bool IsMatchingNode(
+        uint32_t nodeIndex,
+        __in_ecount(textLength) char16_t const* text,
+        uint32_t textLength,
+        TextTree::Node::Type expectedType
+        ) const;
+
 private:
     std::vector<Node> nodes_;
     std::u16string nodesText_;  // Holds decoded text for cases for numeric codes: \u03A3 or &#931; or &#x03A3.
+    std::u16string sourceText_; // Parsed text adopted from TextTreeParser::ReadNodes, which nodes may refer into. Node text offsets beyond it refer to nodesText_.
+    std::vector<NodeLinks> nodeLinks_; // Kept in sync with nodes_ by every modification, so const methods never rebuild them.
+    mutable std::unordered_map<uint32_t, ChildKeyIndex> childKeyIndices_; // Parent node index -> child keys. Cleared on any modification except appending at the end.
+    mutable ChildKeyIndicesMutex childKeyIndicesMutex_;
+    std::vector<uint32_t> nodeTextBegins_; // Source text index where each node began, recorded when reading adopted text for ReparseNodes. Cleared on any modification.
+    std::vector<NodeNumber> nodeNumbers_; // Decoded number of each node, recorded when reading with TextTreeParser::OptionsDecodeNumbers. Cleared on any modification.
+    std::vector<uint32_t> nodeKeyIds_; // Interned name of each node (see GetKeyId). Kept in sync with nodes_, outside of Node to keep it small.
+    uint32_t editDepth_ = 0; // Nesting count of BeginEdits.
+    KeyNameTable keyNames_;
+    std::vector<uint32_t> keyNameTextStarts_; // Key id -> text of the first inserted node with that name, shared by later ones (InvalidTextStart if none yet).
+
+    static const uint32_t InvalidTextStart = 0xFFFFFFFF;
 };
 
 
@@ -379,6 +556,7 @@ public:
         */
         OptionsDiscardPureWhitespace= 0x00000008,   // (XML) Ignore spans of pure whitespace (space and CR/LF).
         OptionsNoEscapeSequence     = 0x00000010,   // (JSON) Allow unquoted keys if purely alphanumeric ASCII. So phar:"lap" is legal instead of needing "phar":"lap".
+        OptionsDecodeNumbers        = 0x00000020,   // Decode values that are plain numbers, quoted or not, into TextTree::NodeNumber (see GetNodeNumber and GetEventNumber).
     };
 
     struct Error
@@ -387,6 +565,23 @@ public:
         const char16_t* errorMessage;    // Weak pointer to static text data.
     };
 
+    // Zero-based line and column of a text index, with the column counted in
+    // code units. CR, LF, and CR LF each end a line.
+    struct TextPosition
+    {
+        uint32_t line;
+        uint32_t column;
+    };
+
+    // Events returned by ReadEvent, the streaming alternative to ReadNodes.
+    enum EventType
+    {
+        EventTypeNone,          // No more events.
+        EventTypeBeginNode,     // Key node (object, array, function, attribute, section) whose children follow.
+        EventTypeEndNode,       // End of the most recently begun key node still open.
+        EventTypeValue,         // Value or comment node without children.
+    };
+
 public:
     static TextTree::Syntax DetermineType(
         __in_ecount(textLength) const char16_t* text,
@@ -444,6 +639,41 @@ public:
     // Reads the entire string into the text tree's nodes.
     bool ReadNodes(__inout TextTree& textTree);
 
+    // Reads the entire string into an empty tree, resetting the parser to
+    // read the given text after the tree takes ownership of it. Rather than
+    // copying every name and value, the tree's nodes refer directly into the
+    // adopted text, except for JSONex words that needed decoding (escape
+    // sequences and merged comment lines). The tree's previous text buffer
+    // is handed back empty in the text, for reuse by the next read.
+    bool ReadNodes(__inout TextTree& textTree, __inout std::u16string&& text);
+
+    // Reads the next event without building a tree, like a SAX reader. Each
+    // key node yields a begin event, the events of its children, and then an
+    // end event (also at the end of the text for any still open). The node
+    // text is only valid until the next call, referring directly into the
+    // source text unless it needed decoding. Returns false at the end.
+    bool ReadEvent(
+        __out EventType& eventType,
+        __out TextTree::Node& node,
+        __out array_ref<char16_t const>& nodeText
+        );
+
+    // Updates a tree previously read from adopted text (ReadNodes with text)
+    // to match the edited text, rereading only the nodes at the given level
+    // (and their children) that enclose the changed text, and splicing them
+    // into the tree. If the change cannot be isolated to those nodes, such
+    // as when it alters a parent's brackets, the whole text is reread.
+    // Returns the range of nodes replaced, by its first index and old/new
+    // counts, with zero counts if nothing changed.
+    void ReparseNodes(
+        __inout TextTree& textTree,
+        __inout std::u16string&& text,
+        uint32_t nodeLevel,
+        __out uint32_t& firstNodeIndex,
+        __out uint32_t& oldNodeCount,
+        __out uint32_t& newNodeCount
+        );
+
     // Get the level (depth) of the current node.
     //
     // Given <Parent><Child></Child></Parent>
@@ -463,6 +693,37 @@ public:
     uint32_t GetErrorCount();
     void GetErrorDetails(uint32_t errorIndex, __out uint32_t& errorTextIndex, __out const char16_t** userErrorMessage);
 
+    // Records at most the given number of errors, continuing to read to the
+    // end and just counting any more, so that badly generated files with
+    // thousands of errors still parse quickly. The limit persists across
+    // Reset. GetErrorCount returns only the recorded errors.
+    void SetErrorLimit(uint32_t maxErrorCount) noexcept;
+    uint32_t GetTotalErrorCount() const noexcept; // Including those beyond the limit.
+
+    // Maps text indices of the current text (such as error positions) to
+    // line and column in one batch. The index of line beginnings is built on
+    // the first call after Reset, so each lookup is then just a search.
+    // Ascending indices are cheapest. The text must still be valid.
+    void GetTextPositions(
+        array_ref<uint32_t const> textIndices,
+        OUT array_ref<TextPosition> positions
+        );
+
+    // Maps the positions of all the recorded errors, in order.
+    void GetErrorPositions(OUT std::vector<TextPosition>& positions);
+
+    // The names of key nodes returned by ReadEvent, by GetEventKeyId. Nodes
+    // read into a tree are instead interned by the tree.
+    TextTree::KeyNameTable const& GetKeyNames() const noexcept;
+
+    // The interned name of the node from the last begin event, or
+    // InvalidKeyId after any other event.
+    uint32_t GetEventKeyId() const noexcept;
+
+    // The number decoded from the last value returned by ReadEvent, if read
+    // with OptionsDecodeNumbers. Returns false if it was not a number.
+    bool GetEventNumber(OUT TextTree::NodeNumber& number) const noexcept;
+
 protected:
     static void AppendCharacter(
         __inout std::u16string& nodeText,
@@ -478,9 +739,79 @@ protected:
 
     void ReportError(uint32_t errorTextIndex, const char16_t* userErrorMessage);
 
+    // Returns the text of a node previously read, whether it refers into the
+    // source text or was appended to the node text.
+    const char16_t* GetNodeText(
+        const TextTree::Node& node,
+        const std::u16string& nodeText
+        ) const noexcept;
+
+    // Returns the key id of a node just read, interning its name if a key.
+    uint32_t InternKeyName(
+        __inout TextTree::KeyNameTable& keyNames,
+        const TextTree::Node& node,
+        const std::u16string& nodeText
+        ) const;
+
+    // Decodes a value node just read if it is a plain number (see
+    // OptionsDecodeNumbers), returning FlagsNone for any other node.
+    TextTree::NodeNumber DecodeNodeNumber(
+        const TextTree::Node& node,
+        const std::u16string& nodeText
+        ) const;
+
+    bool ReparseChangedNodes(
+        __inout TextTree& textTree,
+        __inout std::u16string& text,
+        uint32_t nodeLevel,
+        __out uint32_t& firstNodeIndex,
+        __out uint32_t& oldNodeCount,
+        __out uint32_t& newNodeCount
+        );
+
+    // Nodes read from one chunk of the text.
+    struct NodeChunk
+    {
+        std::vector<TextTree::Node> nodes;
+        std::vector<uint32_t> nodeTextBegins;
+        std::vector<TextTree::NodeNumber> nodeNumbers; // Only with OptionsDecodeNumbers.
+        std::vector<uint32_t> nodeKeyIds; // From the chunk parser's key names.
+        std::u16string nodesText;
+    };
+
+    // Reads the text into an empty tree like ReadNodes with adopted text, but
+    // in chunks. This parser reads up to the first chunk begin, and then each
+    // chunk parser reads its chunk on a separate thread, resumed at the same
+    // level within the same parents. So each chunk must hold whole nodes of
+    // that level, except the last which reads to the end. The chunks' nodes
+    // are concatenated, or if any chunk did not read cleanly on its own, the
+    // whole text is read again on this thread.
+    bool ReadNodesInChunks(
+        __inout TextTree& textTree,
+        __inout std::u16string&& text,
+        array_ref<uint32_t const> chunkBegins,
+        array_ref<TextTreeParser* const> chunkParsers // One per chunk begin.
+        );
+
+    // Reserves room in an empty tree for the nodes of the text remaining,
+    // estimated from its length, so that the tree does not regrow as it is
+    // read. The node text is only reserved if names and values are copied.
+    void ReserveNodes(__inout TextTree& textTree) const;
+
+    // Reads nodes to the end of the text, referring into it, and appending
+    // them to the chunk.
+    void ReadNodeChunk(
+        uint32_t nodeTextBase,
+        __inout NodeChunk& chunk
+        );
+
 protected:
     virtual void ResetDerived();
 
+    // Restores the derived state for reading from the middle of the text,
+    // nested within the given key nodes (outermost first).
+    virtual void ResumeDerived(array_ref<TextTree::Node const> openNodes);
+
 protected:
     __field_ecount_opt(textLength_) char16_t const* text_ = nullptr;   // Weak pointer should be valid for lifetime of the parsing operation (or until Reset).
     uint32_t textLength_ = 0;
@@ -488,6 +819,23 @@ protected:
     uint32_t treeLevel_ = 0; // Current heirarchy level
     Options options_ = OptionsDefault;
     std::vector<Error> errors_;
+    uint32_t errorLimit_ = UINT32_MAX; // Maximum errors recorded (see SetErrorLimit).
+    uint32_t droppedErrorCount_ = 0; // Errors beyond the limit.
+    std::vector<uint32_t> lineBegins_; // Text index where each line begins, built on demand by GetTextPositions.
+    bool isReferencingText_ = false; // Nodes may refer directly into text_ instead of copying to the node text.
+    uint32_t nodeTextBase_ = 0; // Offset added to node starts for text appended to the node text.
+    uint32_t nodeTextBegin_ = 0; // Text index where the node most recently read began (its name, quote, or bracket).
+    TextTree::KeyNameTable keyNames_; // Key names of events and of chunks read in parallel, before merging into the tree's.
+
+    // Streaming event state.
+    std::u16string eventText_; // Decoded text of the current event's node.
+    uint32_t eventTextOffset_ = 0; // Total decoded text discarded by earlier events.
+    std::vector<TextTree::Node> eventNodeStack_; // Key nodes begun but not yet ended.
+    TextTree::Node pendingEventNode_ = {}; // Node read ahead while ending the open key nodes.
+    uint32_t pendingEventKeyId_ = TextTree::InvalidKeyId;
+    uint32_t eventKeyId_ = TextTree::InvalidKeyId; // Key id of the last begin event.
+    TextTree::NodeNumber eventNumber_ = {}; // Decoded number of the last value event.
+    bool hasPendingEventNode_ = false;
 };
 
 
@@ -562,6 +910,16 @@ public:
         __inout std::u16string& nodeText
         );
 
+    // Reads the adopted text like ReadNodes, but splits the objects of the
+    // largest array near the top (such as a settings file's object list)
+    // across threads, up to the given count (or one per processor if zero).
+    // Small text is just read on this thread.
+    bool ReadNodesParallel(
+        __inout TextTree& textTree,
+        __inout std::u16string&& text,
+        uint32_t threadCount = 0
+        );
+
 protected:
     bool ReadWord(
         __out TextTree::Node& node,
@@ -582,6 +940,7 @@ protected:
     void ClearAttributeOnStack();
 
     virtual void ResetDerived();
+    virtual void ResumeDerived(array_ref<TextTree::Node const> openNodes);
 
 protected:
     std::vector<TextTree::Node> nodeStack_;
@@ -640,11 +999,190 @@ public:
 protected:
     void InitializeDerived();
     void ResetDerived();
+    void ResumeDerived(array_ref<TextTree::Node const> openNodes);
     void SkipSpaces();
     void SkipSpacesAndLineBreaks();
 
 protected:
+    static const uint32_t InvalidLevel = UINT32_MAX;
+
     uint32_t sectionLevel_ = 0; // Start out of level 0 for key:value pairs until reaching a section.
+    uint32_t baseLevel_ = InvalidLevel; // Level of sections and global keys, set when reading begins.
+};
+
+
+class CsvParser : public TextTreeParser
+{
+    // Reads comma separated values (RFC 4180), where the first row names the
+    // columns. Fields may be quoted to contain commas, line breaks, or quotes
+    // (doubled).
+    //
+    //      text,fontSize,renderingMode
+    //      "Hello, world",12,natural
+    //      "Say ""hi""",24,
+    //
+    // Each row after the header is read as an object of attributes named by
+    // the header, the same shape as a settings file's objects list, so rows
+    // can be loaded straight into drawable objects. Empty fields are omitted.
+    //
+    //      Object      - Row
+    //      Attribute   - Column name from the header row
+    //      Value       - Field
+
+    using Base = TextTreeParser;
+
+public:
+    CsvParser();
+
+    CsvParser(
+        __in_ecount(textLength) const char16_t* text, // Pointer should be valid for the lifetime of the class.
+        uint32_t textLength,
+        Options options
+        );
+
+    template<typename ContiguousSequenceContainer>
+    inline CsvParser(const ContiguousSequenceContainer& text, Options options)
+        :   CsvParser(&(*std::begin(text)), static_cast<uint32_t>(std::end(text) - std::begin(text)), options)
+    { }
+
+    virtual bool ReadNode(
+        __out TextTree::Node& node,
+        __inout std::u16string& nodeText
+        );
+
+    // The column names of the header row, once the first node is read.
+    uint32_t GetColumnCount() const noexcept;
+    array_ref<char16_t const> GetColumnName(uint32_t columnIndex) const noexcept;
+
+protected:
+    void InitializeDerived();
+    void ResetDerived();
+    void ResumeDerived(array_ref<TextTree::Node const> openNodes);
+    void ReadHeader();
+    void ReadField(
+        __out TextTree::Node& node,
+        __inout std::u16string& nodeText
+        );
+    bool IsAtEmptyField() const;
+    void SkipFieldSeparator();
+    bool SkipLineBreak();
+
+protected:
+    enum State
+    {
+        StateHeader,        // The header row has not been read yet.
+        StateRowBegin,      // Next is a row's object node, after any blank lines.
+        StateFieldName,     // Next is a field's attribute node, or the row ends.
+        StateFieldValue,    // Next is the value of the attribute just read.
+    };
+
+    struct Column
+    {
+        uint32_t sourceStart;   // Where the name appears verbatim in the text, or InvalidSourceStart if it was decoded.
+        uint32_t start;         // Name in columnNamesText_.
+        uint32_t length;
+    };
+
+    static const uint32_t InvalidSourceStart = UINT32_MAX;
+
+    State state_ = StateHeader;
+    uint32_t columnIndex_ = 0; // Column of the next field in the row.
+    std::vector<Column> columns_;
+    std::u16string columnNamesText_;
+};
+
+
+class XmlParser : public TextTreeParser
+{
+    // Reads XML elements, attributes, text, and markup, streaming one node
+    // at a time like the other parsers. Names and text without entities
+    // refer directly into the source text, and entities are decoded by
+    // appending whole runs between them.
+    //
+    //      <?xml version="1.0"?>
+    //      <objects>
+    //          <object text="Hello &amp; goodbye" fontSize="12"/>
+    //          <!-- comment -->
+    //          <object><text>Hi</text></object>
+    //      </objects>
+    //
+    //      Element     - Element name, whose attributes and content follow as children
+    //      Attribute   - Attribute name
+    //      String      - Attribute value
+    //      Text        - Character data between tags
+    //      Data        - CDATA section contents
+    //      Comment     - Comment contents
+    //      Declaration - <?xml ... ?> contents
+    //      Directive   - Other processing instructions, and <!DOCTYPE ...>
+    //
+    // So an element holding attributes and elements, as read with
+    // OptionsDiscardPureWhitespace, has the same shape as a JSONex object.
+    // Line breaks are not normalized, and DTDs are not processed (so only the
+    // predefined and numeric character references are recognized).
+
+    using Base = TextTreeParser;
+
+public:
+    XmlParser();
+
+    XmlParser(
+        __in_ecount(textLength) const char16_t* text, // Pointer should be valid for the lifetime of the class.
+        uint32_t textLength,
+        Options options
+        );
+
+    template<typename ContiguousSequenceContainer>
+    inline XmlParser(const ContiguousSequenceContainer& text, Options options)
+        :   XmlParser(&(*std::begin(text)), static_cast<uint32_t>(std::end(text) - std::begin(text)), options)
+    { }
+
+    virtual bool ReadNode(
+        __out TextTree::Node& node,
+        __inout std::u16string& nodeText
+        );
+
+protected:
+    void InitializeDerived();
+    void ResetDerived();
+    void ResumeDerived(array_ref<TextTree::Node const> openNodes);
+    uint32_t ReadName();
+    void ReadCharacterData(
+        char16_t closingQuote, // Or nul for text content.
+        __out TextTree::Node& node,
+        __inout std::u16string& nodeText
+        );
+    bool ReadReference(__inout std::u16string& nodeText);
+    void ReadMarkup(
+        __out TextTree::Node& node,
+        __inout std::u16string& nodeText
+        );
+    void ReadEndTag();
+    void SetNodeText(
+        uint32_t textIndex,
+        uint32_t textLength,
+        __inout TextTree::Node& node,
+        __inout std::u16string& nodeText
+        );
+    bool IsMatchingText(uint32_t textIndex, __in_z char16_t const* matchText) const;
+
+protected:
+    enum State
+    {
+        StateContent,           // Next is text or markup between tags.
+        StateAttributeName,     // Inside a start tag, next is an attribute or the tag end.
+        StateAttributeValue,    // Next is the value of the attribute just read.
+    };
+
+    struct OpenElement
+    {
+        uint32_t nameStart;     // Name in the source text, or InvalidSourceStart if unknown.
+        uint32_t nameLength;
+    };
+
+    static const uint32_t InvalidSourceStart = UINT32_MAX;
+
+    State state_ = StateContent;
+    std::vector<OpenElement> openElements_; // For matching end tags.
 };
 
 
@@ -683,6 +1221,18 @@ public:
     // Reads the text into the string.
     void GetText(OUT std::u16string& text) const;
 
+    // Receives written text as UTF-8, one buffer at a time.
+    using Sink = std::function<HRESULT(array_ref<uint8_t const> data)>;
+
+    // Sends the text to the sink as UTF-8 whenever at least the buffer size
+    // of code units accumulates after a node, rather than keeping the entire
+    // text in memory. GetText then returns only the text not yet sent, and
+    // Flush must be called after the last node.
+    void SetSink(Sink sink, uint32_t bufferSize = DefaultSinkBufferSize);
+
+    // Sends any remaining text to the sink.
+    HRESULT Flush();
+
     virtual HRESULT EnterNode();
 
     virtual HRESULT ExitNode();
@@ -694,10 +1244,25 @@ public:
         uint32_t textLength = 0xFFFFFFFF
         ) noexcept;
 
+    static const uint32_t DefaultSinkBufferSize = 65536;
+
 protected:
-    std::u16string text_; // Starts empty and grows with each written node.
+    // Sends the text to the sink if the buffer is full.
+    HRESULT FlushIfFull();
+
+    HRESULT FlushText(bool isFinal);
+
+    // Whether any text was written, including text already sent to the sink.
+    bool HasWrittenText() const noexcept;
+
+protected:
+    std::u16string text_; // Starts empty and grows with each written node (until sent to any sink).
     uint32_t nodeLevel_ = 0; // Current heirarchy level
     Options options_ = OptionsDefault;
+    Sink sink_;
+    uint32_t sinkBufferSize_ = 0;
+    std::vector<uint8_t> sinkBuffer_; // Fixed size buffer of UTF-8 sent to the sink.
+    bool hasFlushedText_ = false;
 };
 
 
@@ -832,5 +1397,6 @@ protected:
     bool isInsideOpeningTag_;
     TextTree::Node::Type previousType_;
     std::u16string spaceBuffer_;
-    std::vector<TextTree::Node> nodeStack_;
+    std::vector<TextTree::Node> nodeStack_; // Element node starts refer into elementNames_.
+    std::u16string elementNames_; // Names of the open elements, for their closing tags, since the text may already be sent to a sink.
 };
@@ -36,6 +36,53 @@ namespace
             value + (value < 10 ? '0' : 'A' - 10)
             );
     }
+
+    // Header of the image from TextTree::WriteBinary, which is followed by
+    // the nodes, where each node began in the source text (if recorded), the
+    // decoded node numbers (if recorded), and the decoded node text. The
+    // source text itself is not stored, since the reader has the source.
+    struct TextTreeBinaryHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t nodeCount;
+        uint32_t sourceTextLength;
+        uint32_t nodesTextLength;
+        uint32_t nodeTextBeginCount; // Either 0 or nodeCount.
+        uint32_t nodeNumberCount;    // Either 0 or nodeCount.
+        uint32_t reserved;
+    };
+
+    const uint32_t TextTreeBinaryMagic = 0x42525454; // 'TTRB'
+    const uint32_t TextTreeBinaryVersion = 6;
+
+    // Decodes text that is entirely a plain decimal number, like "-12" or
+    // "3.25e2", using the same decoder as numeric attribute arrays. Anything
+    // else, like trailing units or inexact floats, is left for the caller to
+    // parse the usual way.
+    void DecodeNumber(
+        __in_ecount(textLength) const char16_t* text,
+        uint32_t textLength,
+        OUT TextTree::NodeNumber& number
+        )
+    {
+        number = {};
+        const char16_t* const end = text + textLength;
+
+        uint32_t integerValue;
+        if (DecodeDecimalInteger(text, end, OUT integerValue) == end)
+        {
+            number.integerValue = integerValue;
+            number.flags = TextTree::NodeNumber::Flags(number.flags | TextTree::NodeNumber::FlagsInteger);
+        }
+        float floatValue;
+        if (DecodeDecimalFloat(text, end, OUT floatValue) == end)
+        {
+            number.floatValue = floatValue;
+            number.flags = TextTree::NodeNumber::Flags(number.flags | TextTree::NodeNumber::FlagsFloat);
+        }
+    }
 }
 
 
@@ -173,11 +220,16 @@ TextTree::NodePointer TextTree::NodePointer::end()
 
     NodePointer pointer(textTree_, nodeIndex_);
     if (!IsValid()
-    ||  !textTree_.AdvanceNode(AdvanceNodeDirectionLineageChild, 1, /*inout*/ pointer.nodeIndex_) // todo: debate AdvanceNodeDirectionLineageChild and true/false
-    ||  !textTree_.AdvanceNode(AdvanceNodeDirectionSiblingNextEnd, INT32_MAX, /*inout*/ pointer.nodeIndex_))
+    ||  !textTree_.AdvanceNode(AdvanceNodeDirectionLineageChild, 1, /*inout*/ pointer.nodeIndex_)) // todo: debate AdvanceNodeDirectionLineageChild and true/false
     {
         pointer.MarkInvalid(); // todo: debate whether the call should be false if count not reached
     }
+    else
+    {
+        // The last child ends where this node's subtree ends, so there is no
+        // need to walk across all the siblings.
+        pointer.nodeIndex_ = textTree_.nodeLinks_[nodeIndex_].subtreeEnd;
+    }
 
     return pointer;
 }
@@ -261,6 +313,26 @@ std::u16string TextTree::NodePointer::GetSubvalue(__in_ecount(defaultTextLength)
 }
 
 
+bool TextTree::NodePointer::GetSubvalueNumber(OUT NodeNumber& number) const
+{
+    number = {};
+    if (!IsValid())
+        return false;
+
+    const auto valueNodeIndex = textTree_.FindSingleSubvalue(nodeIndex_);
+    return valueNodeIndex != InvalidNodeIndex && textTree_.GetNodeNumber(valueNodeIndex, OUT number);
+}
+
+
+uint32_t TextTree::NodePointer::GetKeyId() const
+{
+    if (!IsValid())
+        return InvalidKeyId;
+
+    return textTree_.GetKeyId(nodeIndex_);
+}
+
+
 
 TextTree::NodePointer TextTree::NodePointer::AppendChild(
     TextTree::Node::Type type,
@@ -288,1256 +360,3537 @@ bool TextTree::NodePointer::SetKeyValue(
 }
 
 
-uint32_t TextTree::GetNodeCount() const noexcept
+uint32_t TextTree::KeyNameTable::Intern(__in_ecount(textLength) char16_t const* text, uint32_t textLength)
 {
-    return static_cast<uint32_t>(nodes_.size());
+    const uint32_t hash = GetKeyNameHash(text, textLength);
+    if (!buckets_.empty())
+    {
+        const uint32_t keyId = buckets_[FindBucket(text, textLength, hash)];
+        if (keyId != 0)
+            return keyId - 1;
+    }
+
+    // Keep the table at most half full.
+    if ((entries_.size() + 1) * 2 > buckets_.size())
+    {
+        Rehash(std::max(uint32_t(buckets_.size() * 2), 64u));
+    }
+
+    const uint32_t keyId = static_cast<uint32_t>(entries_.size());
+    Entry entry = {static_cast<uint32_t>(namesText_.size()), textLength, hash};
+    entries_.push_back(entry);
+    namesText_.append(text, textLength);
+    buckets_[FindBucket(text, textLength, hash)] = keyId + 1;
+
+    return keyId;
 }
 
 
-bool TextTree::empty() const noexcept
+uint32_t TextTree::KeyNameTable::Find(__in_ecount(textLength) char16_t const* text, uint32_t textLength) const noexcept
 {
-    return nodes_.empty(); // todo: always create empty root.
+    if (buckets_.empty())
+        return InvalidKeyId;
+
+    return buckets_[FindBucket(text, textLength, GetKeyNameHash(text, textLength))] - 1; // Empty buckets wrap to InvalidKeyId.
 }
 
 
-TextTree::iterator TextTree::begin()
+uint32_t TextTree::KeyNameTable::FindBucket(__in_ecount(textLength) char16_t const* text, uint32_t textLength, uint32_t hash) const noexcept
 {
-    return NodePointer(*this);
+    // Returns the bucket holding the name, or the empty one where it belongs.
+    const uint32_t bucketMask = static_cast<uint32_t>(buckets_.size() - 1);
+    for (uint32_t bucketIndex = hash & bucketMask; ; bucketIndex = (bucketIndex + 1) & bucketMask)
+    {
+        const uint32_t keyId = buckets_[bucketIndex];
+        if (keyId == 0)
+            return bucketIndex;
+
+        auto const& entry = entries_[keyId - 1];
+        if (entry.hash == hash
+        &&  entry.length == textLength
+        &&  memcmp(namesText_.data() + entry.start, text, textLength * sizeof(char16_t)) == 0)
+        {
+            return bucketIndex;
+        }
+    }
 }
 
 
-TextTree::iterator TextTree::end()
+void TextTree::KeyNameTable::Rehash(uint32_t bucketCount)
 {
-    return NodePointer(*this, GetNodeCount());
+    buckets_.assign(bucketCount, 0);
+    const uint32_t bucketMask = bucketCount - 1;
+    for (uint32_t keyId = 0, keyCount = static_cast<uint32_t>(entries_.size()); keyId < keyCount; ++keyId)
+    {
+        uint32_t bucketIndex = entries_[keyId].hash & bucketMask;
+        while (buckets_[bucketIndex] != 0)
+        {
+            bucketIndex = (bucketIndex + 1) & bucketMask;
+        }
+        buckets_[bucketIndex] = keyId + 1;
+    }
 }
 
 
-TextTree::iterator TextTree::BeginFirstChild()
+array_ref<char16_t const> TextTree::KeyNameTable::GetName(uint32_t keyId) const noexcept
 {
-    return NodePointer(*this, 1, AdvanceNodeDirectionSiblingNextEnd);
+    if (keyId >= entries_.size())
+        return array_ref<char16_t const>();
+
+    auto const& entry = entries_[keyId];
+    return array_ref<char16_t const>(namesText_.data() + entry.start, entry.length);
 }
 
 
-void TextTree::Clear()
+uint32_t TextTree::KeyNameTable::GetCount() const noexcept
 {
-    // Reset the tree and release all memory.
-    nodes_.clear();
-    nodes_.shrink_to_fit();
-    nodesText_.clear();
-    nodesText_.shrink_to_fit();
+    return static_cast<uint32_t>(entries_.size());
 }
 
 
-TextTree::Node::Type TextTree::Node::GetGenericType() const noexcept
+void TextTree::KeyNameTable::Clear()
 {
-    return static_cast<TextTree::Node::Type>(this->type & TypeGenericMask);
+    namesText_.clear();
+    entries_.clear();
+    buckets_.clear();
 }
 
 
-TextTree::Node& TextTree::GetNode(uint32_t nodeIndex)
+TextTree::KeyNameTable const& TextTree::GetKeyNames() const noexcept
 {
-    assert(nodeIndex < nodes_.size());
-    if (nodeIndex >= nodes_.size())
-    {
-        return *static_cast<Node*>(nullptr); // Force AV.
-    }
-    return nodes_[nodeIndex];
+    return keyNames_;
 }
 
 
-const TextTree::Node& TextTree::GetNode(uint32_t nodeIndex) const
+uint32_t TextTree::GetNodeCount() const noexcept
 {
-    assert(nodeIndex < nodes_.size());
-    if (nodeIndex >= nodes_.size())
-    {
-        return *static_cast<Node*>(nullptr); // Force AV.
-    }
-    return nodes_[nodeIndex];
+    return static_cast<uint32_t>(nodes_.size());
 }
 
 
-const char16_t* TextTree::GetText(const Node& node, __out uint32_t& textLength) const noexcept
+bool TextTree::empty() const noexcept
 {
-    assert(size_t(&node - nodes_.data()) < nodes_.size());
-    textLength = node.length;
-    return nodesText_.data() + node.start;
+    return nodes_.empty(); // todo: always create empty root.
 }
 
 
-void TextTree::GetText(const Node& node, __out std::u16string& text) const
+TextTree::iterator TextTree::begin()
 {
-    assert(size_t(&node - nodes_.data()) < nodes_.size());
-    auto textPointer = &nodesText_[node.start];
-    text.assign(textPointer, textPointer + node.length);
+    return NodePointer(*this);
 }
 
 
-void TextTree::GetText(uint32_t nodeIndex, __out std::u16string& text) const
+TextTree::iterator TextTree::end()
 {
-    auto& node = GetNode(nodeIndex);
-    auto textPointer = &nodesText_[node.start];
-    text.assign(textPointer, textPointer + node.length);
+    return NodePointer(*this, GetNodeCount());
 }
 
 
-void TextTree::SetText(__inout Node& node, const std::u16string& text)
+TextTree::iterator TextTree::BeginFirstChild()
 {
-    SetText(node, text.c_str(), static_cast<uint32_t>(text.size()));
+    return NodePointer(*this, 1, AdvanceNodeDirectionSiblingNextEnd);
 }
 
 
-void TextTree::SetText(__inout Node& node, __in_ecount(textLength) const char16_t* text, uint32_t textLength)
+void TextTree::Clear(bool shouldReleaseMemory)
 {
-    assert(size_t(&node - nodes_.data()) < nodes_.size());
-    const uint32_t start  = static_cast<uint32_t>(nodesText_.size());
-    nodesText_.append(text, textLength);
-    node.start = start;
-    node.length = textLength;
+    // Reset the tree, optionally keeping its capacity for reuse.
+    nodes_.clear();
+    nodesText_.clear();
+    sourceText_.clear();
+    nodeLinks_.clear();
+    childKeyIndices_.clear();
+    nodeTextBegins_.clear();
+    nodeNumbers_.clear();
+    nodeKeyIds_.clear();
+    keyNames_.Clear();
+    keyNameTextStarts_.clear();
+
+    if (shouldReleaseMemory)
+    {
+        nodes_.shrink_to_fit();
+        nodesText_.shrink_to_fit();
+        sourceText_.shrink_to_fit();
+        nodeLinks_.shrink_to_fit();
+        nodeTextBegins_.shrink_to_fit();
+        nodeNumbers_.shrink_to_fit();
+        nodeKeyIds_.shrink_to_fit();
+    }
 }
 
 
-bool TextTree::AdvanceNode(
-    AdvanceNodeDirection direction,
-    int32_t nodeCount,
-    __inout uint32_t& matchingNodeIndex
-    ) const
+void TextTree::InvalidateIndices()
 {
-    // Resolve the specific directions into a generic direction with count, negated if needed.
-    auto resolvedDirection = direction & AdvanceNodeDirectionMask;
-    bool endsAreInclusive = false;
-    switch (direction)
+    RebuildNodeLinks();
+    childKeyIndices_.clear();
+    nodeTextBegins_.clear();
+    nodeNumbers_.clear();
+}
+
+
+void TextTree::BeginEdits(uint32_t expectedNodeCount, uint32_t expectedTextLength)
+{
+    ++editDepth_;
+    if (expectedNodeCount > 0)
     {
-    case AdvanceNodeDirectionSibling:               break;
-    case AdvanceNodeDirectionLineage:               break;
-    case AdvanceNodeDirectionSiblingNext:           resolvedDirection = AdvanceNodeDirectionSibling;                         break;
-    case AdvanceNodeDirectionSiblingPrevious:       resolvedDirection = AdvanceNodeDirectionSibling; nodeCount = -nodeCount; break;
-    case AdvanceNodeDirectionLineageChild:          resolvedDirection = AdvanceNodeDirectionLineage;                         break;
-    case AdvanceNodeDirectionLineageParent:         resolvedDirection = AdvanceNodeDirectionLineage; nodeCount = -nodeCount; break;
-    case AdvanceNodeDirectionSiblingNextEnd:        resolvedDirection = AdvanceNodeDirectionSibling;                         endsAreInclusive = true; break;
-    case AdvanceNodeDirectionSiblingPreviousEnd:    resolvedDirection = AdvanceNodeDirectionSibling; nodeCount = -nodeCount; endsAreInclusive = true; break;
-    case AdvanceNodeDirectionLineageChildEnd:       resolvedDirection = AdvanceNodeDirectionLineage;                         endsAreInclusive = true; break;
-    case AdvanceNodeDirectionLineageParentEnd:      resolvedDirection = AdvanceNodeDirectionLineage; nodeCount = -nodeCount; endsAreInclusive = true; break;
-    default:                                        return false;
+        EnsureNodeLinks();
+        nodes_.reserve(nodes_.size() + expectedNodeCount);
+        nodeLinks_.reserve(nodes_.size() + expectedNodeCount);
     }
+    nodesText_.reserve(nodesText_.size() + expectedTextLength);
+}
 
-    const auto nodesCount = nodes_.size();
-    auto nodeIndex = matchingNodeIndex;
-    auto parentNodeLevel = 0u;
-    if (nodeIndex < nodesCount)
+
+void TextTree::EndEdits() noexcept
+{
+    assert(editDepth_ > 0);
+    if (editDepth_ > 0)
+        --editDepth_;
+}
+
+
+void TextTree::WriteBinary(uint64_t sourceHash, OUT std::vector<uint8_t>& data) const
+{
+    static_assert(sizeof(Node) == 16, "Increment TextTreeBinaryVersion when the node layout changes.");
+    static_assert(sizeof(NodeNumber) == 12, "Increment TextTreeBinaryVersion when the node number layout changes.");
+
+    TextTreeBinaryHeader header = {
+        TextTreeBinaryMagic,
+        TextTreeBinaryVersion,
+        sourceHash,
+        static_cast<uint32_t>(nodes_.size()),
+        static_cast<uint32_t>(sourceText_.size()),
+        static_cast<uint32_t>(nodesText_.size()),
+        static_cast<uint32_t>(nodeTextBegins_.size()),
+        static_cast<uint32_t>(nodeNumbers_.size()),
+        0, // reserved
+    };
+
+    auto appendBytes = [&data](void const* source, size_t sourceSize)
     {
-        parentNodeLevel = GetNode(nodeIndex).level;
-    }
-    else if (nodeCount > 0)
+        auto bytes = static_cast<uint8_t const*>(source);
+        data.insert(data.end(), bytes, bytes + sourceSize);
+    };
+
+    data.clear();
+    data.reserve(
+        sizeof(header)
+        + nodes_.size() * sizeof(Node)
+        + nodeTextBegins_.size() * sizeof(uint32_t)
+        + nodeNumbers_.size() * sizeof(NodeNumber)
+        + nodesText_.size() * sizeof(char16_t)
+        );
+    appendBytes(&header, sizeof(header));
+    appendBytes(nodes_.data(), nodes_.size() * sizeof(Node));
+    appendBytes(nodeTextBegins_.data(), nodeTextBegins_.size() * sizeof(uint32_t));
+    appendBytes(nodeNumbers_.data(), nodeNumbers_.size() * sizeof(NodeNumber));
+    appendBytes(nodesText_.data(), nodesText_.size() * sizeof(char16_t));
+}
+
+
+bool TextTree::ReadBinary(array_ref<uint8_t const> data, uint64_t sourceHash, std::u16string&& sourceText)
+{
+    TextTreeBinaryHeader header;
+    if (data.size() < sizeof(header))
+        return false;
+
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != TextTreeBinaryMagic
+    ||  header.version != TextTreeBinaryVersion
+    ||  header.sourceHash != sourceHash
+    ||  header.sourceTextLength != sourceText.size())
     {
-        return false; // Cannot move past end of list. todo: if endsAreInclusive = true, then allow nodeIndex == nodesCount?
+        return false;
     }
-    else // Clamp the count and leave level = 0.
+
+    if ((header.nodeTextBeginCount != 0 && header.nodeTextBeginCount != header.nodeCount)
+    ||  (header.nodeNumberCount != 0 && header.nodeNumberCount != header.nodeCount))
     {
-        nodeIndex = static_cast<uint32_t>(nodesCount);
+        return false;
     }
 
-    if (nodeCount == 0)
+    uint64_t const nodesSize = uint64_t(header.nodeCount) * sizeof(Node);
+    uint64_t const nodeTextBeginsSize = uint64_t(header.nodeTextBeginCount) * sizeof(uint32_t);
+    uint64_t const nodeNumbersSize = uint64_t(header.nodeNumberCount) * sizeof(NodeNumber);
+    uint64_t const nodesTextSize = uint64_t(header.nodesTextLength) * sizeof(char16_t);
+    if (data.size() != sizeof(header) + nodesSize + nodeTextBeginsSize + nodeNumbersSize + nodesTextSize)
+        return false;
+
+    // Copy the nodes out (the data need not be aligned), and validate them
+    // before replacing anything, so that a corrupt image cannot leave nodes
+    // referring beyond their text or skipping levels.
+    uint8_t const* bytes = data.data() + sizeof(header);
+    std::vector<Node> nodes(header.nodeCount);
+    if (!nodes.empty())
     {
-        return true; // Successfully moved zero nodes.
+        memcpy(nodes.data(), bytes, static_cast<size_t>(nodesSize));
     }
+    bytes += nodesSize;
 
-    if (nodeCount > 0) // Search forward.
+    uint32_t previousLevel = 0;
+    for (auto const& node : nodes)
     {
-        if (nodeIndex < nodesCount)
+        bool isInSourceText = node.start < header.sourceTextLength;
+        uint64_t textEnd = uint64_t(node.start) + node.length;
+        if (isInSourceText ? textEnd > header.sourceTextLength
+                           : textEnd > uint64_t(header.sourceTextLength) + header.nodesTextLength)
         {
-            nodeIndex++;
-            while (nodeIndex < nodesCount)
-            {
-                // Look for sibling at same level or child at lower level.
+            return false;
+        }
+        if (&node == nodes.data() ? node.level != 0 : node.level > previousLevel + 1)
+            return false;
 
-                const auto nodeLevel = nodes_[nodeIndex].level;
-                if (nodeLevel < parentNodeLevel)
-                    break;
+        previousLevel = node.level;
+    }
 
-                bool isMatch;
-                if (resolvedDirection == AdvanceNodeDirectionSibling)
-                {
-                    isMatch = (nodeLevel == parentNodeLevel);
-                }
-                else // resolvedDirection == AdvanceNodeDirectionLineage
-                {
-                    isMatch = (nodeLevel > parentNodeLevel);
-                    if (!isMatch)
-                    {
-                        break;
-                    }
-                    parentNodeLevel = nodeLevel; // Update to new level.
-                }
+    // Reparsing searches the node beginnings, so they must be in order.
+    std::vector<uint32_t> nodeTextBegins(header.nodeTextBeginCount);
+    if (!nodeTextBegins.empty())
+    {
+        memcpy(nodeTextBegins.data(), bytes, static_cast<size_t>(nodeTextBeginsSize));
+    }
+    bytes += nodeTextBeginsSize;
 
-                if (isMatch)
-                {
-                    // Count another match, and update the node index.
-                    matchingNodeIndex = nodeIndex;
-                    if (--nodeCount <= 0)
-                    {
-                        return true;
-                    }
-                }
-                ++nodeIndex;
-            }
-        }
+    uint32_t previousNodeTextBegin = 0;
+    for (uint32_t nodeTextBegin : nodeTextBegins)
+    {
+        if (nodeTextBegin < previousNodeTextBegin || nodeTextBegin > header.sourceTextLength)
+            return false;
 
-        if (endsAreInclusive)
-        {
-            matchingNodeIndex = nodeIndex;
-            return true; // todo: debate whether this should be false if count not reached
-        }
+        previousNodeTextBegin = nodeTextBegin;
     }
-    else // Search backward.
-    {
-        while (nodeIndex > 0)
-        {
-            --nodeIndex;
-            const auto nodeLevel = nodes_[nodeIndex].level;
-            bool isMatch;
-            if (resolvedDirection == AdvanceNodeDirectionSibling)
-            {
-                if (nodeLevel < parentNodeLevel)
-                    break;
-                isMatch = (nodeLevel == parentNodeLevel);
-            }
-            else // resolvedDirection == AdvanceNodeDirectionLineage
-            {
-                isMatch = (nodeLevel < parentNodeLevel);
-            }
 
-            if (isMatch)
-            {
-                matchingNodeIndex = nodeIndex;
-                if (++nodeCount >= 0)
-                {
-                    return true;
-                }
-            }
-        }
+    std::vector<NodeNumber> nodeNumbers(header.nodeNumberCount);
+    if (!nodeNumbers.empty())
+    {
+        memcpy(nodeNumbers.data(), bytes, static_cast<size_t>(nodeNumbersSize));
+    }
+    bytes += nodeNumbersSize;
 
-        if (endsAreInclusive)
-        {
-            return true; // todo: debate whether this should be false if count not reached
-        }
+    for (auto const& nodeNumber : nodeNumbers)
+    {
+        if (nodeNumber.flags & ~(NodeNumber::FlagsInteger | NodeNumber::FlagsFloat))
+            return false;
     }
 
-    return false;
-}
+    nodes_ = std::move(nodes);
+    sourceText_ = std::move(sourceText);
+    nodesText_.resize(header.nodesTextLength);
+    memcpy(&nodesText_[0], bytes, static_cast<size_t>(nodesTextSize));
 
+    // Key ids are particular to the tree that interned them.
+    keyNames_.Clear();
+    keyNameTextStarts_.clear();
+    InternKeyNames(0);
 
-bool TextTree::AdvanceNextNode(__inout uint32_t& matchingNodeIndex) const
-{
-    return AdvanceNode(AdvanceNodeDirectionSiblingNext, 1, /*inout*/ matchingNodeIndex);
+    RebuildNodeLinks();
+    childKeyIndices_.clear();
+    nodeTextBegins_ = std::move(nodeTextBegins);
+    nodeNumbers_ = std::move(nodeNumbers);
+
+    return true;
 }
 
 
-bool TextTree::AdvancePreviousNode(__inout uint32_t& matchingNodeIndex) const
+uint64_t TextTree::GetSourceHash(array_ref<uint8_t const> sourceData, uint64_t salt) noexcept
 {
-    return AdvanceNode(AdvanceNodeDirectionSiblingPrevious, 1, /*inout*/ matchingNodeIndex);
-}
+    // FNV-1a style, but consuming 64-bit words for speed on large files. This
+    // only needs to notice a changed file, not resist deliberate collisions.
+    const uint64_t prime = 0x00000100000001B3;
+    uint64_t hash = 0xCBF29CE484222325 ^ salt;
 
+    uint8_t const* bytes = sourceData.data();
+    size_t const size = sourceData.size();
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * prime;
+    }
 
-bool TextTree::AdvanceChildNode(__inout uint32_t& nodeIndex) const
-{
-    return AdvanceNode(AdvanceNodeDirectionLineageChild, 1, /*inout*/ nodeIndex);
+    return (hash ^ size) * prime;
 }
 
 
-bool TextTree::AdvanceParentNode(__inout uint32_t& nodeIndex) const
+void TextTree::EnsureNodeLinks()
 {
-    return AdvanceNode(AdvanceNodeDirectionLineageParent, 1, /*inout*/ nodeIndex);
+    if (nodeLinks_.size() != nodes_.size())
+    {
+        RebuildNodeLinks();
+    }
 }
 
 
-bool TextTree::AdvanceLastSiblingNode(__inout uint32_t& matchingNodeIndex) const
+void TextTree::RebuildNodeLinks()
 {
-    AdvanceNode(AdvanceNodeDirectionSiblingNext, INT32_MAX, /*inout*/ matchingNodeIndex);
-    return true; // Ignore whether the count was satisfied.
-}
+    // Build the links in a single pass, keeping a stack of the open ancestors.
+    // Each node closes any open nodes at the same level or deeper, since their
+    // subtrees must have ended just before it.
+    const auto nodesCount = static_cast<uint32_t>(nodes_.size());
+    nodeLinks_.resize(nodesCount);
 
+    std::vector<uint32_t> ancestors;
+    for (uint32_t nodeIndex = 0; nodeIndex < nodesCount; ++nodeIndex)
+    {
+        const auto nodeLevel = nodes_[nodeIndex].level;
+        while (!ancestors.empty() && nodes_[ancestors.back()].level >= nodeLevel)
+        {
+            nodeLinks_[ancestors.back()].subtreeEnd = nodeIndex;
+            ancestors.pop_back();
+        }
 
-bool TextTree::AdvanceFirstSiblingNode(__inout uint32_t& matchingNodeIndex) const
-{
-    AdvanceNode(AdvanceNodeDirectionSiblingPrevious, INT32_MAX, /*inout*/ matchingNodeIndex);
-    return true; // Ignore whether the count was satisfied.
+        auto& links = nodeLinks_[nodeIndex];
+        links.parent = ancestors.empty() ? InvalidNodeIndex : ancestors.back();
+        links.subtreeEnd = nodeIndex + 1;
+        ancestors.push_back(nodeIndex);
+    }
+
+    for (auto nodeIndex : ancestors)
+    {
+        nodeLinks_[nodeIndex].subtreeEnd = nodesCount;
+    }
 }
 
 
-bool TextTree::AdvanceIntoEmptyNode(__inout uint32_t& matchingNodeIndex) const
+void TextTree::UpdateNodeLinksAfterInsert(uint32_t nodeIndex)
 {
-    if (matchingNodeIndex >= nodes_.size())
-        return false;
+    // A new leaf node was inserted into nodes_ at nodeIndex, but the links
+    // still describe the tree before insertion.
+    const auto nodesCount = static_cast<uint32_t>(nodes_.size());
+    const auto nodeLevel = nodes_[nodeIndex].level;
+    if (nodeLinks_.size() + 1 != nodesCount
+    ||  (nodeIndex + 1 < nodesCount && nodes_[nodeIndex + 1].level > nodeLevel))
+    {
+        // Either the links were already stale, or the new node adopts the
+        // deeper nodes following it as children. Just rebuild them all.
+        RebuildNodeLinks();
+        return;
+    }
 
-    // Check the first node to see if it is empty.
-    auto& node = nodes_[matchingNodeIndex];
-    if (node.length == 0 && node.GetGenericType() == node.TypeKey)
-        return AdvanceChildNode(/*inout*/ matchingNodeIndex);
+    // The parent is the nearest preceding node that is shallower.
+    uint32_t parentNodeIndex = nodeIndex - 1;
+    while (parentNodeIndex != InvalidNodeIndex && nodes_[parentNodeIndex].level >= nodeLevel)
+    {
+        parentNodeIndex = nodeLinks_[parentNodeIndex].parent;
+    }
 
-    return false;
-}
-
-
-bool TextTree::Find(
-    uint32_t firstNodeIndex,
-    bool firstNodeIndexIsParent, // start looking from first child of firstNodeIndex
-    __in_ecount(textLength) char16_t const* text,
-    uint32_t textLength,
-    TextTree::Node::Type expectedType,
-    __out uint32_t& matchingNodeIndex // remains unchanged if no match
-    ) const
-{
-    // Get first child node.
-    const auto nodesCount = nodes_.size();
-    auto nodeIndex = firstNodeIndex;
-
-    if (firstNodeIndexIsParent && !AdvanceChildNode(/*inout*/ nodeIndex))
+    // Shift all indices after the insertion point. Appending at the very end
+    // needs no shifting, which keeps Append cheap. Only nodes after the
+    // insertion point can have parents at or beyond it, and only ancestors of
+    // the displaced node can have subtrees spanning it, so the cost is the
+    // distance from the end rather than the whole tree.
+    if (nodeIndex + 1 < nodesCount)
     {
-        return false;
-    }
-
-    // Search for node with matching text and type.
-    // If more than one node exists, return the first match.
-    while (nodeIndex < nodesCount)
-    {
-        uint32_t currentTextLength = 0;
-        auto& node = nodes_[nodeIndex];
-        auto currentText = GetText(node, OUT currentTextLength);
-
-        if (currentTextLength == textLength && _wcsnicmp(ToWChar(text), ToWChar(currentText), currentTextLength) == 0)
+        const auto oldNodesCount = static_cast<uint32_t>(nodeLinks_.size());
+        for (auto i = nodeIndex; i < oldNodesCount; ++i)
         {
-            // Return true if the text matches and it is the expected type (or the type is irrelevant).
-            if (expectedType == TextTree::Node::TypeNone
-            ||  node.type == expectedType
-            ||  node.GetGenericType() == expectedType)
-            {
-                matchingNodeIndex = nodeIndex;
-                return true;
-            }
+            auto& links = nodeLinks_[i];
+            if (links.parent != InvalidNodeIndex && links.parent >= nodeIndex)
+                ++links.parent;
+            ++links.subtreeEnd;
+        }
+        for (auto i = nodeIndex - 1; i != InvalidNodeIndex; i = nodeLinks_[i].parent)
+        {
+            if (nodeLinks_[i].subtreeEnd > nodeIndex)
+                ++nodeLinks_[i].subtreeEnd;
         }
+    }
 
-        if (!AdvanceNextNode(/*inout*/ nodeIndex))
-            break;
+    // Ancestors whose subtrees ended right at the insertion point now contain
+    // the new node. Preceding siblings still end there.
+    for (auto ancestorNodeIndex = parentNodeIndex; ancestorNodeIndex != InvalidNodeIndex; ancestorNodeIndex = nodeLinks_[ancestorNodeIndex].parent)
+    {
+        auto& subtreeEnd = nodeLinks_[ancestorNodeIndex].subtreeEnd;
+        if (subtreeEnd == nodeIndex)
+            subtreeEnd = nodeIndex + 1;
     }
 
-    return false;
+    NodeLinks links = {parentNodeIndex, nodeIndex + 1};
+    nodeLinks_.insert(nodeLinks_.begin() + nodeIndex, links);
 }
 
 
-bool TextTree::FindKey(
-    uint32_t parentNodeIndex,
-    __in_z char16_t const* keyName,
-    __inout uint32_t& matchingKeyNodeIndex // remains unchanged if no match
-    ) const
+void TextTree::UpdateNodeLinksAfterRemove(uint32_t nodeIndex, uint32_t endNodeIndex)
 {
-    return Find(
-                parentNodeIndex,
-                true, // firstNodeIndexIsParent
-                keyName,
-                static_cast<uint32_t>(wcslen(ToWChar(keyName))),
-                TextTree::Node::TypeKey,
-                OUT matchingKeyNodeIndex
-                );
+    // An entire subtree [nodeIndex, endNodeIndex) was removed from nodes_.
+    // Since it was complete, no remaining node pointed inside of it.
+    const uint32_t removedCount = endNodeIndex - nodeIndex;
+    if (nodeLinks_.size() != nodes_.size() + removedCount)
+    {
+        RebuildNodeLinks();
+        return;
+    }
+
+    // Like insertion, only the following nodes and the ancestors of the
+    // removed subtree refer beyond it.
+    nodeLinks_.erase(nodeLinks_.begin() + nodeIndex, nodeLinks_.begin() + endNodeIndex);
+    const auto nodesCount = static_cast<uint32_t>(nodeLinks_.size());
+    for (auto i = nodeIndex; i < nodesCount; ++i)
+    {
+        auto& links = nodeLinks_[i];
+        if (links.parent != InvalidNodeIndex && links.parent >= endNodeIndex)
+            links.parent -= removedCount;
+        links.subtreeEnd -= removedCount;
+    }
+    for (auto i = nodeIndex - 1; i != InvalidNodeIndex; i = nodeLinks_[i].parent)
+    {
+        if (nodeLinks_[i].subtreeEnd >= endNodeIndex)
+            nodeLinks_[i].subtreeEnd -= removedCount;
+    }
 }
 
 
-bool TextTree::GetSingleSubvalue(
-    uint32_t keyNodeIndex,
-    OUT std::u16string& text
-    ) const
+void TextTree::UpdateNodeLinksAfterFlatten(uint32_t firstNodeIndex, uint32_t endNodeIndex, uint32_t parentNodeIndex)
 {
-    // Reads the subvalue of a key, expecting exactly one.
-    // A missing value or multiple values return false with empty text.
+    // The nodes in the range were all reassigned to the same level, becoming
+    // childless siblings under the given parent.
+    if (nodeLinks_.size() != nodes_.size())
+    {
+        RebuildNodeLinks();
+        return;
+    }
 
-    text.clear();
+    for (auto nodeIndex = firstNodeIndex; nodeIndex < endNodeIndex; ++nodeIndex)
+    {
+        auto& links = nodeLinks_[nodeIndex];
+        links.parent = parentNodeIndex;
+        links.subtreeEnd = nodeIndex + 1;
+    }
+}
 
-    const auto nodesCount = nodes_.size();
-    auto nodeIndex = keyNodeIndex;
-    if (keyNodeIndex >= nodesCount)
-        return false;
 
-    auto& keyNode = GetNode(nodeIndex);
-    if (keyNode.GetGenericType() != Node::TypeKey)
-        return false;
+void TextTree::UpdateIndicesAfterAppend(uint32_t nodeIndex)
+{
+    // A node was appended at the very end, so no existing index shifted, and
+    // only its parent's child key index gains an entry.
+    nodeTextBegins_.clear();
+    nodeNumbers_.clear();
+    if (childKeyIndices_.empty())
+        return;
 
-    // Search for value node after key.
-    auto keyNodeLevel = keyNode.level;
-    for (++nodeIndex; nodeIndex < nodesCount; ++nodeIndex)
+    if (nodeLinks_.size() != nodes_.size())
     {
-        auto& node = GetNode(nodeIndex);
-        if (node.level != keyNodeLevel + 1)
-            return false; // Following node is not a child, so found no value.
-
-        auto type = node.GetGenericType();
-        if (type == node.TypeValue)
-            break; // Found the value, but still need to check if there is more than one value.
+        childKeyIndices_.clear();
+        return;
     }
 
-    // Check if scanned all nodes without finding a value.
-    if (nodeIndex >= nodesCount)
-        return false;
+    auto it = childKeyIndices_.find(nodeLinks_[nodeIndex].parent);
+    if (it == childKeyIndices_.end() || it->second.lookupCount < 3)
+        return;
 
-    // Check that there is exactly one value node for this key.
-    for (uint32_t nextNodeIndex = nodeIndex + 1; nextNodeIndex < nodesCount; ++nextNodeIndex)
-    {
-        auto& node = GetNode(nextNodeIndex);
-        if (node.level <= keyNodeLevel)
-            break; // Exited the key (the following node is at the same level or above the key), so stop looking for values.
+    auto& childKeyIndex = it->second;
+    uint32_t textLength = 0;
+    auto text = GetText(nodes_[nodeIndex], OUT textLength);
+    childKeyIndex.childNodeIndices.emplace(GetKeyNameHash(text, textLength), nodeIndex);
+}
 
-        auto type = node.GetGenericType();
-        if (type == node.TypeComment || type == node.TypeIgnorable)
-            continue; // Ignore comments and directives.
 
-        // Any other type means that more than one value was found, not a single value.
-        return false;
+uint32_t TextTree::GetPreviousSiblingNode(uint32_t nodeIndex, uint32_t nodeLevel) const
+{
+    // Climb from the preceding node until reaching this level or shallower.
+    // Any deeper nodes in between are descendants of the previous sibling.
+    uint32_t previousNodeIndex = nodeIndex - 1;
+    while (previousNodeIndex != InvalidNodeIndex && nodes_[previousNodeIndex].level > nodeLevel)
+    {
+        previousNodeIndex = nodeLinks_[previousNodeIndex].parent;
     }
 
-    const Node& valueNode = GetNode(nodeIndex);
-    auto textPointer = &nodesText_[valueNode.start];
-    text.assign(textPointer, textPointer + valueNode.length);
+    if (previousNodeIndex != InvalidNodeIndex && nodes_[previousNodeIndex].level == nodeLevel)
+        return previousNodeIndex;
 
-    return true;
+    return InvalidNodeIndex; // Reached the parent instead.
 }
 
 
-bool TextTree::GetKeyValue(
-    uint32_t parentNodeIndex,
-    __in_z char16_t const* keyName,
-    OUT std::u16string& valueText
-    ) const
+uint32_t TextTree::GetKeyNameHash(__in_ecount(textLength) char16_t const* text, uint32_t textLength) noexcept
 {
-    valueText.clear();
-
-    // Resolve keyName to a node index.
-    uint32_t keyNodeIndex;
-    if (!FindKey(parentNodeIndex, keyName, /*out*/ keyNodeIndex))
-        return false;
+    // FNV-1a over the code units, folding ASCII letters to lowercase so that
+    // names differing only in ASCII case share a bucket. IsMatchingNode folds
+    // the same way, so only names that can match share a hash.
+    uint32_t hash = 0x811C9DC5;
+    for (uint32_t i = 0; i < textLength; ++i)
+    {
+        char16_t ch = text[i];
+        if (ch >= 'A' && ch <= 'Z')
+            ch += 'a' - 'A';
 
-    return GetSingleSubvalue(keyNodeIndex, /*out*/ valueText);
+        hash ^= ch;
+        hash *= 0x01000193;
+    }
+    return hash;
 }
 
 
-__success(return == true)
-bool TextTree::SetKey(
-    uint32_t parentNodeIndex,
-    __in_z char16_t const* keyName,
-    TextTree::Node::Type type,
-    __out uint32_t& keyNodeIndex // unchanged if not set (must have been created or already exist)
-    )
+bool TextTree::IsEqualKeyName(
+    __in_ecount(textLength) char16_t const* text,
+    __in_ecount(textLength) char16_t const* otherText,
+    uint32_t textLength
+    ) noexcept
 {
-    // Set the key, either finding the existing one or inserting a new key.
-
-    auto nodeIndex = parentNodeIndex;
-
-    // If key already exists, just return it.
-    if (FindKey(parentNodeIndex, keyName, /*out*/ nodeIndex))
+    // Compare ignoring ASCII case only, independent of the current locale,
+    // so that the result agrees with GetKeyNameHash.
+    for (uint32_t i = 0; i < textLength; ++i)
     {
-        keyNodeIndex = nodeIndex;
-        return true;
+        char16_t a = text[i], b = otherText[i];
+        if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+        if (b >= 'A' && b <= 'Z') b += 'a' - 'A';
+        if (a != b)
+            return false;
     }
-
-    return Insert(
-                nodeIndex,
-                /*insertAfter*/ true,
-                /*nodeIndexIsParent*/ true,
-                type, // TextTree::Node::TypeAttribute usually
-                keyName,
-                static_cast<uint32_t>(wcslen(ToWChar(keyName))),
-                /*out*/ keyNodeIndex
-                );
+    return true;
 }
 
 
-bool TextTree::SetSubvalue(
-    uint32_t keyNodeIndex,
-    __in_ecount(valueTextLength) const char16_t* valueText,
-    uint32_t valueTextLength,
-    TextTree::Node::Type type
-    )
+bool TextTree::IsMatchingNode(
+    uint32_t nodeIndex,
+    __in_ecount(textLength) char16_t const* text,
+    uint32_t textLength,
+    TextTree::Node::Type expectedType
+    ) const
 {
-    // Validate index, and that it is actually a key.
+    uint32_t currentTextLength = 0;
+    auto& node = nodes_[nodeIndex];
+    auto currentText = GetText(node, OUT currentTextLength);
 
-    const auto nodesCount = nodes_.size();
-    if (keyNodeIndex >= nodesCount)
-        return false;
+    // Return true if the text matches and it is the expected type (or the type is irrelevant).
+    return currentTextLength == textLength
+        && IsEqualKeyName(text, currentText, currentTextLength)
+        && (expectedType == TextTree::Node::TypeNone
+        ||  node.type == expectedType
+        ||  node.GetGenericType() == expectedType);
+}
 
-    auto& keyNode = GetNode(keyNodeIndex);
-    // Presume the key node is actually a key. It would be weird to set a
-    // value underneath something like a comment or another value.
-    assert(keyNode.GetGenericType() == Node::TypeKey);
 
-    // Delete existing subvalues.
+TextTree::ChildKeyIndex const* TextTree::GetChildKeyIndex(uint32_t parentNodeIndex) const
+{
+    // Returns null if the children should just be searched linearly.
+    if (parentNodeIndex >= nodes_.size())
+        return nullptr;
 
-    const auto firstChildNodeIndex = keyNodeIndex + 1;
-    const auto keyNodeLevel = keyNode.level;
-    const auto childNodeLevel = keyNodeLevel + 1;
-    auto nodeIndex = firstChildNodeIndex;
-    for (; nodeIndex < nodesCount; ++nodeIndex)
+    // Look up without inserting, so that parents which are never indexed
+    // (most of them, having few children) never gain an entry. Concurrent
+    // readers share the lock until one needs to add or build an entry. Built
+    // entries are never erased by const methods, and the map's nodes do not
+    // move, so the returned pointer stays valid after the lock is released.
     {
-        auto& node = GetNode(nodeIndex);
-        if (node.level <= keyNodeLevel)
-            break; // Following node is not a child, so found no value.
-
-        node.type = TextTree::Node::TypeNone;
-        node.level = childNodeLevel;
+        std::shared_lock<std::shared_mutex> sharedLock(childKeyIndicesMutex_);
+        auto it = childKeyIndices_.find(parentNodeIndex);
+        if (it != childKeyIndices_.end() && it->second.lookupCount >= 3)
+            return &it->second;
     }
 
-    // Add the new node, either inserting or overwriting the old value.
-
-    TextTree::Node node = {};
-    node.start = static_cast<uint32_t>(nodesText_.size());
-    node.length = valueTextLength;
-    node.type = type;
-    node.level = childNodeLevel;
-    nodesText_.append(valueText, valueTextLength);
+    // Count the children, hopping across their subtrees, but only as far as
+    // needed to know whether there are enough to be worth indexing.
+    assert(nodeLinks_.size() == nodes_.size());
+    const auto parentEndIndex = nodeLinks_[parentNodeIndex].subtreeEnd;
+    uint32_t childCount = 0;
+    for (auto nodeIndex = parentNodeIndex + 1; nodeIndex < parentEndIndex && childCount < MinimumIndexedChildCount; nodeIndex = nodeLinks_[nodeIndex].subtreeEnd)
+    {
+        ++childCount;
+    }
+    if (childCount < MinimumIndexedChildCount)
+        return nullptr;
 
-    if (nodeIndex == firstChildNodeIndex)
+    // Another reader may have added or built the entry meanwhile.
+    std::unique_lock<std::shared_mutex> exclusiveLock(childKeyIndicesMutex_);
+    auto it = childKeyIndices_.find(parentNodeIndex);
+    if (it == childKeyIndices_.end())
     {
-        nodes_.insert(nodes_.begin() + firstChildNodeIndex, node);
+        it = childKeyIndices_.emplace(parentNodeIndex, ChildKeyIndex()).first;
+        if (editDepth_ == 0)
+        {
+            it->second.lookupCount = 1;
+            return nullptr; // First lookup since modification. Not worth building yet.
+        }
     }
-    else
+    else if (it->second.lookupCount >= 3)
     {
-        nodes_[firstChildNodeIndex] = node;
+        return &it->second;
     }
 
-    return true;
+    // Second lookup (or any inside BeginEdits), so build it now.
+    auto& childKeyIndex = it->second;
+    childKeyIndex.lookupCount = 3;
+    childKeyIndex.childNodeIndices.clear();
+    for (auto nodeIndex = parentNodeIndex + 1; nodeIndex < parentEndIndex; nodeIndex = nodeLinks_[nodeIndex].subtreeEnd)
+    {
+        uint32_t textLength = 0;
+        auto text = GetText(nodes_[nodeIndex], OUT textLength);
+        childKeyIndex.childNodeIndices.emplace(GetKeyNameHash(text, textLength), nodeIndex);
+    }
+
+    return &childKeyIndex;
 }
 
 
-bool TextTree::SetSubvalue(
-    uint32_t keyNodeIndex,
-    const std::u16string& valueText,
-    TextTree::Node::Type type
-    )
+TextTree::Node::Type TextTree::Node::GetGenericType() const noexcept
 {
-    return SetSubvalue(keyNodeIndex, valueText.c_str(), static_cast<uint32_t>(valueText.size()), type);
+    return static_cast<TextTree::Node::Type>(this->type & TypeGenericMask);
 }
 
 
-bool TextTree::SetKeyValue(
-    uint32_t parentNodeIndex,
-    __in_z char16_t const* keyName,
-    uint32_t value
-    )
+TextTree::Node& TextTree::GetNode(uint32_t nodeIndex)
 {
-    char16_t valueText[12];
-    auto valueTextEnd = valueText + ARRAYSIZE(valueText);
-    auto p = valueTextEnd;
-    do
+    assert(nodeIndex < nodes_.size());
+    if (nodeIndex >= nodes_.size())
     {
-        --p;
-        *p = (value % 10) + '0';
-        value /= 10;
+        return *static_cast<Node*>(nullptr); // Force AV.
     }
-    while (value > 0);
-
-    uint32_t valueTextLength = static_cast<uint32_t>(valueTextEnd - p);
-
-    uint32_t keyNodeIndex;
-    return SetKey(parentNodeIndex, keyName, TextTree::Node::TypeAttribute, /*out*/ keyNodeIndex)
-        && SetSubvalue(keyNodeIndex, p, valueTextLength, TextTree::Node::TypeNumber);
+    return nodes_[nodeIndex];
 }
 
 
-bool TextTree::SetKeyValue(
-    uint32_t parentNodeIndex,
-    __in_z char16_t const* keyName,
-    __in_ecount(valueTextLength) const char16_t* valueText,
-    uint32_t valueTextLength
-    )
+const TextTree::Node& TextTree::GetNode(uint32_t nodeIndex) const
 {
-    uint32_t keyNodeIndex;
-    return SetKey(parentNodeIndex, keyName, TextTree::Node::TypeAttribute, /*out*/ keyNodeIndex)
-        && SetSubvalue(keyNodeIndex, valueText, valueTextLength);
+    assert(nodeIndex < nodes_.size());
+    if (nodeIndex >= nodes_.size())
+    {
+        return *static_cast<Node*>(nullptr); // Force AV.
+    }
+    return nodes_[nodeIndex];
 }
 
 
-bool TextTree::SetKeyValue(
-    uint32_t parentNodeIndex,
-    __in_z char16_t const* keyName,
-    const std::u16string& valueText
-    )
+const char16_t* TextTree::GetTextPointer(uint32_t textStart) const noexcept
 {
-    uint32_t keyNodeIndex;
-    return SetKey(parentNodeIndex, keyName, TextTree::Node::TypeAttribute, /*out*/ keyNodeIndex)
-        && SetSubvalue(keyNodeIndex, valueText.c_str(), static_cast<uint32_t>(valueText.size()));
+    // Offsets within the adopted source text refer directly to it, and
+    // anything beyond refers to the tree's own text which follows it.
+    const uint32_t sourceTextLength = static_cast<uint32_t>(sourceText_.size());
+    if (textStart < sourceTextLength)
+        return sourceText_.data() + textStart;
+
+    return nodesText_.data() + (textStart - sourceTextLength);
 }
 
 
-void TextTree::Append(TextTree::Node::Type type, uint32_t level, __in_ecount(textLength) char16_t const* text, uint32_t textLength)
+uint32_t TextTree::AppendNodeText(__in_ecount(textLength) const char16_t* text, uint32_t textLength)
 {
-    TextTree::Node node = {};
-    node.start = static_cast<uint32_t>(nodesText_.size());
-    node.length = textLength;
-    node.type = type;
-    node.level = level;
+    const uint32_t textStart = static_cast<uint32_t>(sourceText_.size() + nodesText_.size());
     nodesText_.append(text, textLength);
-    nodes_.push_back(node);
+    return textStart;
 }
 
 
-bool TextTree::Delete(uint32_t nodeIndex, bool shouldRemove)
+uint32_t TextTree::SetNodeText(__inout Node& node, __in_ecount(textLength) const char16_t* text, uint32_t textLength)
 {
-    if (nodeIndex >= nodes_.size())
-        return false;
-
-    // Children are also deleted, so determine how many to erase.
-    auto endIndex = nodeIndex + 1;
-    const auto& node = nodes_[nodeIndex];
-    const auto keyLevel = node.level;
-    while (endIndex < nodes_.size() && nodes_[endIndex].level < keyLevel)
+    // Key names are interned, and repeated ones share the text of the first
+    // node inserted with that name, rather than each appending a copy.
+    node.length = textLength;
+    if (node.GetGenericType() != Node::TypeKey || node.type == Node::TypeRoot)
     {
-        ++endIndex;
+        node.start = AppendNodeText(text, textLength);
+        return InvalidKeyId;
     }
 
-    if (shouldRemove)
+    const uint32_t keyId = keyNames_.Intern(text, textLength);
+    if (keyId >= keyNameTextStarts_.size())
     {
-        // Actually remove it, and shift everything down.
-        nodes_.erase(nodes_.begin() + nodeIndex, nodes_.begin() + endIndex);
+        keyNameTextStarts_.resize(keyId + 1, uint32_t(InvalidTextStart));
     }
-    else
+    auto& keyNameTextStart = keyNameTextStarts_[keyId];
+    if (keyNameTextStart == InvalidTextStart)
     {
-        // Just nullify it, leaving it empty in-place.
-        for (auto i = nodeIndex; i < endIndex; ++i)
+        keyNameTextStart = AppendNodeText(text, textLength);
+    }
+    node.start = keyNameTextStart;
+    return keyId;
+}
+
+
+void TextTree::InternKeyNames(uint32_t firstNodeIndex)
+{
+    const auto nodesCount = static_cast<uint32_t>(nodes_.size());
+    nodeKeyIds_.resize(nodesCount);
+    for (auto nodeIndex = firstNodeIndex; nodeIndex < nodesCount; ++nodeIndex)
+    {
+        auto& node = nodes_[nodeIndex];
+        nodeKeyIds_[nodeIndex] = InvalidKeyId;
+        if (node.GetGenericType() == Node::TypeKey && node.type != Node::TypeRoot)
         {
-            auto& deletableNode = nodes_[i];
-			deletableNode.type = TextTree::Node::TypeNone;
-			deletableNode.level = keyLevel;
+            nodeKeyIds_[nodeIndex] = keyNames_.Intern(GetTextPointer(node.start), node.length);
         }
     }
+}
 
-    return true;
+
+const char16_t* TextTree::GetText(const Node& node, __out uint32_t& textLength) const noexcept
+{
+    assert(size_t(&node - nodes_.data()) < nodes_.size());
+    textLength = node.length;
+    return GetTextPointer(node.start);
 }
 
 
-bool TextTree::AppendChild(
-    uint32_t parentNodeIndex,
-    TextTree::Node::Type type,
-    __in_ecount(textLength) char16_t const* text,
-    uint32_t textLength,
-    __out uint32_t& newNodeIndex
-    )
+void TextTree::GetText(const Node& node, __out std::u16string& text) const
 {
-    return Insert(
-        parentNodeIndex,
-        /*insertAfter*/true,
-        /*nodeIndexIsParent*/true,
-        type,
-        text,
-        textLength,
-        /*out*/ newNodeIndex
-        );
+    assert(size_t(&node - nodes_.data()) < nodes_.size());
+    auto textPointer = GetTextPointer(node.start);
+    text.assign(textPointer, textPointer + node.length);
 }
 
 
-bool TextTree::Insert(
-    uint32_t nodeIndex,
-    bool insertAfter, // insert directly after nodeIndex, or after the last child of the parent (when nodeIndexIsParent true).
-    bool nodeIndexIsParent, // start looking from first child of nodeIndex
-    TextTree::Node::Type type,
-    __in_ecount(textLength) char16_t const* text,
-    uint32_t textLength,
-    __out uint32_t& newNodeIndex
-    )
+void TextTree::GetText(uint32_t nodeIndex, __out std::u16string& text) const
 {
-    newNodeIndex = nodeIndex;
+    auto& node = GetNode(nodeIndex);
+    auto textPointer = GetTextPointer(node.start);
+    text.assign(textPointer, textPointer + node.length);
+}
 
-    uint32_t newNodeLevel = 0;
-    if (nodeIndex < nodes_.size())
-    {
-        newNodeLevel = nodes_[nodeIndex].level;
-    }
 
-    // todo: check that we are actually using AdvanceNodeDirectionLineageChildEnd correctly.
-    auto direction = insertAfter ? AdvanceNodeDirectionSiblingNextEnd : AdvanceNodeDirectionLineageChildEnd;
-    if (nodeIndexIsParent)
-    {
-        // Resolve from parent to first child node index.
-        ++newNodeLevel; // Set level to child (parent + 1).
-        if (!AdvanceNode(direction, 1, /*inout*/ nodeIndex))
-            return false; // todo: debate whether the call should be false if count not reached
-    }
-    else
-    {
-        // Verify nodeIndex validity, and move after node if insertAfter.
-        if (!AdvanceNode(direction, insertAfter ? 1 : 0, /*inout*/ nodeIndex))
-            return false; // todo: debate whether the call should be false if count not reached
-    }
+void TextTree::SetText(__inout Node& node, const std::u16string& text)
+{
+    SetText(node, text.c_str(), static_cast<uint32_t>(text.size()));
+}
 
-    TextTree::Node node = {};
-    node.start = static_cast<uint32_t>(nodesText_.size());
-    node.length = textLength;
-    node.type = type;
-    node.level = newNodeLevel;
-    nodesText_.append(text, textLength);
-    nodes_.insert(nodes_.begin() + nodeIndex, node);
-    newNodeIndex = nodeIndex;
 
-    return true;
+void TextTree::SetText(__inout Node& node, __in_ecount(textLength) const char16_t* text, uint32_t textLength)
+{
+    const size_t nodeIndex = &node - nodes_.data();
+    assert(nodeIndex < nodes_.size());
+    childKeyIndices_.clear();
+    nodeTextBegins_.clear();
+    nodeNumbers_.clear();
+    nodeKeyIds_[nodeIndex] = SetNodeText(/*inout*/ node, text, textLength);
 }
 
 
-bool TextTree::SkipEmptyNodes(__inout uint32_t& nodeIndex) const
+bool TextTree::AdvanceNode(
+    AdvanceNodeDirection direction,
+    int32_t nodeCount,
+    __inout uint32_t& matchingNodeIndex
+    ) const
 {
-    // Check the first node to see if it is an empty key.
-    uint32_t matchingNodeIndex = nodeIndex;
-    uint32_t nodeCount = static_cast<uint32_t>(nodes_.size());
-    for (; matchingNodeIndex < nodeCount; ++matchingNodeIndex)
+    // Resolve the specific directions into a generic direction with count, negated if needed.
+    auto resolvedDirection = direction & AdvanceNodeDirectionMask;
+    bool endsAreInclusive = false;
+    switch (direction)
     {
-        auto& node = nodes_[matchingNodeIndex];
-        if (node.length > 0 || node.GetGenericType() != node.TypeKey)
-            break;
+    case AdvanceNodeDirectionSibling:               break;
+    case AdvanceNodeDirectionLineage:               break;
+    case AdvanceNodeDirectionSiblingNext:           resolvedDirection = AdvanceNodeDirectionSibling;                         break;
+    case AdvanceNodeDirectionSiblingPrevious:       resolvedDirection = AdvanceNodeDirectionSibling; nodeCount = -nodeCount; break;
+    case AdvanceNodeDirectionLineageChild:          resolvedDirection = AdvanceNodeDirectionLineage;                         break;
+    case AdvanceNodeDirectionLineageParent:         resolvedDirection = AdvanceNodeDirectionLineage; nodeCount = -nodeCount; break;
+    case AdvanceNodeDirectionSiblingNextEnd:        resolvedDirection = AdvanceNodeDirectionSibling;                         endsAreInclusive = true; break;
+    case AdvanceNodeDirectionSiblingPreviousEnd:    resolvedDirection = AdvanceNodeDirectionSibling; nodeCount = -nodeCount; endsAreInclusive = true; break;
+    case AdvanceNodeDirectionLineageChildEnd:       resolvedDirection = AdvanceNodeDirectionLineage;                         endsAreInclusive = true; break;
+    case AdvanceNodeDirectionLineageParentEnd:      resolvedDirection = AdvanceNodeDirectionLineage; nodeCount = -nodeCount; endsAreInclusive = true; break;
+    default:                                        return false;
     }
 
-    bool nodesWereSkipped = (nodeIndex != matchingNodeIndex);
-    nodeIndex = matchingNodeIndex;
-    return nodesWereSkipped;
-}
+    assert(nodeLinks_.size() == nodes_.size());
 
+    const auto nodesCount = static_cast<uint32_t>(nodes_.size());
+    auto nodeIndex = matchingNodeIndex;
+    auto nodeLevel = 0u;
+    if (nodeIndex < nodesCount)
+    {
+        nodeLevel = nodes_[nodeIndex].level;
+    }
+    else if (nodeCount > 0)
+    {
+        return false; // Cannot move past end of list. todo: if endsAreInclusive = true, then allow nodeIndex == nodesCount?
+    }
+    else // Clamp the count and leave level = 0.
+    {
+        nodeIndex = nodesCount;
+    }
 
-bool TextTree::SkipRootNode(__inout uint32_t& nodeIndex) const
-{
-    // Check the first node to see if it is an empty key.
-    uint32_t matchingNodeIndex = nodeIndex;
-    uint32_t nodeCount = static_cast<uint32_t>(nodes_.size());
-    for (; matchingNodeIndex < nodeCount; ++matchingNodeIndex)
+    if (nodeCount == 0)
     {
-        auto& node = nodes_[matchingNodeIndex];
-        if (node.type != node.TypeRoot)
-            break;
+        return true; // Successfully moved zero nodes.
     }
 
-    bool nodesWereSkipped = (nodeIndex != matchingNodeIndex);
-    nodeIndex = matchingNodeIndex;
-    return nodesWereSkipped;
-}
+    if (nodeCount > 0) // Search forward.
+    {
+        if (resolvedDirection == AdvanceNodeDirectionSibling)
+        {
+            // Hop over each subtree. The following node is a sibling if at
+            // the same level, else it is shallower and ends the siblings.
+            for (;;)
+            {
+                nodeIndex = nodeLinks_[nodeIndex].subtreeEnd;
+                if (nodeIndex >= nodesCount || nodes_[nodeIndex].level != nodeLevel)
+                    break;
 
+                matchingNodeIndex = nodeIndex;
+                if (--nodeCount <= 0)
+                {
+                    return true;
+                }
+            }
+        }
+        else // resolvedDirection == AdvanceNodeDirectionLineage
+        {
+            // Descend into the first child, which immediately follows its parent.
+            for (++nodeIndex; nodeIndex < nodesCount; ++nodeIndex)
+            {
+                const auto childNodeLevel = nodes_[nodeIndex].level;
+                if (childNodeLevel <= nodeLevel)
+                    break;
 
-namespace
-{
-    // Parse a character of the form \x1234.
-    char32_t GetCStyleEscapedNumber(
-        __in_ecount(textLength) const char16_t* text,
-        uint32_t textIndex,
-        uint32_t textLength,
-        __out uint32_t& endingTextIndex,
-        uint32_t radix = 10
-        )
+                nodeLevel = childNodeLevel; // Update to new level.
+                matchingNodeIndex = nodeIndex;
+                if (--nodeCount <= 0)
+                {
+                    return true;
+                }
+            }
+        }
+
+        if (endsAreInclusive)
+        {
+            matchingNodeIndex = nodeIndex;
+            return true; // todo: debate whether this should be false if count not reached
+        }
+    }
+    else // Search backward.
     {
-        char32_t value = 0;
-        for ( ; textIndex < textLength; ++textIndex)
+        for (;;)
         {
-            char32_t ch = text[textIndex];
-            if (ch < '0') break;
-            if (ch >= '0' && ch <= '9')
+            if (resolvedDirection == AdvanceNodeDirectionSibling)
             {
-                ch -= '0';
+                nodeIndex = GetPreviousSiblingNode(nodeIndex, nodeLevel);
             }
-            else if (ch &= ~0x20, ch >= 'A' && ch <= 'Z')
+            else // resolvedDirection == AdvanceNodeDirectionLineage
             {
-                ch -= 'A' - 10;
+                nodeIndex = (nodeIndex < nodesCount) ? nodeLinks_[nodeIndex].parent : InvalidNodeIndex;
             }
-            else
+
+            if (nodeIndex == InvalidNodeIndex)
+                break;
+
+            matchingNodeIndex = nodeIndex;
+            if (++nodeCount >= 0)
             {
-                break; // Reached non alpha-numeric character.
+                return true;
             }
-            if (ch > radix)
-                break; // Reached a number beyond the radix.
-
-            value *= radix;
-            value += ch;
         }
 
-        endingTextIndex = textIndex;
-
-        return value;
+        if (endsAreInclusive)
+        {
+            return true; // todo: debate whether this should be false if count not reached
+        }
     }
+
+    return false;
 }
 
 
-TextTreeParser::TextTreeParser()
+bool TextTree::AdvanceNextNode(__inout uint32_t& matchingNodeIndex) const
 {
-    Reset(nullptr, 0, OptionsDefault);
+    return AdvanceNode(AdvanceNodeDirectionSiblingNext, 1, /*inout*/ matchingNodeIndex);
 }
 
 
-TextTreeParser::TextTreeParser(
-    __in_ecount(textLength) const char16_t* text, // Pointer should be valid for the lifetime of the class.
-    uint32_t textLength,
-    Options options
-    )
+bool TextTree::AdvancePreviousNode(__inout uint32_t& matchingNodeIndex) const
 {
-    Reset(text, textLength, options);
+    return AdvanceNode(AdvanceNodeDirectionSiblingPrevious, 1, /*inout*/ matchingNodeIndex);
 }
 
 
-void TextTreeParser::Reset(
-    __in_ecount(textLength) const char16_t* text, // Pointer should be valid for the lifetime of the class.
-    uint32_t textLength,
-    Options options
-    )
+bool TextTree::AdvanceChildNode(__inout uint32_t& nodeIndex) const
 {
-    // For compilers that do not support delegated constructors.
-    text_       = text;
-    textLength_ = textLength;
-    options_    = options;
-    textIndex_ = 0;
-    treeLevel_ = 0;
-    if (textLength > 0 && text_[0] == 0xFEFF)
-        ++textIndex_; // Skip byte order mark if present.
-
-    errors_.clear();
-    ResetDerived();
+    return AdvanceNode(AdvanceNodeDirectionLineageChild, 1, /*inout*/ nodeIndex);
 }
 
 
-void TextTreeParser::ResetDerived()
+bool TextTree::AdvanceParentNode(__inout uint32_t& nodeIndex) const
 {
-    // Do nothing in base class. Derived classes may do something.
+    return AdvanceNode(AdvanceNodeDirectionLineageParent, 1, /*inout*/ nodeIndex);
 }
 
 
-TextTree::Syntax TextTreeParser::DetermineType(
-    __in_ecount(textLength) const char16_t* text,
-    uint32_t textLength
-    )
+bool TextTree::AdvanceLastSiblingNode(__inout uint32_t& matchingNodeIndex) const
 {
-    for (uint32_t i = 0; i < textLength; ++i)
-    {
-        char16_t ch = text[i];
-        if (ch == ' ' || ch == '\r' || ch == '\n') continue; // Skip all common forms of whitespace.
-        if (ch == '{') return TextTree::SyntaxJsonex;
-        if (ch == '[') return TextTree::SyntaxJsonex;
-        if (ch == '<') return TextTree::SyntaxXml;
-    }
-
-    return TextTree::SyntaxUnknown;
+    AdvanceNode(AdvanceNodeDirectionSiblingNext, INT32_MAX, /*inout*/ matchingNodeIndex);
+    return true; // Ignore whether the count was satisfied.
 }
 
 
-// Generic C-style escape character support, used by JSONex and INI.
-char32_t TextTreeParser::ReadCStyleEscapeCharacter()
+bool TextTree::AdvanceFirstSiblingNode(__inout uint32_t& matchingNodeIndex) const
 {
-    if (textIndex_ >= textLength_)
-        return '\0';
-
-    char32_t ch = text_[textIndex_++];
+    AdvanceNode(AdvanceNodeDirectionSiblingPrevious, INT32_MAX, /*inout*/ matchingNodeIndex);
+    return true; // Ignore whether the count was satisfied.
+}
 
-    switch (ch)
-    {
-    case L'r':  return L'\r';  // return (JSON C++)
-    case L'n':  return L'\n';  // new line (JSON C++)
-    case L't':  return L'\t';  // tab (JSON C++)
-    case L'v':  return L'\v';  // vertical tab (C++)
-    case L'q':  return L'\"';  // quote (C++)
-    case L'b':  return L'\b';  // backspace (JSON C++)
-    case L'a':  return L'\a';  // audible bell (C++)
-    case L'f':  return L'\f';  // form feed (JSON C++)
-    case L'\\': return L'\\';  // backslash (C++)
-    case L'/':  return L'/';   // forward slash (JSON)
-    case L'"':  return L'"';   // double quote (JSON C++)
-    case L'\'': return L'\'';  // single quote (C++)
-    case L'?':  return L'?';   // question mark (C++)
-    case L'0':  return L'\0';  // nul (C++)
-    case L'#':  return L'#';   // hash, since may be comment in INI files
-    case L';':  return L';';   // semi-colon, since may be comment in INI files
-    case L':':  return L':';   // colon, since may be delimiter in INI files
-    case L'=':  return L'=';   // equals, since delimiter in INI files
 
-    case L'x':
-    case L'u':
-        return GetCStyleEscapedNumber(
-            text_,
-            textIndex_,
-            std::min(textLength_, textIndex_ + 4),
-            /*out*/ textIndex_,
-            16 // hex
-            );
+bool TextTree::AdvanceIntoEmptyNode(__inout uint32_t& matchingNodeIndex) const
+{
+    if (matchingNodeIndex >= nodes_.size())
+        return false;
 
-    case L'X':
-    case L'U':
-        return GetCStyleEscapedNumber(
-            text_,
-            textIndex_,
-            std::min(textLength_, textIndex_ + 8),
-            /*out*/ textIndex_,
-            16 // hex
-            );
+    // Check the first node to see if it is empty.
+    auto& node = nodes_[matchingNodeIndex];
+    if (node.length == 0 && node.GetGenericType() == node.TypeKey)
+        return AdvanceChildNode(/*inout*/ matchingNodeIndex);
 
-    default:
-        return '?';
-    }
+    return false;
 }
 
 
-bool TextTreeParser::ReadNodes(__inout TextTree& textTree)
+bool TextTree::Find(
+    uint32_t firstNodeIndex,
+    bool firstNodeIndexIsParent, // start looking from first child of firstNodeIndex
+    __in_ecount(textLength) char16_t const* text,
+    uint32_t textLength,
+    TextTree::Node::Type expectedType,
+    __out uint32_t& matchingNodeIndex // remains unchanged if no match
+    ) const
 {
-    // Always allocate at least one node for the root.
-    TextTree::Node node = {};
-    if (textTree.empty())
-    {
-        node.type = TextTree::Node::TypeRoot;
-        textTree.nodes_.push_back(node);
-        ++treeLevel_;
-    }
-    uint32_t baseTreeLevel = treeLevel_;
+    // Get first child node.
+    const auto nodesCount = nodes_.size();
+    auto nodeIndex = firstNodeIndex;
 
-    while (ReadNode(/*out*/ node, /*out*/ textTree.nodesText_))
+    if (firstNodeIndexIsParent)
     {
-        textTree.nodes_.push_back(node);
-        textTree.nodesText_.push_back('\0'); // Add explicit nul just because it makes the life easier of callers later.
+        // Use the parent's hash index if it has one, returning the earliest
+        // match among the candidates sharing the same hash.
+        auto childKeyIndex = GetChildKeyIndex(firstNodeIndex);
+        if (childKeyIndex != nullptr)
+        {
+            auto firstMatchingNodeIndex = InvalidNodeIndex;
+            auto range = childKeyIndex->childNodeIndices.equal_range(GetKeyNameHash(text, textLength));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                const auto candidateNodeIndex = it->second;
+                if (candidateNodeIndex < firstMatchingNodeIndex && IsMatchingNode(candidateNodeIndex, text, textLength, expectedType))
+                {
+                    firstMatchingNodeIndex = candidateNodeIndex;
+                }
+            }
+
+            if (firstMatchingNodeIndex == InvalidNodeIndex)
+                return false;
+
+            matchingNodeIndex = firstMatchingNodeIndex;
+            return true;
+        }
+
+        if (!AdvanceChildNode(/*inout*/ nodeIndex))
+            return false;
     }
 
-    if (treeLevel_ != baseTreeLevel) // nodeStack_ should be empty here.
+    // Search for node with matching text and type.
+    // If more than one node exists, return the first match.
+    while (nodeIndex < nodesCount)
     {
-        ReportError(textIndex_ - 1, u"Closing brace/parenthesis is missing to match opening brace/parenthesis.");
+        if (IsMatchingNode(nodeIndex, text, textLength, expectedType))
+        {
+            matchingNodeIndex = nodeIndex;
+            return true;
+        }
+
+        if (!AdvanceNextNode(/*inout*/ nodeIndex))
+            break;
     }
 
-    return true;
+    return false;
 }
 
 
-uint32_t TextTreeParser::GetErrorCount()
+bool TextTree::FindKey(
+    uint32_t parentNodeIndex,
+    __in_z char16_t const* keyName,
+    __inout uint32_t& matchingKeyNodeIndex // remains unchanged if no match
+    ) const
 {
-    return static_cast<uint32_t>(errors_.size());
+    return Find(
+                parentNodeIndex,
+                true, // firstNodeIndexIsParent
+                keyName,
+                static_cast<uint32_t>(wcslen(ToWChar(keyName))),
+                TextTree::Node::TypeKey,
+                OUT matchingKeyNodeIndex
+                );
 }
 
 
-void TextTreeParser::GetErrorDetails(uint32_t errorIndex, __out uint32_t& errorTextIndex, __out const char16_t** errorMessage)
+bool TextTree::GetSingleSubvalue(
+    uint32_t keyNodeIndex,
+    OUT std::u16string& text
+    ) const
 {
-    errorTextIndex = errors_[errorIndex].errorTextIndex;
-    *errorMessage = errors_[errorIndex].errorMessage;
-}
+    // Reads the subvalue of a key, expecting exactly one.
+    // A missing value or multiple values return false with empty text.
 
+    text.clear();
 
-void TextTreeParser::ReportError(uint32_t errorTextIndex, const char16_t* errorMessage)
-{
-    Error error = {errorTextIndex, errorMessage};
-    errors_.push_back(error);
-}
+    const auto nodeIndex = FindSingleSubvalue(keyNodeIndex);
+    if (nodeIndex == InvalidNodeIndex)
+        return false;
 
+    const Node& valueNode = GetNode(nodeIndex);
+    auto textPointer = GetTextPointer(valueNode.start);
+    text.assign(textPointer, textPointer + valueNode.length);
 
-bool TextTreeParser::ReadNode(
-    __out TextTree::Node& node,
-    __inout std::u16string& nodeText
-    )
-{
-    return false;
+    return true;
 }
 
 
-uint32_t TextTreeParser::GetCurrentLevel()
+uint32_t TextTree::FindSingleSubvalue(uint32_t keyNodeIndex) const
 {
-    return treeLevel_;
-}
+    const auto nodesCount = nodes_.size();
+    auto nodeIndex = keyNodeIndex;
+    if (keyNodeIndex >= nodesCount)
+        return InvalidNodeIndex;
 
+    auto& keyNode = GetNode(nodeIndex);
+    if (keyNode.GetGenericType() != Node::TypeKey)
+        return InvalidNodeIndex;
 
-bool TextTreeParser::IsAtEnd()
-{
-    return textIndex_ >= textLength_;
-}
+    // Search for value node after key.
+    auto keyNodeLevel = keyNode.level;
+    for (++nodeIndex; nodeIndex < nodesCount; ++nodeIndex)
+    {
+        auto& node = GetNode(nodeIndex);
+        if (node.level != keyNodeLevel + 1)
+            return InvalidNodeIndex; // Following node is not a child, so found no value.
 
+        auto type = node.GetGenericType();
+        if (type == node.TypeValue)
+            break; // Found the value, but still need to check if there is more than one value.
+    }
 
-// Reads a single code unit, not full code point. This is okay because all the
-// important functional code points are in the basic plane.
-char32_t TextTreeParser::ReadCodeUnit()
-{
-    if (textIndex_ >= textLength_)
-        return '\0';
+    // Check if scanned all nodes without finding a value.
+    if (nodeIndex >= nodesCount)
+        return InvalidNodeIndex;
 
-    return text_[textIndex_++];
-}
+    // Check that there is exactly one value node for this key.
+    for (uint32_t nextNodeIndex = nodeIndex + 1; nextNodeIndex < nodesCount; ++nextNodeIndex)
+    {
+        auto& node = GetNode(nextNodeIndex);
+        if (node.level <= keyNodeLevel)
+            break; // Exited the key (the following node is at the same level or above the key), so stop looking for values.
 
+        auto type = node.GetGenericType();
+        if (type == node.TypeComment || type == node.TypeIgnorable)
+            continue; // Ignore comments and directives.
 
-// Read, but do not advance.
-char32_t TextTreeParser::PeekCodeUnit()
-{
-    if (textIndex_ >= textLength_)
-        return '\0';
+        // Any other type means that more than one value was found, not a single value.
+        return InvalidNodeIndex;
+    }
 
-    return text_[textIndex_];
+    return nodeIndex;
 }
 
 
-// Read relative position, and do not advance.
-char32_t TextTreeParser::PeekCodeUnit(int32_t delta)
+bool TextTree::GetNodeNumber(uint32_t nodeIndex, OUT NodeNumber& number) const noexcept
 {
-    uint32_t textIndex = textIndex_ + delta;
-    if (delta < 0 && textIndex > textIndex_ // underflow
-    ||  delta > 0 && textIndex < textIndex_ // overflow
-    ||  textIndex >= textLength_)           // out of bounds
-        return '\0';
+    number = {};
+    if (nodeNumbers_.size() != nodes_.size() || nodeIndex >= nodeNumbers_.size())
+        return false;
 
-    return text_[textIndex];
+    number = nodeNumbers_[nodeIndex];
+    return number.flags != NodeNumber::FlagsNone;
 }
 
 
-void TextTreeParser::AdvanceCodeUnit()
+uint32_t TextTree::GetKeyId(uint32_t nodeIndex) const noexcept
 {
-    if (textIndex_ >= textLength_)
-        return;
-
-    ++textIndex_;
+    assert(nodeKeyIds_.size() == nodes_.size());
+    return (nodeIndex < nodeKeyIds_.size()) ? nodeKeyIds_[nodeIndex] : InvalidKeyId;
 }
 
 
-void TextTreeParser::RecedeCodeUnit()
+bool TextTree::GetKeyValue(
+    uint32_t parentNodeIndex,
+    __in_z char16_t const* keyName,
+    OUT std::u16string& valueText
+    ) const
 {
-    if (textIndex_ <= 0)
-        return;
-
-    --textIndex_;
-}
+    valueText.clear();
 
+    // Resolve keyName to a node index.
+    uint32_t keyNodeIndex;
+    if (!FindKey(parentNodeIndex, keyName, /*out*/ keyNodeIndex))
+        return false;
 
-// Split into leading and trailing surrogates.
-// From http://unicode.org/faq/utf_bom.html#35
-__if_not_exists(GetLeadingSurrogate)
-{
-    inline char16_t GetLeadingSurrogate(char32_t ch)
-    {
-        return char16_t(0xD800 + (ch >> 10) - (0x10000 >> 10));
-    }
+    return GetSingleSubvalue(keyNodeIndex, /*out*/ valueText);
 }
 
 
-__if_not_exists(GetTrailingSurrogate)
+__success(return == true)
+bool TextTree::SetKey(
+    uint32_t parentNodeIndex,
+    __in_z char16_t const* keyName,
+    TextTree::Node::Type type,
+    __out uint32_t& keyNodeIndex // unchanged if not set (must have been created or already exist)
+    )
 {
-    inline char16_t GetTrailingSurrogate(char32_t ch)
-    {
-        return char16_t(0xDC00 + (ch & 0x3FF));
-    }
-}
+    // Set the key, either finding the existing one or inserting a new key.
 
+    auto nodeIndex = parentNodeIndex;
 
-void TextTreeParser::AppendCharacter(
-    __inout std::u16string& nodeText,
-    char32_t ch
-    )
-{
-    if (ch > 0xFFFF) // If surrogate pair is beyond the basic multilingual plane, split it.
-    {
-        nodeText.push_back(GetLeadingSurrogate(ch));
-        nodeText.push_back(GetTrailingSurrogate(ch));
-    }
-    else
+    // If key already exists, just return it.
+    if (FindKey(parentNodeIndex, keyName, /*out*/ nodeIndex))
     {
-        nodeText.push_back(char16_t(ch));
+        keyNodeIndex = nodeIndex;
+        return true;
     }
+
+    return Insert(
+                nodeIndex,
+                /*insertAfter*/ true,
+                /*nodeIndexIsParent*/ true,
+                type, // TextTree::Node::TypeAttribute usually
+                keyName,
+                static_cast<uint32_t>(wcslen(ToWChar(keyName))),
+                /*out*/ keyNodeIndex
+                );
 }
 
 
-JsonexParser::JsonexParser(
-    __in_ecount(textLength) const char16_t* text,
-    uint32_t textLength,
-    Options options
+bool TextTree::SetSubvalue(
+    uint32_t keyNodeIndex,
+    __in_ecount(valueTextLength) const char16_t* valueText,
+    uint32_t valueTextLength,
+    TextTree::Node::Type type
     )
-    :   Base(text, textLength, options)
 {
-    // Test string:
-    // Actions:foo, bar rod , cat{} {}, dog{bark} dog:{barkmore} bad:dog:{barklouder} (zig zag) "\b\\:" "a\b" , a:b:c  d:e:f{} ,, //hi
-}
+    // Validate index, and that it is actually a key.
 
+    const auto nodesCount = nodes_.size();
+    if (keyNodeIndex >= nodesCount)
+        return false;
 
-void JsonexParser::ResetDerived()
-{
-    nodeStack_.clear();
-}
+    auto& keyNode = GetNode(keyNodeIndex);
+    // Presume the key node is actually a key. It would be weird to set a
+    // value underneath something like a comment or another value.
+    assert(keyNode.GetGenericType() == Node::TypeKey);
 
+    // Delete existing subvalues.
 
-namespace
-{
-    bool JsonexIsValidWordCharacter(char32_t ch)
+    EnsureNodeLinks();
+    const auto firstChildNodeIndex = keyNodeIndex + 1;
+    const auto keyNodeLevel = keyNode.level;
+    const auto childNodeLevel = keyNodeLevel + 1;
+    auto nodeIndex = firstChildNodeIndex;
+    for (; nodeIndex < nodesCount; ++nodeIndex)
     {
-        // This does not have the full Unicode database to follow the ECMA script identifier rules.
-        char32_t lowerCaseAscii = ch & ~0x20;
-        if (lowerCaseAscii >= 'A' && lowerCaseAscii <= 'Z')
-        {
-            return true;
-        }
-        else
-        {
-            // Digits and associated punctuation, or dollar sign and underscore.
-            switch (ch)
-            {
-            case '$': case '_': case '.': case '-': case '+':
-            case '0': case '1': case '2': case '3': case '4':
-            case '5': case '6': case '7': case '8': case '9':
-                return true;
-            }
-        }
-        return false;
-    }
+        auto& node = GetNode(nodeIndex);
+        if (node.level <= keyNodeLevel)
+            break; // Following node is not a child, so found no value.
 
-    bool JsonexIsControlCharacter(char32_t ch)
-    {
-        return (ch <= 0x001F);
-        // Note: exclude (ch >= 0x007F && ch <= 0x009F).
+        node.type = TextTree::Node::TypeNone;
+        node.level = childNodeLevel;
+        nodeKeyIds_[nodeIndex] = InvalidKeyId;
     }
+    UpdateNodeLinksAfterFlatten(firstChildNodeIndex, nodeIndex, keyNodeIndex);
 
-    bool JsonexIsNewLineCharacter(char32_t ch)
+    // Appending the first value of the last key leaves the indices intact.
+    const bool isAppending = (nodeIndex == firstChildNodeIndex && firstChildNodeIndex == nodesCount);
+    if (!isAppending)
     {
-        return ch == '\r' || ch == '\n';
+        childKeyIndices_.clear();
+        nodeTextBegins_.clear();
+        nodeNumbers_.clear();
     }
 
-    bool JsonexIsWhitespaceOrLineBreak(char32_t ch)
-    {
-        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
-    }
+    // Add the new node, either inserting or overwriting the old value.
 
-    bool JsonexIsWordSeparator(char32_t ch)
+    TextTree::Node node = {};
+    node.start = AppendNodeText(valueText, valueTextLength);
+    node.length = valueTextLength;
+    node.type = type;
+    node.level = childNodeLevel;
+
+    if (nodeIndex == firstChildNodeIndex)
     {
-        switch (ch)
+        nodes_.insert(nodes_.begin() + firstChildNodeIndex, node);
+        nodeKeyIds_.insert(nodeKeyIds_.begin() + firstChildNodeIndex, uint32_t(InvalidKeyId));
+        UpdateNodeLinksAfterInsert(firstChildNodeIndex);
+        if (isAppending)
         {
-        case ' ':
-        case '\t':
-        case '\r':
-        case '\n':
-        case ':':
-        case '=':
-        case ',':
-        case '{':
-        case '[':
-        case '(':
-        case '}':
-        case ']':
-        case ')':
-        case '\0':
-            return true;
+            UpdateIndicesAfterAppend(firstChildNodeIndex);
         }
-        return false;
     }
-
-    TextTree::Node::Type JsonexGetNodeTypeFromCharacter(char32_t ch)
+    else
     {
-        switch (ch)
-        {
-        case '{':
-        case '}':
-            return TextTree::Node::TypeObject;
+        nodes_[firstChildNodeIndex] = node;
+        nodeKeyIds_[firstChildNodeIndex] = InvalidKeyId;
+    }
 
-        case '[':
-        case ']':
-            return TextTree::Node::TypeArray;
+    return true;
+}
 
-        case '(':
-        case ')':
-            return TextTree::Node::TypeFunction;
 
-        default:
-            // Assume value for anything else.
-            return TextTree::Node::TypeValue;
-        }
-    }
+bool TextTree::SetSubvalue(
+    uint32_t keyNodeIndex,
+    const std::u16string& valueText,
+    TextTree::Node::Type type
+    )
+{
+    return SetSubvalue(keyNodeIndex, valueText.c_str(), static_cast<uint32_t>(valueText.size()), type);
 }
 
 
-bool JsonexParser::SkipSpacesAndLineBreaks()
+bool TextTree::SetKeyValue(
+    uint32_t parentNodeIndex,
+    __in_z char16_t const* keyName,
+    uint32_t value
+    )
 {
-    if (textIndex_ >= textLength_)
-        return false;
-
-    bool skippedAnySpaces = false;
-    for (; textIndex_ < textLength_; ++textIndex_)
+    char16_t valueText[12];
+    auto valueTextEnd = valueText + ARRAYSIZE(valueText);
+    auto p = valueTextEnd;
+    do
     {
-        char16_t ch = text_[textIndex_];
-        if (!JsonexIsWhitespaceOrLineBreak(ch))
-            return skippedAnySpaces;
-            
-        skippedAnySpaces = true;
+        --p;
+        *p = (value % 10) + '0';
+        value /= 10;
     }
-    return skippedAnySpaces;
+    while (value > 0);
+
+    uint32_t valueTextLength = static_cast<uint32_t>(valueTextEnd - p);
+
+    uint32_t keyNodeIndex;
+    return SetKey(parentNodeIndex, keyName, TextTree::Node::TypeAttribute, /*out*/ keyNodeIndex)
+        && SetSubvalue(keyNodeIndex, p, valueTextLength, TextTree::Node::TypeNumber);
 }
 
 
-void JsonexParser::SkipComment()
+bool TextTree::SetKeyValue(
+    uint32_t parentNodeIndex,
+    __in_z char16_t const* keyName,
+    __in_ecount(valueTextLength) const char16_t* valueText,
+    uint32_t valueTextLength
+    )
 {
-    for (; textIndex_ < textLength_; ++textIndex_)
-    {
-        char16_t ch = text_[textIndex_];
-        if (JsonexIsNewLineCharacter(ch))
-            return;
-    }
+    uint32_t keyNodeIndex;
+    return SetKey(parentNodeIndex, keyName, TextTree::Node::TypeAttribute, /*out*/ keyNodeIndex)
+        && SetSubvalue(keyNodeIndex, valueText, valueTextLength);
 }
 
 
-void JsonexParser::SkipInvalidWordCharacters()
+bool TextTree::SetKeyValue(
+    uint32_t parentNodeIndex,
+    __in_z char16_t const* keyName,
+    const std::u16string& valueText
+    )
 {
-    for (; textIndex_ < textLength_; ++textIndex_)
-    {
-        if (JsonexIsWordSeparator(text_[textIndex_]))
-            return;
-    }
+    uint32_t keyNodeIndex;
+    return SetKey(parentNodeIndex, keyName, TextTree::Node::TypeAttribute, /*out*/ keyNodeIndex)
+        && SetSubvalue(keyNodeIndex, valueText.c_str(), static_cast<uint32_t>(valueText.size()));
 }
 
 
-bool JsonexParser::ReadWord(
-    __out TextTree::Node& node,
-    __inout std::u16string& nodeText
-    )
+void TextTree::Append(TextTree::Node::Type type, uint32_t level, __in_ecount(textLength) char16_t const* text, uint32_t textLength)
 {
-    if (textIndex_ >= textLength_)
-        return false;
+    TextTree::Node node = {};
+    node.type = type;
+    node.level = level;
+    EnsureNodeLinks();
+    const uint32_t keyId = SetNodeText(/*inout*/ node, text, textLength);
+    nodes_.push_back(node);
+    nodeKeyIds_.push_back(keyId);
+    UpdateNodeLinksAfterInsert(static_cast<uint32_t>(nodes_.size() - 1));
+    UpdateIndicesAfterAppend(static_cast<uint32_t>(nodes_.size() - 1));
+}
 
-    const uint32_t oldNodeTextSize = static_cast<uint32_t>(nodeText.size());
-    const uint32_t startingTextIndex = textIndex_;
 
-    char32_t ch = text_[textIndex_];
-    if (JsonexIsWordSeparator(ch))
+bool TextTree::Delete(uint32_t nodeIndex, bool shouldRemove)
+{
+    if (nodeIndex >= nodes_.size())
         return false;
 
-    if (ch == '/') // Start of comment.
-    {
-        ++textIndex_;
+    // Children are also deleted, so determine how many to erase.
+    EnsureNodeLinks();
+    childKeyIndices_.clear();
+    nodeTextBegins_.clear();
+    nodeNumbers_.clear();
+    const auto endIndex = nodeLinks_[nodeIndex].subtreeEnd;
+    const auto& node = nodes_[nodeIndex];
+    const auto keyLevel = node.level;
+
+    if (shouldRemove)
+    {
+        // Actually remove it, and shift everything down.
+        nodes_.erase(nodes_.begin() + nodeIndex, nodes_.begin() + endIndex);
+        nodeKeyIds_.erase(nodeKeyIds_.begin() + nodeIndex, nodeKeyIds_.begin() + endIndex);
+        UpdateNodeLinksAfterRemove(nodeIndex, endIndex);
+    }
+    else
+    {
+        // Just nullify it, leaving it empty in-place.
+        for (auto i = nodeIndex; i < endIndex; ++i)
+        {
+            auto& deletableNode = nodes_[i];
+			deletableNode.type = TextTree::Node::TypeNone;
+			deletableNode.level = keyLevel;
+            nodeKeyIds_[i] = InvalidKeyId;
+        }
+        UpdateNodeLinksAfterFlatten(nodeIndex, endIndex, nodeLinks_[nodeIndex].parent);
+    }
+
+    return true;
+}
+
+
+bool TextTree::AppendChild(
+    uint32_t parentNodeIndex,
+    TextTree::Node::Type type,
+    __in_ecount(textLength) char16_t const* text,
+    uint32_t textLength,
+    __out uint32_t& newNodeIndex
+    )
+{
+    return Insert(
+        parentNodeIndex,
+        /*insertAfter*/true,
+        /*nodeIndexIsParent*/true,
+        type,
+        text,
+        textLength,
+        /*out*/ newNodeIndex
+        );
+}
+
+
+bool TextTree::Insert(
+    uint32_t nodeIndex,
+    bool insertAfter, // insert directly after nodeIndex, or after the last child of the parent (when nodeIndexIsParent true).
+    bool nodeIndexIsParent, // start looking from first child of nodeIndex
+    TextTree::Node::Type type,
+    __in_ecount(textLength) char16_t const* text,
+    uint32_t textLength,
+    __out uint32_t& newNodeIndex
+    )
+{
+    newNodeIndex = nodeIndex;
+
+    uint32_t newNodeLevel = 0;
+    if (nodeIndex < nodes_.size())
+    {
+        newNodeLevel = nodes_[nodeIndex].level;
+    }
+
+    // todo: check that we are actually using AdvanceNodeDirectionLineageChildEnd correctly.
+    auto direction = insertAfter ? AdvanceNodeDirectionSiblingNextEnd : AdvanceNodeDirectionLineageChildEnd;
+    if (nodeIndexIsParent)
+    {
+        // Resolve from parent to first child node index.
+        ++newNodeLevel; // Set level to child (parent + 1).
+        if (!AdvanceNode(direction, 1, /*inout*/ nodeIndex))
+            return false; // todo: debate whether the call should be false if count not reached
+    }
+    else
+    {
+        // Verify nodeIndex validity, and move after node if insertAfter.
+        if (!AdvanceNode(direction, insertAfter ? 1 : 0, /*inout*/ nodeIndex))
+            return false; // todo: debate whether the call should be false if count not reached
+    }
+
+    TextTree::Node node = {};
+    node.type = type;
+    node.level = newNodeLevel;
+    const uint32_t keyId = SetNodeText(/*inout*/ node, text, textLength);
+    nodes_.insert(nodes_.begin() + nodeIndex, node);
+    nodeKeyIds_.insert(nodeKeyIds_.begin() + nodeIndex, keyId);
+    UpdateNodeLinksAfterInsert(nodeIndex);
+    if (nodeIndex + 1 == nodes_.size())
+    {
+        UpdateIndicesAfterAppend(nodeIndex);
+    }
+    else
+    {
+        childKeyIndices_.clear();
+        nodeTextBegins_.clear();
+        nodeNumbers_.clear();
+    }
+    newNodeIndex = nodeIndex;
+
+    return true;
+}
+
+
+bool TextTree::SkipEmptyNodes(__inout uint32_t& nodeIndex) const
+{
+    // Check the first node to see if it is an empty key.
+    uint32_t matchingNodeIndex = nodeIndex;
+    uint32_t nodeCount = static_cast<uint32_t>(nodes_.size());
+    for (; matchingNodeIndex < nodeCount; ++matchingNodeIndex)
+    {
+        auto& node = nodes_[matchingNodeIndex];
+        if (node.length > 0 || node.GetGenericType() != node.TypeKey)
+            break;
+    }
+
+    bool nodesWereSkipped = (nodeIndex != matchingNodeIndex);
+    nodeIndex = matchingNodeIndex;
+    return nodesWereSkipped;
+}
+
+
+bool TextTree::SkipRootNode(__inout uint32_t& nodeIndex) const
+{
+    // Check the first node to see if it is an empty key.
+    uint32_t matchingNodeIndex = nodeIndex;
+    uint32_t nodeCount = static_cast<uint32_t>(nodes_.size());
+    for (; matchingNodeIndex < nodeCount; ++matchingNodeIndex)
+    {
+        auto& node = nodes_[matchingNodeIndex];
+        if (node.type != node.TypeRoot)
+            break;
+    }
+
+    bool nodesWereSkipped = (nodeIndex != matchingNodeIndex);
+    nodeIndex = matchingNodeIndex;
+    return nodesWereSkipped;
+}
+
+
+namespace
+{
+    // Parse a character of the form \x1234.
+    char32_t GetCStyleEscapedNumber(
+        __in_ecount(textLength) const char16_t* text,
+        uint32_t textIndex,
+        uint32_t textLength,
+        __out uint32_t& endingTextIndex,
+        uint32_t radix = 10
+        )
+    {
+        char32_t value = 0;
+        for ( ; textIndex < textLength; ++textIndex)
+        {
+            char32_t ch = text[textIndex];
+            if (ch < '0') break;
+            if (ch >= '0' && ch <= '9')
+            {
+                ch -= '0';
+            }
+            else if (ch &= ~0x20, ch >= 'A' && ch <= 'Z')
+            {
+                ch -= 'A' - 10;
+            }
+            else
+            {
+                break; // Reached non alpha-numeric character.
+            }
+            if (ch > radix)
+                break; // Reached a number beyond the radix.
+
+            value *= radix;
+            value += ch;
+        }
+
+        endingTextIndex = textIndex;
+
+        return value;
+    }
+}
+
+
+////////////////////////////////////////
+// Vectorized scanning, so that the parsers can jump over whole runs of
+// ordinary code units (whitespace, word characters, quoted string contents)
+// straight to the next structurally interesting position, rather than
+// testing them one at a time. Each classifier tests a vector of code units
+// at once, returning a byte mask with two bits set per matching code unit,
+// plus a scalar test for the remainder at the end.
+
+#if defined(__AVX2__)
+#define TEXT_TREE_PARSER_USE_AVX2 1
+#endif
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define TEXT_TREE_PARSER_USE_SSE2 1
+#endif
+
+namespace
+{
+    // Rough sizes for reserving capacity from the text length, erring low so
+    // that at most one regrowth follows (typical settings files average more
+    // characters per node than this once indentation and punctuation count).
+    const uint32_t EstimatedTextLengthPerNode = 16;
+    const uint32_t EstimatedTextLengthPerNodeText = 2; // Copied names and values, without quotes, punctuation, or indentation.
+
+#if TEXT_TREE_PARSER_USE_SSE2
+    using Vector128 = __m128i;
+
+    inline Vector128 VectorEquals(Vector128 a, char16_t ch) { return _mm_cmpeq_epi16(a, _mm_set1_epi16(short(ch))); }
+    inline Vector128 VectorInRange(Vector128 a, char16_t low, char16_t high) // Unsigned low <= a <= high
+    {
+        Vector128 offset = _mm_sub_epi16(a, _mm_set1_epi16(short(low)));
+        return _mm_cmpeq_epi16(_mm_subs_epu16(offset, _mm_set1_epi16(short(high - low))), _mm_setzero_si128());
+    }
+    inline Vector128 VectorOr(Vector128 a, Vector128 b) { return _mm_or_si128(a, b); }
+    inline uint32_t VectorMask(Vector128 a) { return uint32_t(_mm_movemask_epi8(a)); }
+    inline uint32_t VectorMaskNot(Vector128 a) { return ~uint32_t(_mm_movemask_epi8(a)) & 0xFFFF; }
+#endif
+
+#if TEXT_TREE_PARSER_USE_AVX2
+    using Vector256 = __m256i;
+
+    inline Vector256 VectorEquals(Vector256 a, char16_t ch) { return _mm256_cmpeq_epi16(a, _mm256_set1_epi16(short(ch))); }
+    inline Vector256 VectorInRange(Vector256 a, char16_t low, char16_t high)
+    {
+        Vector256 offset = _mm256_sub_epi16(a, _mm256_set1_epi16(short(low)));
+        return _mm256_cmpeq_epi16(_mm256_subs_epu16(offset, _mm256_set1_epi16(short(high - low))), _mm256_setzero_si256());
+    }
+    inline Vector256 VectorOr(Vector256 a, Vector256 b) { return _mm256_or_si256(a, b); }
+    inline uint32_t VectorMask(Vector256 a) { return uint32_t(_mm256_movemask_epi8(a)); }
+    inline uint32_t VectorMaskNot(Vector256 a) { return ~uint32_t(_mm256_movemask_epi8(a)); }
+#endif
+
+    // Matches anything other than space, tab, and line breaks.
+    struct NonWhitespaceClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMaskNot(VectorOr(VectorOr(VectorEquals(v, ' '), VectorEquals(v, '\t')), VectorOr(VectorEquals(v, '\r'), VectorEquals(v, '\n'))));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return !(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n');
+        }
+    };
+
+    // Matches line breaks.
+    struct NewLineClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorOr(VectorEquals(v, '\r'), VectorEquals(v, '\n')));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch == '\r' || ch == '\n';
+        }
+    };
+
+    // Matches what ends an unquoted CSV field: the comma or a line break.
+    struct CsvFieldEndClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorOr(VectorEquals(v, ','), VectorOr(VectorEquals(v, '\r'), VectorEquals(v, '\n'))));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch == ',' || ch == '\r' || ch == '\n';
+        }
+    };
+
+    // Matches what ends the plain contents of a quoted CSV field: the quote,
+    // which is either closing or the first of a doubled quote.
+    struct CsvQuoteClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorEquals(v, '"'));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch == '"';
+        }
+    };
+
+    // Matches what ends a run of plain XML text: markup or a reference.
+    struct XmlTextClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorOr(VectorEquals(v, '<'), VectorEquals(v, '&')));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch == '<' || ch == '&';
+        }
+    };
+
+    // Matches what ends a run of a double or single quoted XML attribute
+    // value: the closing quote, a reference, or an invalid '<'.
+    template <char16_t Quote>
+    struct XmlQuotedValueClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorOr(VectorEquals(v, Quote), VectorOr(VectorEquals(v, '<'), VectorEquals(v, '&'))));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch == Quote || ch == '<' || ch == '&';
+        }
+    };
+
+    // Matches what ends an XML name within a tag: whitespace (or any control
+    // character), the tag end, or the attribute's equals sign.
+    struct XmlNameEndClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorOr(VectorOr(VectorInRange(v, 0x0000, 0x0020), VectorEquals(v, '=')),
+                                       VectorOr(VectorOr(VectorEquals(v, '/'), VectorEquals(v, '>')), VectorEquals(v, '<'))));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch <= 0x0020 || ch == '=' || ch == '/' || ch == '>' || ch == '<';
+        }
+    };
+
+    // Matches a single character, such as the first of a terminator.
+    template <char16_t Character>
+    struct SingleCharacterClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorEquals(v, Character));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch == Character;
+        }
+    };
+
+    // Matches control characters (including line breaks).
+    struct ControlCharacterClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorInRange(v, 0x0000, 0x001F));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch <= 0x001F;
+        }
+    };
+
+    // Matches whatever ends the plain contents of a quoted string: the closing
+    // quote, an escape, or an invalid control character.
+    struct QuotedStringClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            return VectorMask(VectorOr(VectorOr(VectorEquals(v, '"'), VectorEquals(v, '\\')), VectorInRange(v, 0x0000, 0x001F)));
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return ch == '"' || ch == '\\' || ch <= 0x001F;
+        }
+    };
+
+    // Matches anything not valid inside an unquoted JSONex word, which are
+    // ASCII letters, digits, and $ _ . - +. Keep in sync with JsonexIsValidWordCharacter.
+    struct JsonexNonWordClassifier
+    {
+        template <typename VectorType>
+        static uint32_t Match(VectorType v)
+        {
+            auto isWordCharacter = VectorOr(
+                VectorOr(VectorInRange(v, 'A', 'Z'), VectorInRange(v, 'a', 'z')),
+                VectorOr(
+                    VectorOr(VectorInRange(v, '0', '9'), VectorInRange(v, '-', '.')), // Digits and - .
+                    VectorOr(VectorOr(VectorEquals(v, '$'), VectorEquals(v, '_')), VectorEquals(v, '+'))
+                    )
+                );
+            return VectorMaskNot(isWordCharacter);
+        }
+
+        static bool Match(char16_t ch)
+        {
+            return !((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9')
+                  || ch == '-' || ch == '.' || ch == '$' || ch == '_' || ch == '+');
+        }
+    };
+
+    // Returns the index of the first code unit at or after textIndex that
+    // matches the classifier, or textLength if none do.
+    template <typename Classifier>
+    uint32_t FindFirstMatch(
+        __in_ecount(textLength) char16_t const* text,
+        uint32_t textIndex,
+        uint32_t textLength
+        )
+    {
+        #if TEXT_TREE_PARSER_USE_AVX2
+        for (; textIndex + 16 <= textLength; textIndex += 16)
+        {
+            auto v = _mm256_loadu_si256(reinterpret_cast<Vector256 const*>(text + textIndex));
+            uint32_t mask = Classifier::Match(v);
+            if (mask != 0)
+                return textIndex + std::countr_zero(mask) / sizeof(char16_t);
+        }
+        #endif
+
+        #if TEXT_TREE_PARSER_USE_SSE2
+        for (; textIndex + 8 <= textLength; textIndex += 8)
+        {
+            auto v = _mm_loadu_si128(reinterpret_cast<Vector128 const*>(text + textIndex));
+            uint32_t mask = Classifier::Match(v);
+            if (mask != 0)
+                return textIndex + std::countr_zero(mask) / sizeof(char16_t);
+        }
+        #endif
+
+        for (; textIndex < textLength; ++textIndex)
+        {
+            if (Classifier::Match(text[textIndex]))
+                return textIndex;
+        }
+        return textLength;
+    }
+}
+
+
+TextTreeParser::TextTreeParser()
+{
+    Reset(nullptr, 0, OptionsDefault);
+}
+
+
+TextTreeParser::TextTreeParser(
+    __in_ecount(textLength) const char16_t* text, // Pointer should be valid for the lifetime of the class.
+    uint32_t textLength,
+    Options options
+    )
+{
+    Reset(text, textLength, options);
+}
+
+
+void TextTreeParser::Reset(
+    __in_ecount(textLength) const char16_t* text, // Pointer should be valid for the lifetime of the class.
+    uint32_t textLength,
+    Options options
+    )
+{
+    // For compilers that do not support delegated constructors.
+    text_       = text;
+    textLength_ = textLength;
+    options_    = options;
+    textIndex_ = 0;
+    treeLevel_ = 0;
+    if (textLength > 0 && text_[0] == 0xFEFF)
+        ++textIndex_; // Skip byte order mark if present.
+
+    isReferencingText_ = false;
+    nodeTextBase_ = 0;
+    nodeTextBegin_ = 0;
+    eventText_.clear();
+    eventTextOffset_ = 0;
+    eventNodeStack_.clear();
+    hasPendingEventNode_ = false;
+    pendingEventKeyId_ = TextTree::InvalidKeyId;
+    eventKeyId_ = TextTree::InvalidKeyId;
+    errors_.clear();
+    droppedErrorCount_ = 0;
+    lineBegins_.clear();
+    ResetDerived();
+}
+
+
+void TextTreeParser::ResetDerived()
+{
+    // Do nothing in base class. Derived classes may do something.
+}
+
+
+void TextTreeParser::ResumeDerived(array_ref<TextTree::Node const> openNodes)
+{
+    // Do nothing in base class. Derived classes may do something.
+}
+
+
+TextTree::Syntax TextTreeParser::DetermineType(
+    __in_ecount(textLength) const char16_t* text,
+    uint32_t textLength
+    )
+{
+    for (uint32_t i = 0; i < textLength; ++i)
+    {
+        char16_t ch = text[i];
+        if (ch == ' ' || ch == '\r' || ch == '\n') continue; // Skip all common forms of whitespace.
+        if (ch == '{') return TextTree::SyntaxJsonex;
+        if (ch == '[') return TextTree::SyntaxJsonex;
+        if (ch == '<') return TextTree::SyntaxXml;
+    }
+
+    return TextTree::SyntaxUnknown;
+}
+
+
+// Generic C-style escape character support, used by JSONex and INI.
+char32_t TextTreeParser::ReadCStyleEscapeCharacter()
+{
+    if (textIndex_ >= textLength_)
+        return '\0';
+
+    char32_t ch = text_[textIndex_++];
+
+    switch (ch)
+    {
+    case L'r':  return L'\r';  // return (JSON C++)
+    case L'n':  return L'\n';  // new line (JSON C++)
+    case L't':  return L'\t';  // tab (JSON C++)
+    case L'v':  return L'\v';  // vertical tab (C++)
+    case L'q':  return L'\"';  // quote (C++)
+    case L'b':  return L'\b';  // backspace (JSON C++)
+    case L'a':  return L'\a';  // audible bell (C++)
+    case L'f':  return L'\f';  // form feed (JSON C++)
+    case L'\\': return L'\\';  // backslash (C++)
+    case L'/':  return L'/';   // forward slash (JSON)
+    case L'"':  return L'"';   // double quote (JSON C++)
+    case L'\'': return L'\'';  // single quote (C++)
+    case L'?':  return L'?';   // question mark (C++)
+    case L'0':  return L'\0';  // nul (C++)
+    case L'#':  return L'#';   // hash, since may be comment in INI files
+    case L';':  return L';';   // semi-colon, since may be comment in INI files
+    case L':':  return L':';   // colon, since may be delimiter in INI files
+    case L'=':  return L'=';   // equals, since delimiter in INI files
+
+    case L'x':
+    case L'u':
+        return GetCStyleEscapedNumber(
+            text_,
+            textIndex_,
+            std::min(textLength_, textIndex_ + 4),
+            /*out*/ textIndex_,
+            16 // hex
+            );
+
+    case L'X':
+    case L'U':
+        return GetCStyleEscapedNumber(
+            text_,
+            textIndex_,
+            std::min(textLength_, textIndex_ + 8),
+            /*out*/ textIndex_,
+            16 // hex
+            );
+
+    default:
+        return '?';
+    }
+}
+
+
+bool TextTreeParser::ReadNodes(__inout TextTree& textTree, __inout std::u16string&& text)
+{
+    if (!textTree.empty())
+    {
+        // Nodes can only refer into text adopted by an empty tree, so just
+        // read it normally, copying into the existing tree's text.
+        std::u16string existingTreeText(std::move(text));
+        Reset(existingTreeText.data(), static_cast<uint32_t>(existingTreeText.size()), options_);
+        return ReadNodes(/*inout*/ textTree);
+    }
+
+    // Take ownership of the text without copying, and read from the tree's
+    // copy so that the node offsets refer to the same memory. Swapping hands
+    // the tree's previous (emptied) buffer back to the caller.
+    textTree.sourceText_.swap(text);
+    text.clear();
+    Reset(textTree.sourceText_.data(), static_cast<uint32_t>(textTree.sourceText_.size()), options_);
+    isReferencingText_ = true;
+    return ReadNodes(/*inout*/ textTree);
+}
+
+
+bool TextTreeParser::ReadNodes(__inout TextTree& textTree)
+{
+    // Decoded node text follows any source text adopted by the tree.
+    nodeTextBase_ = static_cast<uint32_t>(textTree.sourceText_.size());
+
+    // Where each node began in the text is only meaningful for adopted text,
+    // which the tree can later reparse portions of.
+    bool isRecordingNodeTextBegins = isReferencingText_ && textTree.empty();
+    textTree.nodeTextBegins_.clear();
+
+    // Numbers are recorded for every node, so only continue existing ones.
+    bool isRecordingNodeNumbers = (options_ & OptionsDecodeNumbers) && textTree.nodeNumbers_.size() == textTree.nodes_.size();
+    if (!isRecordingNodeNumbers)
+    {
+        textTree.nodeNumbers_.clear();
+    }
+
+    ReserveNodes(/*inout*/ textTree);
+
+    // Always allocate at least one node for the root.
+    TextTree::Node node = {};
+    if (textTree.empty())
+    {
+        node.type = TextTree::Node::TypeRoot;
+        textTree.nodes_.push_back(node);
+        textTree.nodeKeyIds_.push_back(uint32_t(TextTree::InvalidKeyId));
+        ++treeLevel_;
+        if (isRecordingNodeNumbers)
+        {
+            textTree.nodeNumbers_.push_back({});
+        }
+    }
+    uint32_t baseTreeLevel = treeLevel_;
+
+    if (isRecordingNodeTextBegins)
+    {
+        textTree.nodeTextBegins_.push_back(0);
+    }
+
+    while (ReadNode(/*out*/ node, /*out*/ textTree.nodesText_))
+    {
+        textTree.nodeKeyIds_.push_back(InternKeyName(/*inout*/ textTree.keyNames_, node, textTree.nodesText_));
+        textTree.nodes_.push_back(node);
+        if (isRecordingNodeNumbers)
+        {
+            textTree.nodeNumbers_.push_back(DecodeNodeNumber(node, textTree.nodesText_));
+        }
+        if (node.start >= nodeTextBase_)
+        {
+            textTree.nodesText_.push_back('\0'); // Add explicit nul just because it makes the life easier of callers later.
+        }
+        if (isRecordingNodeTextBegins)
+        {
+            textTree.nodeTextBegins_.push_back(nodeTextBegin_);
+        }
+    }
+
+    if (treeLevel_ != baseTreeLevel) // nodeStack_ should be empty here.
+    {
+        ReportError(textIndex_ - 1, u"Closing brace/parenthesis is missing to match opening brace/parenthesis.");
+    }
+
+    textTree.RebuildNodeLinks();
+    textTree.childKeyIndices_.clear();
+    isReferencingText_ = false;
+    nodeTextBase_ = 0;
+
+    return true;
+}
+
+
+void TextTreeParser::ReserveNodes(__inout TextTree& textTree) const
+{
+    if (!textTree.empty())
+        return; // Reserving more for each append would defeat the vector's geometric growth.
+
+    const uint32_t remainingTextLength = textLength_ - std::min(textIndex_, textLength_);
+    const size_t expectedNodeCount = size_t(remainingTextLength / EstimatedTextLengthPerNode) + 1; // Including the root.
+    textTree.nodes_.reserve(expectedNodeCount);
+    textTree.nodeKeyIds_.reserve(expectedNodeCount);
+    if (isReferencingText_)
+    {
+        textTree.nodeTextBegins_.reserve(expectedNodeCount);
+    }
+    else
+    {
+        textTree.nodesText_.reserve(remainingTextLength / EstimatedTextLengthPerNodeText);
+    }
+    if (options_ & OptionsDecodeNumbers)
+    {
+        textTree.nodeNumbers_.reserve(expectedNodeCount);
+    }
+}
+
+
+bool TextTreeParser::ReadEvent(
+    __out EventType& eventType,
+    __out TextTree::Node& node,
+    __out array_ref<char16_t const>& nodeText
+    )
+{
+    eventNumber_ = {};
+    eventKeyId_ = TextTree::InvalidKeyId;
+
+    if (!hasPendingEventNode_)
+    {
+        // Read the next node, referring into the source text where possible.
+        // Decoded text offsets keep increasing across events, so the stale
+        // offset of an earlier node is never mistaken for current text.
+        eventTextOffset_ += static_cast<uint32_t>(eventText_.size());
+        eventText_.clear();
+        isReferencingText_ = true;
+        nodeTextBase_ = textLength_ + eventTextOffset_;
+        hasPendingEventNode_ = ReadNode(/*out*/ pendingEventNode_, /*inout*/ eventText_);
+        if (hasPendingEventNode_)
+        {
+            pendingEventKeyId_ = InternKeyName(/*inout*/ keyNames_, pendingEventNode_, eventText_);
+        }
+        isReferencingText_ = false;
+    }
+
+    // End any open key nodes which the next node is not nested within,
+    // or all of them once the text is exhausted.
+    if (!eventNodeStack_.empty() && (!hasPendingEventNode_ || pendingEventNode_.level <= eventNodeStack_.back().level))
+    {
+        eventType = EventTypeEndNode;
+        node = eventNodeStack_.back();
+        node.length = 0;
+        nodeText = array_ref<char16_t const>();
+        eventNodeStack_.pop_back();
+        return true;
+    }
+
+    if (!hasPendingEventNode_)
+    {
+        eventType = EventTypeNone;
+        node = {};
+        nodeText = array_ref<char16_t const>();
+        return false;
+    }
+
+    hasPendingEventNode_ = false;
+    node = pendingEventNode_;
+    auto text = GetNodeText(node, eventText_);
+    nodeText = array_ref<char16_t const>(text, node.length);
+
+    if (node.GetGenericType() == TextTree::Node::TypeKey)
+    {
+        eventType = EventTypeBeginNode;
+        eventKeyId_ = pendingEventKeyId_;
+        eventNodeStack_.push_back(node);
+    }
+    else
+    {
+        eventType = EventTypeValue;
+        if (options_ & OptionsDecodeNumbers)
+        {
+            eventNumber_ = DecodeNodeNumber(node, eventText_);
+        }
+    }
+    return true;
+}
+
+
+void TextTreeParser::ReparseNodes(
+    __inout TextTree& textTree,
+    __inout std::u16string&& text,
+    uint32_t nodeLevel,
+    __out uint32_t& firstNodeIndex,
+    __out uint32_t& oldNodeCount,
+    __out uint32_t& newNodeCount
+    )
+{
+    if (!ReparseChangedNodes(/*inout*/ textTree, /*inout*/ text, nodeLevel, /*out*/ firstNodeIndex, /*out*/ oldNodeCount, /*out*/ newNodeCount))
+    {
+        // The change could not be isolated, so read everything again.
+        firstNodeIndex = 0;
+        oldNodeCount = textTree.GetNodeCount();
+        textTree.Clear(/*shouldReleaseMemory*/false); // About as much is read back.
+        ReadNodes(/*inout*/ textTree, std::move(text));
+        newNodeCount = textTree.GetNodeCount();
+    }
+}
+
+
+bool TextTreeParser::ReparseChangedNodes(
+    __inout TextTree& textTree,
+    __inout std::u16string& text,
+    uint32_t nodeLevel,
+    __out uint32_t& firstNodeIndex,
+    __out uint32_t& oldNodeCount,
+    __out uint32_t& newNodeCount
+    )
+{
+    firstNodeIndex = 0;
+    oldNodeCount = 0;
+    newNodeCount = 0;
+
+    auto& nodes = textTree.nodes_;
+    auto& nodeTextBegins = textTree.nodeTextBegins_;
+    std::u16string const& oldText = textTree.sourceText_;
+    const uint32_t nodesCount = static_cast<uint32_t>(nodes.size());
+    if (nodesCount == 0 || nodeTextBegins.size() != nodesCount || nodeLevel == 0)
+        return false; // Not read from adopted text, or modified since.
+
+    // Find the changed text between the common prefix and suffix.
+    const uint32_t oldTextLength = static_cast<uint32_t>(oldText.size());
+    const uint32_t newTextLength = static_cast<uint32_t>(text.size());
+    const uint32_t minTextLength = std::min(oldTextLength, newTextLength);
+    const uint32_t prefixLength = static_cast<uint32_t>(std::mismatch(oldText.begin(), oldText.begin() + minTextLength, text.begin()).first - oldText.begin());
+    if (prefixLength == oldTextLength && oldTextLength == newTextLength)
+        return true; // Nothing changed.
+
+    uint32_t suffixLength = 0;
+    while (suffixLength < minTextLength - prefixLength
+        && oldText[oldTextLength - 1 - suffixLength] == text[newTextLength - 1 - suffixLength])
+    {
+        ++suffixLength;
+    }
+    const uint32_t oldChangeEnd = oldTextLength - suffixLength;
+    const uint32_t textDelta = newTextLength - oldTextLength; // Wraps when shrinking, which unsigned addition undoes.
+
+    // The text to reread begins at the last node of the level that begins
+    // before the change (a node beginning right at it may have been peeked
+    // by the one before), and ends at the next node of that level or outer
+    // level that begins at or after the change.
+    uint32_t firstIndex = static_cast<uint32_t>(std::lower_bound(nodeTextBegins.begin() + 1, nodeTextBegins.end(), prefixLength) - nodeTextBegins.begin());
+    do
+    {
+        if (--firstIndex == 0)
+            return false; // The change precedes any node of that level.
+    } while (nodes[firstIndex].level > nodeLevel);
+
+    if (nodes[firstIndex].level != nodeLevel)
+        return false;
+
+    uint32_t endIndex = firstIndex + 1;
+    for (; endIndex < nodesCount; ++endIndex)
+    {
+        const uint32_t level = nodes[endIndex].level;
+        if (level <= nodeLevel && nodeTextBegins[endIndex] >= oldChangeEnd)
+            break;
+        if (level < nodeLevel)
+            return false; // The change spans the end of a parent.
+    }
+
+    // The text must not start in the middle of a word, which would read
+    // differently without the preceding characters, nor just after a colon,
+    // since the key before it takes its type from any following bracket.
+    const uint32_t textBegin = nodeTextBegins[firstIndex];
+    uint32_t precedingIndex = textBegin;
+    while (precedingIndex > 0 && !NonWhitespaceClassifier::Match(text[precedingIndex - 1]))
+    {
+        --precedingIndex;
+    }
+    if (precedingIndex > 0)
+    {
+        switch (text[precedingIndex - 1])
+        {
+        case ',':
+        case '{': case '[': case '(':
+        case '}': case ']': case ')':
+            break;
+        case ':': case '=':
+            return false;
+        default:
+            if (precedingIndex == textBegin)
+                return false;
+        }
+    }
+    const uint32_t textEnd = (endIndex < nodesCount) ? nodeTextBegins[endIndex] + textDelta : newTextLength;
+
+    // Resume reading at the first node, nested within the same key nodes.
+    textTree.EnsureNodeLinks();
+    std::vector<TextTree::Node> openNodes;
+    for (uint32_t parentIndex = textTree.nodeLinks_[firstIndex].parent; parentIndex != TextTree::InvalidNodeIndex; parentIndex = textTree.nodeLinks_[parentIndex].parent)
+    {
+        TextTree::Node openNode = nodes[parentIndex];
+        if (openNode.type == TextTree::Node::TypeRoot)
+            continue;
+
+        // Names in the unchanged prefix are at the same offset in the new
+        // text. Decoded ones are instead placed beyond the new text, where
+        // closing tags are not compared against them.
+        if (openNode.start >= oldTextLength)
+        {
+            openNode.start = newTextLength;
+        }
+        openNodes.push_back(openNode);
+    }
+    std::reverse(openNodes.begin(), openNodes.end());
+
+    Reset(text.data(), newTextLength, options_);
+    textIndex_ = textBegin;
+    treeLevel_ = nodeLevel;
+    isReferencingText_ = true;
+    nodeTextBase_ = newTextLength + static_cast<uint32_t>(textTree.nodesText_.size());
+    ResumeDerived(openNodes);
+
+    // Read nodes until reaching the node after the changed text, which must
+    // begin exactly where it did before, shifted by the change in length.
+    std::vector<TextTree::Node> newNodes;
+    std::vector<uint32_t> newNodeTextBegins;
+    std::vector<uint32_t> newNodeKeyIds;
+    std::vector<TextTree::NodeNumber> newNodeNumbers;
+    std::u16string newNodesText;
+    const bool isRecordingNodeNumbers = (options_ & OptionsDecodeNumbers) && textTree.nodeNumbers_.size() == nodesCount;
+    TextTree::Node node = {};
+    bool isAtEndNode = false;
+    bool isParentAffected = false;
+
+    while (ReadNode(/*out*/ node, /*inout*/ newNodesText))
+    {
+        if (nodeTextBegin_ >= textEnd)
+        {
+            isAtEndNode = true;
+            break;
+        }
+        if (node.level < nodeLevel)
+        {
+            isParentAffected = true;
+            break;
+        }
+
+        newNodeKeyIds.push_back(InternKeyName(/*inout*/ textTree.keyNames_, node, newNodesText));
+        newNodes.push_back(node);
+        newNodeTextBegins.push_back(nodeTextBegin_);
+        if (isRecordingNodeNumbers)
+        {
+            newNodeNumbers.push_back(DecodeNodeNumber(node, newNodesText));
+        }
+        if (node.start >= nodeTextBase_)
+        {
+            newNodesText.push_back('\0');
+        }
+    }
+
+    bool isMatchingEnd = (endIndex < nodesCount)
+                       ? isAtEndNode
+                         && nodeTextBegin_ == textEnd
+                         && node.level == nodes[endIndex].level
+                         && node.type == nodes[endIndex].type
+                       : textIndex_ >= textLength_ && treeLevel_ == nodeLevel - static_cast<uint32_t>(openNodes.size());
+    bool succeeded = isMatchingEnd && !isParentAffected && GetTotalErrorCount() == 0;
+
+    isReferencingText_ = false;
+    nodeTextBase_ = 0;
+    if (!succeeded)
+        return false;
+
+    // Shift the text offsets of the nodes kept on either side. Nodes after
+    // the change move with the text, and decoded text follows the new text.
+    auto shiftNodeStart = [=](TextTree::Node& keptNode)
+    {
+        if (keptNode.start >= oldChangeEnd)
+            keptNode.start += textDelta;
+    };
+    for (uint32_t i = 0; i < firstIndex; ++i)
+    {
+        shiftNodeStart(nodes[i]);
+    }
+    for (uint32_t i = endIndex; i < nodesCount; ++i)
+    {
+        shiftNodeStart(nodes[i]);
+        nodeTextBegins[i] += textDelta;
+    }
+
+    // Splice in the new nodes.
+    nodes.erase(nodes.begin() + firstIndex, nodes.begin() + endIndex);
+    nodes.insert(nodes.begin() + firstIndex, newNodes.begin(), newNodes.end());
+    nodeTextBegins.erase(nodeTextBegins.begin() + firstIndex, nodeTextBegins.begin() + endIndex);
+    nodeTextBegins.insert(nodeTextBegins.begin() + firstIndex, newNodeTextBegins.begin(), newNodeTextBegins.end());
+    auto& nodeKeyIds = textTree.nodeKeyIds_;
+    nodeKeyIds.erase(nodeKeyIds.begin() + firstIndex, nodeKeyIds.begin() + endIndex);
+    nodeKeyIds.insert(nodeKeyIds.begin() + firstIndex, newNodeKeyIds.begin(), newNodeKeyIds.end());
+    if (isRecordingNodeNumbers)
+    {
+        auto& nodeNumbers = textTree.nodeNumbers_;
+        nodeNumbers.erase(nodeNumbers.begin() + firstIndex, nodeNumbers.begin() + endIndex);
+        nodeNumbers.insert(nodeNumbers.begin() + firstIndex, newNodeNumbers.begin(), newNodeNumbers.end());
+    }
+    else
+    {
+        textTree.nodeNumbers_.clear();
+    }
+    textTree.nodesText_ += newNodesText;
+    textTree.sourceText_ = std::move(text);
+    textTree.keyNameTextStarts_.clear(); // Offsets beyond the source text moved with it.
+    textTree.RebuildNodeLinks();
+    textTree.childKeyIndices_.clear();
+
+    firstNodeIndex = firstIndex;
+    oldNodeCount = endIndex - firstIndex;
+    newNodeCount = static_cast<uint32_t>(newNodes.size());
+
+    return true;
+}
+
+
+bool TextTreeParser::ReadNodesInChunks(
+    __inout TextTree& textTree,
+    __inout std::u16string&& text,
+    array_ref<uint32_t const> chunkBegins,
+    array_ref<TextTreeParser* const> chunkParsers
+    )
+{
+    assert(chunkBegins.size() == chunkParsers.size());
+    if (!textTree.empty() || chunkBegins.empty())
+        return ReadNodes(/*inout*/ textTree, std::move(text));
+
+    textTree.sourceText_.swap(text);
+    text.clear();
+    const char16_t* sourceText = textTree.sourceText_.data();
+    const uint32_t textLength = static_cast<uint32_t>(textTree.sourceText_.size());
+    const uint32_t chunkCount = static_cast<uint32_t>(chunkBegins.size()) + 1;
+    std::vector<NodeChunk> chunks(chunkCount);
+
+    // Read the first chunk on this parser, under the root.
+    TextTree::Node rootNode = {};
+    rootNode.type = TextTree::Node::TypeRoot;
+    chunks[0].nodes.push_back(rootNode);
+    chunks[0].nodeTextBegins.push_back(0);
+    chunks[0].nodeKeyIds.push_back(uint32_t(TextTree::InvalidKeyId));
+    if (options_ & OptionsDecodeNumbers)
+    {
+        chunks[0].nodeNumbers.push_back({});
+    }
+
+    const uint32_t baseTreeLevel = 1;
+    Reset(sourceText, chunkBegins[0], options_);
+    treeLevel_ = baseTreeLevel;
+    ReadNodeChunk(textLength, /*inout*/ chunks[0]);
+
+    // The parents of the level it ended at are the last nodes read at each
+    // lower level, whose names are in the first chunk's text if decoded.
+    const uint32_t chunkLevel = treeLevel_;
+    std::vector<TextTree::Node> openNodes;
+    uint32_t openLevel = chunkLevel;
+    for (size_t i = chunks[0].nodes.size() - 1; i > 0 && openLevel > baseTreeLevel; --i)
+    {
+        if (chunks[0].nodes[i].level == openLevel - 1)
+        {
+            openNodes.push_back(chunks[0].nodes[i]);
+            --openLevel;
+        }
+    }
+    std::reverse(openNodes.begin(), openNodes.end());
+    const uint32_t openNodesTextLength = static_cast<uint32_t>(chunks[0].nodesText.size());
+
+    bool succeeded = GetTotalErrorCount() == 0 && openLevel == baseTreeLevel;
+    if (succeeded)
+    {
+        auto readChunk = [&](uint32_t chunkIndex)
+        {
+            TextTreeParser& parser = *chunkParsers[chunkIndex - 1];
+            NodeChunk& chunk = chunks[chunkIndex];
+            const uint32_t chunkEnd = (chunkIndex < chunkCount - 1) ? chunkBegins[chunkIndex] : textLength;
+
+            parser.Reset(sourceText, chunkEnd, options_);
+            parser.textIndex_ = chunkBegins[chunkIndex - 1];
+            parser.treeLevel_ = chunkLevel;
+            parser.ResumeDerived(openNodes);
+            chunk.nodesText = chunks[0].nodesText;
+            parser.ReadNodeChunk(textLength, /*inout*/ chunk);
+        };
+
+        // Read the last chunk on this thread while the others read theirs.
+        std::vector<std::future<void>> chunkReads;
+        for (uint32_t chunkIndex = 1; chunkIndex < chunkCount - 1; ++chunkIndex)
+        {
+            chunkReads.push_back(std::async(std::launch::async, readChunk, chunkIndex));
+        }
+        readChunk(chunkCount - 1);
+        for (auto& chunkRead : chunkReads)
+        {
+            chunkRead.get();
+        }
+
+        // Every chunk must end at the level it began, and the last back at the base.
+        for (uint32_t chunkIndex = 1; chunkIndex < chunkCount && succeeded; ++chunkIndex)
+        {
+            TextTreeParser const& parser = *chunkParsers[chunkIndex - 1];
+            const uint32_t chunkEndLevel = (chunkIndex < chunkCount - 1) ? chunkLevel : baseTreeLevel;
+            succeeded = parser.GetTotalErrorCount() == 0 && parser.treeLevel_ == chunkEndLevel;
+        }
+    }
+
+    if (!succeeded)
+    {
+        // Read it all again as one, which also reports any errors in order.
+        std::u16string existingText(std::move(textTree.sourceText_));
+        textTree.Clear(/*shouldReleaseMemory*/false);
+        return ReadNodes(/*inout*/ textTree, std::move(existingText));
+    }
+
+    // Concatenate the chunks, shifting decoded text offsets past the text
+    // of earlier chunks, and dropping the copied names of the open nodes.
+    auto& nodes = textTree.nodes_;
+    auto& nodeTextBegins = textTree.nodeTextBegins_;
+    auto& nodesText = textTree.nodesText_;
+    size_t nodeCount = 0;
+    for (auto const& chunk : chunks)
+    {
+        nodeCount += chunk.nodes.size();
+    }
+    nodes.reserve(nodeCount);
+    nodeTextBegins.reserve(nodeCount);
+    auto& nodeKeyIds = textTree.nodeKeyIds_;
+    nodeKeyIds.clear();
+    nodeKeyIds.reserve(nodeCount);
+    textTree.nodeNumbers_.clear();
+    if (options_ & OptionsDecodeNumbers)
+    {
+        textTree.nodeNumbers_.reserve(nodeCount);
+    }
+
+    // Each chunk's key ids are from its own parser, so map them onto the tree's.
+    std::vector<uint32_t> keyIdMap;
+    for (uint32_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+    {
+        NodeChunk& chunk = chunks[chunkIndex];
+        const uint32_t chunkTextOffset = (chunkIndex > 0) ? openNodesTextLength : 0;
+        const uint32_t textDelta = static_cast<uint32_t>(nodesText.size()) - chunkTextOffset;
+
+        auto const& chunkKeyNames = (chunkIndex > 0) ? chunkParsers[chunkIndex - 1]->keyNames_ : keyNames_;
+        keyIdMap.resize(chunkKeyNames.GetCount());
+        for (uint32_t keyId = 0, keyCount = chunkKeyNames.GetCount(); keyId < keyCount; ++keyId)
+        {
+            auto keyName = chunkKeyNames.GetName(keyId);
+            keyIdMap[keyId] = textTree.keyNames_.Intern(keyName.data(), static_cast<uint32_t>(keyName.size()));
+        }
+
+        for (TextTree::Node& node : chunk.nodes)
+        {
+            if (node.start >= textLength)
+                node.start += textDelta;
+        }
+        for (uint32_t keyId : chunk.nodeKeyIds)
+        {
+            nodeKeyIds.push_back((keyId != TextTree::InvalidKeyId) ? keyIdMap[keyId] : keyId);
+        }
+        nodes.insert(nodes.end(), chunk.nodes.begin(), chunk.nodes.end());
+        nodeTextBegins.insert(nodeTextBegins.end(), chunk.nodeTextBegins.begin(), chunk.nodeTextBegins.end());
+        textTree.nodeNumbers_.insert(textTree.nodeNumbers_.end(), chunk.nodeNumbers.begin(), chunk.nodeNumbers.end());
+        nodesText.append(chunk.nodesText, chunkTextOffset);
+    }
+
+    textTree.RebuildNodeLinks();
+    textTree.childKeyIndices_.clear();
+
+    // Leave this parser at the end as if it had read everything.
+    Reset(sourceText, textLength, options_);
+    textIndex_ = textLength;
+    treeLevel_ = baseTreeLevel;
+
+    return true;
+}
+
+
+void TextTreeParser::ReadNodeChunk(
+    uint32_t nodeTextBase,
+    __inout NodeChunk& chunk
+    )
+{
+    isReferencingText_ = true;
+    nodeTextBase_ = nodeTextBase;
+
+    const size_t expectedNodeCount = chunk.nodes.size() + (textLength_ - std::min(textIndex_, textLength_)) / EstimatedTextLengthPerNode;
+    chunk.nodes.reserve(expectedNodeCount);
+    chunk.nodeTextBegins.reserve(expectedNodeCount);
+    chunk.nodeKeyIds.reserve(expectedNodeCount);
+    if (options_ & OptionsDecodeNumbers)
+    {
+        chunk.nodeNumbers.reserve(expectedNodeCount);
+    }
+
+    TextTree::Node node = {};
+    while (ReadNode(/*out*/ node, /*inout*/ chunk.nodesText))
+    {
+        chunk.nodeKeyIds.push_back(InternKeyName(/*inout*/ keyNames_, node, chunk.nodesText));
+        chunk.nodes.push_back(node);
+        chunk.nodeTextBegins.push_back(nodeTextBegin_);
+        if (options_ & OptionsDecodeNumbers)
+        {
+            chunk.nodeNumbers.push_back(DecodeNodeNumber(node, chunk.nodesText));
+        }
+        if (node.start >= nodeTextBase_)
+        {
+            chunk.nodesText.push_back('\0');
+        }
+    }
+
+    isReferencingText_ = false;
+    nodeTextBase_ = 0;
+}
+
+
+uint32_t TextTreeParser::GetErrorCount()
+{
+    return static_cast<uint32_t>(errors_.size());
+}
+
+
+void TextTreeParser::GetErrorDetails(uint32_t errorIndex, __out uint32_t& errorTextIndex, __out const char16_t** errorMessage)
+{
+    errorTextIndex = errors_[errorIndex].errorTextIndex;
+    *errorMessage = errors_[errorIndex].errorMessage;
+}
+
+
+void TextTreeParser::SetErrorLimit(uint32_t maxErrorCount) noexcept
+{
+    errorLimit_ = maxErrorCount;
+}
+
+
+uint32_t TextTreeParser::GetTotalErrorCount() const noexcept
+{
+    return static_cast<uint32_t>(errors_.size()) + droppedErrorCount_;
+}
+
+
+void TextTreeParser::GetTextPositions(
+    array_ref<uint32_t const> textIndices,
+    OUT array_ref<TextPosition> positions
+    )
+{
+    assert(positions.size() >= textIndices.size());
+
+    if (lineBegins_.empty())
+    {
+        // Jump from line break to line break, treating CR LF as a single one.
+        lineBegins_.push_back(0);
+        uint32_t textIndex = 0;
+        while ((textIndex = FindFirstMatch<NewLineClassifier>(text_, textIndex, textLength_)) < textLength_)
+        {
+            if (text_[textIndex] == '\r' && textIndex + 1 < textLength_ && text_[textIndex + 1] == '\n')
+            {
+                ++textIndex;
+            }
+            lineBegins_.push_back(++textIndex);
+        }
+    }
+
+    // Search only beyond the previous line when ascending, which is typical.
+    auto const lineBeginsBegin = lineBegins_.begin();
+    auto const lineBeginsEnd = lineBegins_.end();
+    auto previousLine = lineBeginsBegin;
+
+    for (size_t i = 0, count = textIndices.size(); i < count; ++i)
+    {
+        const uint32_t textIndex = textIndices[i];
+        auto nextLine = (textIndex >= *previousLine)
+                      ? std::upper_bound(previousLine, lineBeginsEnd, textIndex)
+                      : std::upper_bound(lineBeginsBegin, previousLine, textIndex);
+        previousLine = nextLine - 1; // Never the first, which begins at 0.
+
+        positions[i].line = static_cast<uint32_t>(previousLine - lineBeginsBegin);
+        positions[i].column = textIndex - *previousLine;
+    }
+}
+
+
+void TextTreeParser::GetErrorPositions(OUT std::vector<TextPosition>& positions)
+{
+    std::vector<uint32_t> errorTextIndices;
+    errorTextIndices.reserve(errors_.size());
+    for (auto const& error : errors_)
+    {
+        errorTextIndices.push_back(error.errorTextIndex);
+    }
+
+    positions.resize(errors_.size());
+    GetTextPositions(errorTextIndices, OUT positions);
+}
+
+
+const char16_t* TextTreeParser::GetNodeText(
+    const TextTree::Node& node,
+    const std::u16string& nodeText
+    ) const noexcept
+{
+    if (node.start < nodeTextBase_)
+        return text_ + node.start; // Refers directly into the source.
+
+    return nodeText.data() + (node.start - nodeTextBase_);
+}
+
+
+uint32_t TextTreeParser::InternKeyName(
+    __inout TextTree::KeyNameTable& keyNames,
+    const TextTree::Node& node,
+    const std::u16string& nodeText
+    ) const
+{
+    if (node.GetGenericType() != TextTree::Node::TypeKey)
+        return TextTree::InvalidKeyId;
+
+    return keyNames.Intern(GetNodeText(node, nodeText), node.length);
+}
+
+
+TextTree::KeyNameTable const& TextTreeParser::GetKeyNames() const noexcept
+{
+    return keyNames_;
+}
+
+
+TextTree::NodeNumber TextTreeParser::DecodeNodeNumber(
+    const TextTree::Node& node,
+    const std::u16string& nodeText
+    ) const
+{
+    TextTree::NodeNumber number = {};
+    if (node.GetGenericType() == TextTree::Node::TypeValue)
+    {
+        DecodeNumber(GetNodeText(node, nodeText), node.length, OUT number);
+    }
+    return number;
+}
+
+
+uint32_t TextTreeParser::GetEventKeyId() const noexcept
+{
+    return eventKeyId_;
+}
+
+
+bool TextTreeParser::GetEventNumber(OUT TextTree::NodeNumber& number) const noexcept
+{
+    number = eventNumber_;
+    return number.flags != TextTree::NodeNumber::FlagsNone;
+}
+
+
+void TextTreeParser::ReportError(uint32_t errorTextIndex, const char16_t* errorMessage)
+{
+    if (errors_.size() >= errorLimit_)
+    {
+        ++droppedErrorCount_;
+        return;
+    }
+
+    Error error = {errorTextIndex, errorMessage};
+    errors_.push_back(error);
+}
+
+
+bool TextTreeParser::ReadNode(
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    return false;
+}
+
+
+uint32_t TextTreeParser::GetCurrentLevel()
+{
+    return treeLevel_;
+}
+
+
+bool TextTreeParser::IsAtEnd()
+{
+    return textIndex_ >= textLength_;
+}
+
+
+// Reads a single code unit, not full code point. This is okay because all the
+// important functional code points are in the basic plane.
+char32_t TextTreeParser::ReadCodeUnit()
+{
+    if (textIndex_ >= textLength_)
+        return '\0';
+
+    return text_[textIndex_++];
+}
+
+
+// Read, but do not advance.
+char32_t TextTreeParser::PeekCodeUnit()
+{
+    if (textIndex_ >= textLength_)
+        return '\0';
+
+    return text_[textIndex_];
+}
+
+
+// Read relative position, and do not advance.
+char32_t TextTreeParser::PeekCodeUnit(int32_t delta)
+{
+    uint32_t textIndex = textIndex_ + delta;
+    if (delta < 0 && textIndex > textIndex_ // underflow
+    ||  delta > 0 && textIndex < textIndex_ // overflow
+    ||  textIndex >= textLength_)           // out of bounds
+        return '\0';
+
+    return text_[textIndex];
+}
+
+
+void TextTreeParser::AdvanceCodeUnit()
+{
+    if (textIndex_ >= textLength_)
+        return;
+
+    ++textIndex_;
+}
+
+
+void TextTreeParser::RecedeCodeUnit()
+{
+    if (textIndex_ <= 0)
+        return;
+
+    --textIndex_;
+}
+
+
+// Split into leading and trailing surrogates.
+// From http://unicode.org/faq/utf_bom.html#35
+__if_not_exists(GetLeadingSurrogate)
+{
+    inline char16_t GetLeadingSurrogate(char32_t ch)
+    {
+        return char16_t(0xD800 + (ch >> 10) - (0x10000 >> 10));
+    }
+}
+
+
+__if_not_exists(GetTrailingSurrogate)
+{
+    inline char16_t GetTrailingSurrogate(char32_t ch)
+    {
+        return char16_t(0xDC00 + (ch & 0x3FF));
+    }
+}
+
+
+void TextTreeParser::AppendCharacter(
+    __inout std::u16string& nodeText,
+    char32_t ch
+    )
+{
+    if (ch > 0xFFFF) // If surrogate pair is beyond the basic multilingual plane, split it.
+    {
+        nodeText.push_back(GetLeadingSurrogate(ch));
+        nodeText.push_back(GetTrailingSurrogate(ch));
+    }
+    else
+    {
+        nodeText.push_back(char16_t(ch));
+    }
+}
+
+
+JsonexParser::JsonexParser(
+    __in_ecount(textLength) const char16_t* text,
+    uint32_t textLength,
+    Options options
+    )
+    :   Base(text, textLength, options)
+{
+    // Test string:
+    // Actions:foo, bar rod , cat{} {}, dog{bark} dog:{barkmore} bad:dog:{barklouder} (zig zag) "\b\\:" "a\b" , a:b:c  d:e:f{} ,, //hi
+}
+
+
+void JsonexParser::ResetDerived()
+{
+    nodeStack_.clear();
+}
+
+
+void JsonexParser::ResumeDerived(array_ref<TextTree::Node const> openNodes)
+{
+    nodeStack_.assign(openNodes.begin(), openNodes.end());
+}
+
+
+namespace
+{
+    bool JsonexIsValidWordCharacter(char32_t ch)
+    {
+        // This does not have the full Unicode database to follow the ECMA script identifier rules.
+        char32_t lowerCaseAscii = ch & ~0x20;
+        if (lowerCaseAscii >= 'A' && lowerCaseAscii <= 'Z')
+        {
+            return true;
+        }
+        else
+        {
+            // Digits and associated punctuation, or dollar sign and underscore.
+            switch (ch)
+            {
+            case '$': case '_': case '.': case '-': case '+':
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool JsonexIsControlCharacter(char32_t ch)
+    {
+        return (ch <= 0x001F);
+        // Note: exclude (ch >= 0x007F && ch <= 0x009F).
+    }
+
+    bool JsonexIsNewLineCharacter(char32_t ch)
+    {
+        return ch == '\r' || ch == '\n';
+    }
+
+    bool JsonexIsWordSeparator(char32_t ch)
+    {
+        switch (ch)
+        {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case ':':
+        case '=':
+        case ',':
+        case '{':
+        case '[':
+        case '(':
+        case '}':
+        case ']':
+        case ')':
+        case '\0':
+            return true;
+        }
+        return false;
+    }
+
+    TextTree::Node::Type JsonexGetNodeTypeFromCharacter(char32_t ch)
+    {
+        switch (ch)
+        {
+        case '{':
+        case '}':
+            return TextTree::Node::TypeObject;
+
+        case '[':
+        case ']':
+            return TextTree::Node::TypeArray;
+
+        case '(':
+        case ')':
+            return TextTree::Node::TypeFunction;
+
+        default:
+            // Assume value for anything else.
+            return TextTree::Node::TypeValue;
+        }
+    }
+}
+
+
+bool JsonexParser::SkipSpacesAndLineBreaks()
+{
+    const uint32_t startingTextIndex = textIndex_;
+    textIndex_ = FindFirstMatch<NonWhitespaceClassifier>(text_, textIndex_, textLength_);
+    return textIndex_ > startingTextIndex;
+}
+
+
+void JsonexParser::SkipComment()
+{
+    textIndex_ = FindFirstMatch<NewLineClassifier>(text_, textIndex_, textLength_);
+}
+
+
+void JsonexParser::SkipInvalidWordCharacters()
+{
+    for (; textIndex_ < textLength_; ++textIndex_)
+    {
+        if (JsonexIsWordSeparator(text_[textIndex_]))
+            return;
+    }
+}
+
+
+bool JsonexParser::ReadWord(
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    if (textIndex_ >= textLength_)
+        return false;
+
+    const uint32_t oldNodeTextSize = static_cast<uint32_t>(nodeText.size());
+    const uint32_t startingTextIndex = textIndex_;
+
+    // Plain code units are appended in bulk runs, or not at all if the node
+    // can just refer to the source text. Only escape sequences and merged
+    // comment lines require the word to be decoded into the node text.
+    uint32_t wordStartIndex = textIndex_;   // Start of the word in the source, excluding quotes or slashes.
+    uint32_t wordEndIndex = textLength_;
+    uint32_t runStartIndex = textIndex_;    // Start of plain code units not yet appended.
+    bool isDecoded = !isReferencingText_;
+
+    auto appendRun = [&](uint32_t runEndIndex)
+    {
+        nodeText.append(text_ + runStartIndex, runEndIndex - runStartIndex);
+        isDecoded = true;
+    };
+
+    char32_t ch = text_[textIndex_];
+    if (JsonexIsWordSeparator(ch))
+        return false;
+
+    if (ch == '/') // Start of comment.
+    {
+        ++textIndex_;
         ch = PeekCodeUnit();
         if (ch != '/')
         {
-            ReportError(textIndex_, u"Expect two forward slashes for a comment or for slashes to be used for named closure or in quoted strings.");
-            SkipInvalidWordCharacters(); // Skip the invalid word.
-            return false;
+            ReportError(textIndex_, u"Expect two forward slashes for a comment or for slashes to be used for named closure or in quoted strings.");
+            SkipInvalidWordCharacters(); // Skip the invalid word.
+            return false;
+        }
+
+        ++textIndex_;
+        wordStartIndex = runStartIndex = textIndex_;
+        for (; textIndex_ < textLength_; ++textIndex_)
+        {
+            // Jump to the next control character, which ends the comment line.
+            textIndex_ = FindFirstMatch<ControlCharacterClassifier>(text_, textIndex_, textLength_);
+            if (textIndex_ >= textLength_)
+                break;
+
+            ch = text_[textIndex_];
+            if (JsonexIsControlCharacter(ch)) // Control character found inside string which was not escaped.
+            {
+                // Only new lines are valid control characters.
+                if (!JsonexIsNewLineCharacter(ch))
+                {
+                    ReportError(textIndex_, u"Control characters found inside comment.");
+                    SkipComment(); // Skip the invalid word.
+                    return false;
+                }
+
+                // Merge any following comment lines, looking ahead to see if it starts with a comment.
+                const uint32_t lineEndIndex = textIndex_;
+                SkipSpacesAndLineBreaks();
+                ch = PeekCodeUnit(2);
+                if (PeekCodeUnit() != '/' || PeekCodeUnit(1) != '/' || ch == '\0')
+                {
+                    wordEndIndex = lineEndIndex;
+                    break; // End of comment
+                }
+                // Skip the two '/', and read the next meaningful character.
+                ReadCodeUnit(); ReadCodeUnit();
+                appendRun(lineEndIndex);
+                nodeText.append(u"\r\n");
+                runStartIndex = textIndex_;
+            }
+        }
+        node.type = TextTree::Node::TypeComment;
+    }
+    else if (ch == '"') // Word is quoted.
+    {
+        ++textIndex_;
+        wordStartIndex = runStartIndex = textIndex_;
+        while (textIndex_ < textLength_)
+        {
+            // Jump over plain contents to the closing quote, escape, or invalid control character.
+            textIndex_ = FindFirstMatch<QuotedStringClassifier>(text_, textIndex_, textLength_);
+            if (textIndex_ >= textLength_)
+                break;
+
+            ch = text_[textIndex_];
+            if (JsonexIsControlCharacter(ch)) // Control character found inside string which was not escaped.
+            {
+                ReportError(textIndex_, u"Control characters found inside string. They must be escaped.");
+                SkipInvalidWordCharacters(); // Skip the invalid word.
+                return false;
+            }
+
+            ++textIndex_;
+            if (ch == '"')
+            {
+                wordEndIndex = textIndex_ - 1;
+                break;
+            }
+            else if (ch == '\\' && !(options_ & OptionsNoEscapeSequence))
+            {
+                appendRun(textIndex_ - 1);
+                AppendCharacter(/*inout*/ nodeText, ReadCStyleEscapeCharacter());
+                runStartIndex = textIndex_;
+            }
+        }
+        node.type = TextTree::Node::TypeValue;
+    }
+    else // Unquoted identifier or value.
+    {
+        while (textIndex_ < textLength_)
+        {
+            // Jump over word characters to the first one that is not.
+            textIndex_ = FindFirstMatch<JsonexNonWordClassifier>(text_, textIndex_, textLength_);
+            if (textIndex_ >= textLength_)
+                break;
+
+            ch = text_[textIndex_];
+            if (!JsonexIsValidWordCharacter(ch))
+            {
+                if (JsonexIsWordSeparator(ch))
+                    break; // Stopped due to word separator, which is okay.
+
+                ReportError(textIndex_, u"Unsupported characters found inside identifier. Put the identifier in quotes.");
+                SkipInvalidWordCharacters(); // Skip the invalid word.
+                return false;
+            }
+
+            ++textIndex_;
+            if (ch == '\\' && !(options_ & OptionsNoEscapeSequence))
+            {
+                appendRun(textIndex_ - 1);
+                AppendCharacter(/*inout*/ nodeText, ReadCStyleEscapeCharacter());
+                runStartIndex = textIndex_;
+            }
+        }
+        if (textIndex_ == startingTextIndex)
+            return false;
+        wordEndIndex = textIndex_;
+        node.type = TextTree::Node::TypeValue;
+    }
+
+    if (isDecoded)
+    {
+        appendRun(wordEndIndex);
+        uint32_t newNodeTextSize = static_cast<uint32_t>(nodeText.size());
+        node.start  = nodeTextBase_ + oldNodeTextSize;
+        node.length = newNodeTextSize - oldNodeTextSize;
+    }
+    else // Refer directly to the source text.
+    {
+        node.start  = wordStartIndex;
+        node.length = wordEndIndex - wordStartIndex;
+    }
+
+    return true;
+}
+
+
+void JsonexParser::CheckClosingTag(
+    __in const TextTree::Node& node,
+    __in const std::u16string& nodeText
+    )
+{
+    // Check that the explicit closing tag matches, if present.
+    if (PeekCodeUnit() != '/')
+        return;
+
+    ++textIndex_;
+    if (PeekCodeUnit() == '/')
+    {
+        RecedeCodeUnit(); // Don't eat the comment.
+        return;
+    }
+
+    TextTree::Node closingNode;
+    std::u16string closingTag;
+    uint32_t textIndex = textIndex_;
+    if (!ReadWord(/*out*/ closingNode, /*inout*/ closingTag))
+    {
+        ReportError(textIndex, u"Expected explicit closing identifier.");
+        return;
+    }
+
+    if (node.start >= nodeTextBase_ ? nodeText.size() < node.start - nodeTextBase_ + node.length
+                                    : node.start + node.length > textLength_)
+        return; // The caller's node text does not contain the previous state to compare against.
+
+    auto openingText = GetNodeText(node, nodeText);
+    auto closingText = GetNodeText(closingNode, closingTag);
+    if (node.length != closingNode.length || !std::equal(openingText, openingText + node.length, closingText))
+    {
+        ReportError(textIndex, u"Closing identifier did not match opening identifier.");
+    }
+}
+
+
+void JsonexParser::ClearAttributeOnStack()
+{
+    // If an unresolved attribute is on the stack, pop it, and restore the level.
+    while (!nodeStack_.empty())
+    {
+        auto& back = nodeStack_.back();
+        if (back.type != TextTree::Node::TypeAttribute)
+            break;
+
+        treeLevel_ = back.level;
+        nodeStack_.pop_back();
+    }
+}
+
+
+bool JsonexParser::ReadNode(
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    for (;;)
+    {
+        if (textIndex_ >= textLength_)
+            return false;
+
+        SkipSpacesAndLineBreaks();
+
+        nodeTextBegin_ = textIndex_;
+        node.start = 0;
+        node.length = 0;
+        node.level = treeLevel_;
+        node.type = TextTree::Node::TypeNone;
+
+        bool haveWord = ReadWord(/*inout*/ node, /*inout*/ nodeText);
+
+        if (node.type == TextTree::Node::TypeComment)
+        {
+            break; // Return now for any comment, since the rest of the code below does not apply.
+        }
+
+        bool skippedAnySpaces = SkipSpacesAndLineBreaks();
+
+        // We read the word but do not know what type the node is yet.
+        // So read ahead one to decide that.
+        char32_t ch = ReadCodeUnit();
+        switch (ch)
+        {
+        case ':':
+        case '=':
+            if (!haveWord)
+            {
+                ReportError(textIndex_ - 1, u"Assignment must have a keyword identifier before it.");
+                break;
+            }
+
+            // Followed by either an opening bracket or a value.
+            SkipSpacesAndLineBreaks();
+            ch = ReadCodeUnit();
+            switch (ch)
+            {
+            case '{':
+            case '[':
+            case '(':
+                node.type = JsonexGetNodeTypeFromCharacter(ch);
+                break;
+
+            default:
+                RecedeCodeUnit(); // Leave this character for a later read.
+                node.type = TextTree::Node::TypeAttribute;
+            }
+            break;
+
+        case ',':
+            ClearAttributeOnStack();
+            break;
+
+        case '{':
+        case '[':
+        case '(':
+            if (haveWord && skippedAnySpaces)
+            {
+                RecedeCodeUnit(); // Leave this character for a later read.
+                ClearAttributeOnStack();
+            }
+            else
+            {
+                node.type = JsonexGetNodeTypeFromCharacter(ch);
+                haveWord = true; // Set it true even if empty name.
+            }
+            break;
+
+        case '}':
+        case ']':
+        case ')':
+            // Confirm the closing type matches the opening one.
+            if (nodeStack_.empty())
+            {
+                ReportError(textIndex_ - 1, u"Closing brace did not match any opening brace.");
+            }
+            else
+            {
+                ClearAttributeOnStack();
+                if (!nodeStack_.empty())
+                {
+                    auto& back = nodeStack_.back();
+                    treeLevel_ = back.level;
+                    if (back.type != JsonexGetNodeTypeFromCharacter(ch))
+                    {
+                        ReportError(textIndex_ - 1, u"Closing brace did not match opening brace type.");
+                    }
+                    CheckClosingTag(back, nodeText);
+                    nodeStack_.pop_back();
+                    ClearAttributeOnStack();
+                }
+            }
+            break;
+
+        case '\0':
+            ClearAttributeOnStack();
+            break;
+
+        default:
+            RecedeCodeUnit(); // Leave this character for a later read.
+            ClearAttributeOnStack();
+            break;
+        }
+
+        if (node.GetGenericType() == TextTree::Node::TypeKey)
+        {
+            nodeStack_.push_back(node);
+            ++treeLevel_;
+            break;
         }
 
-        ++textIndex_;
-        for (; textIndex_ < textLength_; ++textIndex_)
+        if (node.type != TextTree::Node::TypeNone)
         {
-            ch = text_[textIndex_];
-            if (JsonexIsControlCharacter(ch)) // Control character found inside string which was not escaped.
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+namespace
+{
+    const uint32_t JsonexParallelMinimumTextLength = 65536;
+    const uint32_t JsonexParallelMinimumChunkObjectCount = 64;
+
+    // Finds where each object begins in the array with the most objects,
+    // among those opened at most one level deep, skipping over strings and
+    // comments like JsonexParser::ReadWord. Only objects following a comma
+    // or bracket count, since one following a word would be named by it.
+    void FindJsonexArrayObjectBegins(
+        array_ref<char16_t const> text,
+        bool hasEscapeSequences,
+        OUT std::vector<uint32_t>& objectBegins
+        )
+    {
+        objectBegins.clear();
+
+        std::vector<uint32_t> arrayObjectBegins;
+        const uint32_t textLength = static_cast<uint32_t>(text.size());
+        const uint32_t noArrayDepth = UINT32_MAX;
+        uint32_t depth = 0;
+        uint32_t arrayDepth = noArrayDepth; // Depth inside the array being scanned.
+        char16_t previousCh = '['; // Last bracket or comma, or 'a' for any word or comment.
+
+        for (uint32_t i = 0; i < textLength; ++i)
+        {
+            char16_t ch = text[i];
+            switch (ch)
             {
-                // Only new lines are valid control characters.
-                if (!JsonexIsNewLineCharacter(ch))
+            case ' ': case '\t': case '\r': case '\n':
+                continue;
+
+            case '{':
+                if (depth == arrayDepth)
                 {
-                    ReportError(textIndex_, u"Control characters found inside comment.");
-                    SkipComment(); // Skip the invalid word.
-                    return false;
+                    switch (previousCh)
+                    {
+                    case ',':
+                    case '{': case '[': case '(':
+                    case '}': case ']': case ')':
+                        arrayObjectBegins.push_back(i);
+                    }
                 }
+                ++depth;
+                break;
 
-                // Merge any following comment lines, looking ahead to see if it starts with a comment.
-                SkipSpacesAndLineBreaks();
-                ch = PeekCodeUnit(2);
-                if (PeekCodeUnit() != '/' || PeekCodeUnit(1) != '/' || ch == '\0')
+            case '[':
+                if (depth <= 1 && arrayDepth == noArrayDepth)
                 {
-                    break; // End of comment
+                    arrayDepth = depth + 1;
+                    arrayObjectBegins.clear();
                 }
-                // Skip the two '/', and read the next meaningful character.
-                ReadCodeUnit(); ReadCodeUnit();
-                nodeText.append(u"\r\n");
+                ++depth;
+                break;
+
+            case '(':
+                ++depth;
+                break;
+
+            case '}': case ']': case ')':
+                if (depth > 0)
+                    --depth;
+                if (depth + 1 == arrayDepth)
+                {
+                    if (arrayObjectBegins.size() > objectBegins.size())
+                        objectBegins.swap(arrayObjectBegins);
+                    arrayDepth = noArrayDepth;
+                }
+                break;
+
+            case ',':
+                break;
+
+            case ':': case '=':
+                ch = 'a'; // An object after an assignment is the key's value.
+                break;
+
+            case '"':
+                for (++i; i < textLength && text[i] != '"'; ++i)
+                {
+                    if (text[i] == '\\' && hasEscapeSequences)
+                        ++i;
+                }
+                ch = 'a';
+                break;
+
+            case '/':
+                if (i + 1 < textLength && text[i + 1] == '/')
+                {
+                    while (i + 1 < textLength && text[i + 1] != '\r' && text[i + 1] != '\n')
+                    {
+                        ++i;
+                    }
+                    ch = 'a';
+                    break;
+                }
+                [[fallthrough]];
+
+            default:
+                // Skip the rest of the word.
+                while (i + 1 < textLength && !JsonexIsWordSeparator(text[i + 1]))
+                {
+                    ++i;
+                }
+                ch = 'a';
+                break;
             }
+            previousCh = ch;
+        }
+    }
+}
+
+
+bool JsonexParser::ReadNodesParallel(
+    __inout TextTree& textTree,
+    __inout std::u16string&& text,
+    uint32_t threadCount
+    )
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Split the objects evenly between the threads, so long as each thread
+    // has enough of them to be worth it. The first chunk, read before the
+    // others, is just the text before the first object.
+    std::vector<uint32_t> chunkBegins;
+    if (textTree.empty() && threadCount > 1 && text.size() >= JsonexParallelMinimumTextLength)
+    {
+        std::vector<uint32_t> objectBegins;
+        FindJsonexArrayObjectBegins(text, !(options_ & OptionsNoEscapeSequence), OUT objectBegins);
 
-            nodeText.push_back(char16_t(ch));
+        const size_t objectCount = objectBegins.size();
+        const size_t chunkCount = std::min(size_t(threadCount), objectCount / JsonexParallelMinimumChunkObjectCount);
+        for (size_t i = 0; i < chunkCount && chunkCount > 1; ++i)
+        {
+            chunkBegins.push_back(objectBegins[i * objectCount / chunkCount]);
         }
+    }
+
+    std::vector<JsonexParser> chunkParsers(chunkBegins.size());
+    std::vector<TextTreeParser*> chunkParserPointers;
+    for (auto& chunkParser : chunkParsers)
+    {
+        chunkParserPointers.push_back(&chunkParser);
+    }
+
+    return ReadNodesInChunks(/*inout*/ textTree, std::move(text), chunkBegins, chunkParserPointers);
+}
+
+
+namespace
+{
+    bool IniIsNewLineCharacter(char32_t ch)
+    {
+        return ch == '\r' || ch == '\n';
+    }
+}
+
+
+IniParser::IniParser()
+{
+    InitializeDerived();
+}
+
+
+IniParser::IniParser(
+    __in_ecount(textLength) const char16_t* text,
+    uint32_t textLength,
+    Options options
+    )
+    :   Base(text, textLength, options)
+{
+    InitializeDerived();
+}
+
+
+void IniParser::InitializeDerived()
+{
+    sectionLevel_ = 0;
+    baseLevel_ = InvalidLevel;
+}
+
+
+void IniParser::ResetDerived()
+{
+    InitializeDerived();
+}
+
+
+void IniParser::ResumeDerived(array_ref<TextTree::Node const> openNodes)
+{
+    bool isInSection = std::any_of(openNodes.begin(), openNodes.end(), [](auto const& node) {return node.type == TextTree::Node::TypeSection; });
+    sectionLevel_ = isInSection ? 1 : 0;
+    baseLevel_ = treeLevel_ - static_cast<uint32_t>(openNodes.size());
+}
+
+
+void IniParser::SkipSpaces()
+{
+    // Note this skips line breaks too, just like SkipSpacesAndLineBreaks.
+    textIndex_ = FindFirstMatch<NonWhitespaceClassifier>(text_, textIndex_, textLength_);
+}
+
+
+void IniParser::SkipSpacesAndLineBreaks()
+{
+    textIndex_ = FindFirstMatch<NonWhitespaceClassifier>(text_, textIndex_, textLength_);
+}
+
+
+bool IniParser::ReadWord(
+    TextTree::Node::Type expectedType,
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    if (textIndex_ >= textLength_)
+        return false;
+
+    const uint32_t oldNodeTextSize = static_cast<uint32_t>(nodeText.size());
+    const uint32_t startingTextIndex = textIndex_;
+
+    char32_t firstCh = text_[textIndex_];
+    assert(firstCh != '#' && firstCh != ';'); // The comment prefix should have been read already.
+
+    if (expectedType == TextTree::Node::TypeComment)
+    {
         node.type = TextTree::Node::TypeComment;
+        textIndex_ = FindFirstMatch<NewLineClassifier>(text_, textIndex_, textLength_);
+        nodeText.append(text_ + startingTextIndex, textIndex_ - startingTextIndex);
     }
-    else if (ch == '"') // Word is quoted.
+    else if (firstCh == '"') // Word is quoted.
     {
+        node.type = TextTree::Node::TypeValue;
+
         ++textIndex_;
         while (textIndex_ < textLength_)
         {
-            ch = text_[textIndex_];
-            if (JsonexIsControlCharacter(ch)) // Control character found inside string which was not escaped.
+            char16_t ch = text_[textIndex_];
+            if (IniIsNewLineCharacter(ch))
             {
-                ReportError(textIndex_, u"Control characters found inside string. They must be escaped.");
-                SkipInvalidWordCharacters(); // Skip the invalid word.
-                return false;
+                ReportError(textIndex_, u"Quoted word ends before closing quote '\"'.");
+                break;
             }
 
             ++textIndex_;
@@ -1554,22 +3907,21 @@ bool JsonexParser::ReadWord(
                 nodeText.push_back(char16_t(ch));
             }
         }
-        node.type = TextTree::Node::TypeValue;
     }
     else // Unquoted identifier or value.
     {
         while (textIndex_ < textLength_)
         {
-            ch = text_[textIndex_];
-            if (!JsonexIsValidWordCharacter(ch))
-            {
-                if (JsonexIsWordSeparator(ch))
-                    break; // Stopped due to word separator, which is okay.
+            char16_t ch = text_[textIndex_];
+            if (IniIsNewLineCharacter(ch))
+                break;
 
-                ReportError(textIndex_, u"Unsupported characters found inside identifier. Put the identifier in quotes.");
-                SkipInvalidWordCharacters(); // Skip the invalid word.
-                return false;
-            }
+            // Break if we reach the end of the section name or key name.
+            if (ch == ']' && expectedType == TextTree::Node::TypeSection)
+                break;
+
+            if ((ch == ':' || ch == '=') && expectedType == TextTree::Node::TypeAttribute)
+                break;
 
             ++textIndex_;
             if (ch == '\\' && !(options_ & OptionsNoEscapeSequence))
@@ -1581,223 +3933,422 @@ bool JsonexParser::ReadWord(
                 nodeText.push_back(char16_t(ch));
             }
         }
-        if (textIndex_ == startingTextIndex)
-            return false;
-        node.type = TextTree::Node::TypeValue;
+        // Remove any trailing whitespace.
+        while (nodeText.size() > oldNodeTextSize && nodeText.back() == ' ')
+        {
+            nodeText.pop_back();
+        }
     }
 
     uint32_t newNodeTextSize = static_cast<uint32_t>(nodeText.size());
-    node.start  = oldNodeTextSize;
+    node.type = expectedType;
+    node.start  = nodeTextBase_ + oldNodeTextSize;
     node.length = newNodeTextSize - oldNodeTextSize;
 
     return true;
 }
 
 
-void JsonexParser::CheckClosingTag(
-    __in const TextTree::Node& node,
-    __in const std::u16string& nodeText
+bool IniParser::ReadNode(
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
     )
 {
-    // Check that the explicit closing tag matches, if present.
-    if (PeekCodeUnit() != '/')
-        return;
-
-    ++textIndex_;
-    if (PeekCodeUnit() == '/')
+    // Levels are relative to where reading began (below the root of a tree).
+    if (baseLevel_ == InvalidLevel)
     {
-        RecedeCodeUnit(); // Don't eat the comment.
-        return;
+        baseLevel_ = treeLevel_;
     }
 
-    TextTree::Node closingNode;
-    std::u16string closingTag;
-    uint32_t textIndex = textIndex_;
-    if (!ReadWord(/*out*/ closingNode, /*inout*/ closingTag))
+    if (textIndex_ >= textLength_)
     {
-        ReportError(textIndex, u"Expected explicit closing identifier.");
-        return;
+        treeLevel_ = baseLevel_;
+        return false;
     }
 
-    if (nodeText.size() < node.start + node.length)
-        return; // The caller's node text does not contain the previous state to compare against.
+    node.start = 0;
+    node.length = 0;
+    node.level = treeLevel_;
+    node.type = TextTree::Node::TypeNone;
 
-    if (nodeText.compare(node.start, node.length, closingTag) != 0)
+    // We read the word but do not know what type the node is.
+    // So read ahead one to decide that.
+    SkipSpaces();
+    nodeTextBegin_ = textIndex_;
+    char32_t ch = PeekCodeUnit();
+    switch (ch)
     {
-        ReportError(textIndex, u"Closing identifier did not match opening identifier.");
+    case '[':
+        treeLevel_ = baseLevel_;
+        sectionLevel_ = 1; // Nested inside a section after this point - no longer in the global section.
+
+        AdvanceCodeUnit();
+        SkipSpaces();
+        ReadWord(TextTree::Node::TypeSection, /*inout*/ node, /*inout*/ nodeText);
+        SkipSpaces();
+        if (PeekCodeUnit() == ']')
+        {
+            AdvanceCodeUnit();
+        }
+        else
+        {
+            ReportError(textIndex_, u"Section name is missing closing bracket ']'.");
+        }
+        SkipSpacesAndLineBreaks();
+        break;
+
+    case '#':
+    case ';':
+        treeLevel_ = baseLevel_ + sectionLevel_;
+        AdvanceCodeUnit();
+        ReadWord(TextTree::Node::TypeComment, /*inout*/ node, /*inout*/ nodeText);
+        SkipSpacesAndLineBreaks();
+        break;
+
+    case ':':
+    case '=':
+        treeLevel_ = baseLevel_ + sectionLevel_ + 1;
+        AdvanceCodeUnit();
+        SkipSpaces();
+        ReadWord(TextTree::Node::TypeValue, /*inout*/ node, /*inout*/ nodeText);
+        SkipSpacesAndLineBreaks();
+        break;
+
+    case '\0':
+        treeLevel_ = baseLevel_;
+        return false;
+
+    default:
+        // Assume key.
+        treeLevel_ = baseLevel_ + sectionLevel_;
+        SkipSpaces();
+        ReadWord(TextTree::Node::TypeAttribute, /*inout*/ node, /*inout*/ nodeText);
+        SkipSpaces();
+        break;
     }
+
+    node.level = treeLevel_;
+
+    return true;
+}
+
+CsvParser::CsvParser()
+{
+    InitializeDerived();
 }
 
 
-void JsonexParser::ClearAttributeOnStack()
+CsvParser::CsvParser(
+    __in_ecount(textLength) const char16_t* text,
+    uint32_t textLength,
+    Options options
+    )
+    :   Base(text, textLength, options)
 {
-    // If an unresolved attribute is on the stack, pop it, and restore the level.
-    while (!nodeStack_.empty())
-    {
-        auto& back = nodeStack_.back();
-        if (back.type != TextTree::Node::TypeAttribute)
-            break;
+    InitializeDerived();
+}
 
-        treeLevel_ = back.level;
-        nodeStack_.pop_back();
-    }
+
+void CsvParser::InitializeDerived()
+{
+    state_ = StateHeader;
+    columnIndex_ = 0;
+    columns_.clear();
+    columnNamesText_.clear();
 }
 
 
-bool JsonexParser::ReadNode(
-    __out TextTree::Node& node,
-    __inout std::u16string& nodeText
-    )
+void CsvParser::ResetDerived()
 {
-    for (;;)
+    InitializeDerived();
+}
+
+
+void CsvParser::ResumeDerived(array_ref<TextTree::Node const> openNodes)
+{
+    // Reread the header of the new text, then resume at the row.
+    InitializeDerived();
+    const uint32_t resumeTextIndex = textIndex_;
+    textIndex_ = (textLength_ > 0 && text_[0] == 0xFEFF) ? 1 : 0;
+    ReadHeader();
+    textIndex_ = resumeTextIndex;
+    state_ = StateRowBegin;
+
+    // Nodes within a row depend on the fields before them.
+    if (!openNodes.empty())
     {
-        if (textIndex_ >= textLength_)
-            return false;
+        ReportError(textIndex_, u"Reading can only resume at the beginning of a row.");
+    }
+}
 
-        SkipSpacesAndLineBreaks();
 
-        node.start = 0;
-        node.length = 0;
-        node.level = treeLevel_;
-        node.type = TextTree::Node::TypeNone;
+uint32_t CsvParser::GetColumnCount() const noexcept
+{
+    return static_cast<uint32_t>(columns_.size());
+}
 
-        bool haveWord = ReadWord(/*inout*/ node, /*inout*/ nodeText);
 
-        if (node.type == TextTree::Node::TypeComment)
+array_ref<char16_t const> CsvParser::GetColumnName(uint32_t columnIndex) const noexcept
+{
+    if (columnIndex >= columns_.size())
+        return array_ref<char16_t const>();
+
+    auto const& column = columns_[columnIndex];
+    return array_ref<char16_t const>(columnNamesText_.data() + column.start, column.length);
+}
+
+
+void CsvParser::ReadHeader()
+{
+    // Read the names referring to the text where possible, so that each key
+    // node can too, rather than copying the name again for every row.
+    const bool wasReferencingText = isReferencingText_;
+    const uint32_t oldNodeTextBase = nodeTextBase_;
+    isReferencingText_ = true;
+    nodeTextBase_ = textLength_;
+
+    std::u16string decodedNames;
+    TextTree::Node node = {};
+    while (textIndex_ < textLength_)
+    {
+        ReadField(/*out*/ node, /*inout*/ decodedNames);
+
+        Column column;
+        column.start = static_cast<uint32_t>(columnNamesText_.size());
+        column.length = node.length;
+        if (node.start < textLength_)
         {
-            break; // Return now for any comment, since the rest of the code below does not apply.
+            column.sourceStart = node.start;
+            columnNamesText_.append(text_ + node.start, node.length);
+        }
+        else
+        {
+            column.sourceStart = InvalidSourceStart;
+            columnNamesText_.append(decodedNames, node.start - textLength_, node.length);
         }
+        columns_.push_back(column);
 
-        bool skippedAnySpaces = SkipSpacesAndLineBreaks();
+        if (PeekCodeUnit() != ',')
+            break;
 
-        // We read the word but do not know what type the node is yet.
-        // So read ahead one to decide that.
-        char32_t ch = ReadCodeUnit();
-        switch (ch)
-        {
-        case ':':
-        case '=':
-            if (!haveWord)
-            {
-                ReportError(textIndex_ - 1, u"Assignment must have a keyword identifier before it.");
-                break;
-            }
+        SkipFieldSeparator();
+    }
+    SkipLineBreak();
 
-            // Followed by either an opening bracket or a value.
-            SkipSpacesAndLineBreaks();
-            ch = ReadCodeUnit();
-            switch (ch)
-            {
-            case '{':
-            case '[':
-            case '(':
-                node.type = JsonexGetNodeTypeFromCharacter(ch);
-                break;
+    isReferencingText_ = wasReferencingText;
+    nodeTextBase_ = oldNodeTextBase;
+}
 
-            default:
-                RecedeCodeUnit(); // Leave this character for a later read.
-                node.type = TextTree::Node::TypeAttribute;
-            }
-            break;
 
-        case ',':
-            ClearAttributeOnStack();
-            break;
+void CsvParser::ReadField(
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    // Plain runs are appended in bulk, or not at all if the node can just
+    // refer to the source text. Only doubled quotes require decoding.
+    const uint32_t oldNodeTextSize = static_cast<uint32_t>(nodeText.size());
+    uint32_t fieldStartIndex = textIndex_;
+    uint32_t fieldEndIndex = textIndex_;
+    uint32_t runStartIndex = textIndex_;
+    bool isDecoded = !isReferencingText_;
 
-        case '{':
-        case '[':
-        case '(':
-            if (haveWord && skippedAnySpaces)
-            {
-                RecedeCodeUnit(); // Leave this character for a later read.
-                ClearAttributeOnStack();
-            }
-            else
+    if (PeekCodeUnit() == '"')
+    {
+        ++textIndex_;
+        fieldStartIndex = runStartIndex = textIndex_;
+        while (true)
+        {
+            // Jump over plain contents, including any line breaks, to the next quote.
+            textIndex_ = FindFirstMatch<CsvQuoteClassifier>(text_, textIndex_, textLength_);
+            if (textIndex_ >= textLength_)
             {
-                node.type = JsonexGetNodeTypeFromCharacter(ch);
-                haveWord = true; // Set it true even if empty name.
+                ReportError(fieldStartIndex - 1, u"Quoted field is missing its closing quote '\"'.");
+                fieldEndIndex = textLength_;
+                break;
             }
-            break;
 
-        case '}':
-        case ']':
-        case ')':
-            // Confirm the closing type matches the opening one.
-            if (nodeStack_.empty())
-            {
-                ReportError(textIndex_ - 1, u"Closing brace did not match any opening brace.");
-            }
-            else
+            ++textIndex_;
+            if (PeekCodeUnit() != '"')
             {
-                ClearAttributeOnStack();
-                if (!nodeStack_.empty())
-                {
-                    auto& back = nodeStack_.back();
-                    treeLevel_ = back.level;
-                    if (back.type != JsonexGetNodeTypeFromCharacter(ch))
-                    {
-                        ReportError(textIndex_ - 1, u"Closing brace did not match opening brace type.");
-                    }
-                    CheckClosingTag(back, nodeText);
-                    nodeStack_.pop_back();
-                    ClearAttributeOnStack();
-                }
+                fieldEndIndex = textIndex_ - 1;
+                break;
             }
-            break;
-
-        case '\0':
-            ClearAttributeOnStack();
-            break;
 
-        default:
-            RecedeCodeUnit(); // Leave this character for a later read.
-            ClearAttributeOnStack();
-            break;
+            // Keep one quote of the doubled pair.
+            nodeText.append(text_ + runStartIndex, textIndex_ - runStartIndex);
+            isDecoded = true;
+            runStartIndex = ++textIndex_;
         }
 
-        if (node.GetGenericType() == TextTree::Node::TypeKey)
+        // Nothing else may follow the closing quote.
+        const uint32_t fieldEndTextIndex = FindFirstMatch<CsvFieldEndClassifier>(text_, textIndex_, textLength_);
+        if (fieldEndTextIndex != textIndex_)
         {
-            nodeStack_.push_back(node);
-            ++treeLevel_;
-            break;
+            ReportError(textIndex_, u"Unexpected characters after the closing quote of a field.");
+            textIndex_ = fieldEndTextIndex;
         }
+    }
+    else
+    {
+        textIndex_ = FindFirstMatch<CsvFieldEndClassifier>(text_, textIndex_, textLength_);
+        fieldEndIndex = textIndex_;
+    }
 
-        if (node.type != TextTree::Node::TypeNone)
-        {
-            break;
-        }
+    node.type = TextTree::Node::TypeValue;
+    if (isDecoded)
+    {
+        nodeText.append(text_ + runStartIndex, fieldEndIndex - runStartIndex);
+        node.start  = nodeTextBase_ + oldNodeTextSize;
+        node.length = static_cast<uint32_t>(nodeText.size()) - oldNodeTextSize;
+    }
+    else // Refer directly to the source text.
+    {
+        node.start  = fieldStartIndex;
+        node.length = fieldEndIndex - fieldStartIndex;
+    }
+}
+
+
+bool CsvParser::IsAtEmptyField() const
+{
+    // Either nothing before the next separator, or just a pair of quotes.
+    uint32_t textIndex = textIndex_;
+    if (textIndex + 1 < textLength_ && text_[textIndex] == '"' && text_[textIndex + 1] == '"')
+    {
+        textIndex += 2;
     }
+    return textIndex >= textLength_ || CsvFieldEndClassifier::Match(text_[textIndex]);
+}
 
-    return true;
+
+void CsvParser::SkipFieldSeparator()
+{
+    if (PeekCodeUnit() == ',')
+    {
+        AdvanceCodeUnit();
+    }
 }
 
 
-namespace
+bool CsvParser::SkipLineBreak()
 {
-    bool IniIsWhitespace(char32_t ch)
+    // CR LF is a single line break.
+    char32_t ch = PeekCodeUnit();
+    if (ch != '\r' && ch != '\n')
+        return false;
+
+    AdvanceCodeUnit();
+    if (ch == '\r' && PeekCodeUnit() == '\n')
     {
-        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+        AdvanceCodeUnit();
     }
+    return true;
+}
 
-    bool IniIsWhitespaceOrLineBreak(char32_t ch)
+
+bool CsvParser::ReadNode(
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    if (state_ == StateHeader)
     {
-        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+        ReadHeader();
+        state_ = StateRowBegin;
     }
 
-    bool IniIsNewLineCharacter(char32_t ch)
+    node.start = 0;
+    node.length = 0;
+    node.level = treeLevel_;
+    node.type = TextTree::Node::TypeNone;
+
+    while (true)
     {
-        return ch == '\r' || ch == '\n';
+        switch (state_)
+        {
+        case StateRowBegin:
+            // Blank lines separate nothing.
+            while (SkipLineBreak())
+            {
+            }
+            if (textIndex_ >= textLength_)
+                return false;
+
+            nodeTextBegin_ = textIndex_;
+            node.type = TextTree::Node::TypeObject;
+            node.level = treeLevel_;
+            columnIndex_ = 0;
+            state_ = StateFieldName;
+            return true;
+
+        case StateFieldName:
+            if (textIndex_ >= textLength_ || SkipLineBreak())
+            {
+                state_ = StateRowBegin;
+                continue;
+            }
+
+            // Skip empty fields, and any the header has no name for (which is
+            // only an error if not empty, since trailing commas are common).
+            if (columnIndex_ >= columns_.size() || IsAtEmptyField())
+            {
+                if (!IsAtEmptyField())
+                {
+                    ReportError(textIndex_, u"Row has more fields than the header row.");
+                }
+                TextTree::Node ignoredNode;
+                std::u16string ignoredText;
+                ReadField(/*out*/ ignoredNode, /*inout*/ ignoredText);
+                SkipFieldSeparator();
+                ++columnIndex_;
+                continue;
+            }
+
+            nodeTextBegin_ = textIndex_;
+            {
+                // Name the attribute after the column, referring to the
+                // header text where possible.
+                auto const& column = columns_[columnIndex_];
+                node.type = TextTree::Node::TypeAttribute;
+                node.level = treeLevel_ + 1;
+                node.length = column.length;
+                if (isReferencingText_ && column.sourceStart != InvalidSourceStart)
+                {
+                    node.start = column.sourceStart;
+                }
+                else
+                {
+                    node.start = nodeTextBase_ + static_cast<uint32_t>(nodeText.size());
+                    nodeText.append(columnNamesText_, column.start, column.length);
+                }
+            }
+            state_ = StateFieldValue;
+            return true;
+
+        case StateFieldValue:
+            nodeTextBegin_ = textIndex_;
+            ReadField(/*out*/ node, /*inout*/ nodeText);
+            node.level = treeLevel_ + 2;
+            SkipFieldSeparator();
+            ++columnIndex_;
+            state_ = StateFieldName;
+            return true;
+
+        default:
+            return false;
+        }
     }
 }
 
 
-IniParser::IniParser()
+XmlParser::XmlParser()
 {
     InitializeDerived();
 }
 
 
-IniParser::IniParser(
+XmlParser::XmlParser(
     __in_ecount(textLength) const char16_t* text,
     uint32_t textLength,
     Options options
@@ -1808,209 +4359,506 @@ IniParser::IniParser(
 }
 
 
-void IniParser::InitializeDerived()
+void XmlParser::InitializeDerived()
 {
-    sectionLevel_ = 0;
+    state_ = StateContent;
+    openElements_.clear();
 }
 
 
-void IniParser::ResetDerived()
+void XmlParser::ResetDerived()
 {
     InitializeDerived();
 }
 
 
-void IniParser::SkipSpaces()
+void XmlParser::ResumeDerived(array_ref<TextTree::Node const> openNodes)
 {
-    while (textIndex_ < textLength_ && IniIsWhitespace(text_[textIndex_]))
+    // End tags are compared against the open elements' names where they are
+    // still in the text, and otherwise accepted.
+    InitializeDerived();
+    for (auto const& openNode : openNodes)
     {
-        ++textIndex_;
+        OpenElement openElement = {InvalidSourceStart, openNode.length};
+        if (openNode.start < textLength_ && openNode.length <= textLength_ - openNode.start)
+        {
+            openElement.nameStart = openNode.start;
+        }
+        openElements_.push_back(openElement);
+
+        // Nodes within a start tag depend on the tag before them.
+        if (openNode.type != TextTree::Node::TypeElement)
+        {
+            ReportError(textIndex_, u"Reading can only resume within element content.");
+        }
     }
 }
 
 
-void IniParser::SkipSpacesAndLineBreaks()
+uint32_t XmlParser::ReadName()
 {
-    while (textIndex_ < textLength_ && IniIsWhitespaceOrLineBreak(text_[textIndex_]))
-    {
-        ++textIndex_;
-    }
+    const uint32_t nameStartIndex = textIndex_;
+    textIndex_ = FindFirstMatch<XmlNameEndClassifier>(text_, textIndex_, textLength_);
+    return textIndex_ - nameStartIndex;
 }
 
 
-bool IniParser::ReadWord(
-    TextTree::Node::Type expectedType,
-    __out TextTree::Node& node,
+void XmlParser::SetNodeText(
+    uint32_t textIndex,
+    uint32_t length,
+    __inout TextTree::Node& node,
     __inout std::u16string& nodeText
     )
 {
-    if (textIndex_ >= textLength_)
+    if (isReferencingText_)
+    {
+        node.start = textIndex;
+    }
+    else
+    {
+        node.start = nodeTextBase_ + static_cast<uint32_t>(nodeText.size());
+        nodeText.append(text_ + textIndex, length);
+    }
+    node.length = length;
+}
+
+
+bool XmlParser::IsMatchingText(uint32_t textIndex, __in_z char16_t const* matchText) const
+{
+    for (; *matchText != '\0'; ++textIndex, ++matchText)
+    {
+        if (textIndex >= textLength_ || text_[textIndex] != *matchText)
+            return false;
+    }
+    return true;
+}
+
+
+bool XmlParser::ReadReference(__inout std::u16string& nodeText)
+{
+    // Reads a predefined entity or numeric character reference, like &amp;
+    // or &#38; or &#x26; leaving the text index unchanged if invalid.
+    const uint32_t maxReferenceLength = 10; // &#x10FFFF;
+    uint32_t endIndex = textIndex_ + 1;
+    while (endIndex < textLength_ && text_[endIndex] != ';' && endIndex - textIndex_ < maxReferenceLength)
+    {
+        ++endIndex;
+    }
+    if (endIndex >= textLength_ || text_[endIndex] != ';')
         return false;
 
-    const uint32_t oldNodeTextSize = static_cast<uint32_t>(nodeText.size());
-    const uint32_t startingTextIndex = textIndex_;
+    const char16_t* name = text_ + textIndex_ + 1;
+    const uint32_t nameLength = endIndex - textIndex_ - 1;
+    char32_t ch = 0;
 
-    char32_t firstCh = text_[textIndex_];
-    assert(firstCh != '#' && firstCh != ';'); // The comment prefix should have been read already.
+    if (nameLength >= 2 && name[0] == '#')
+    {
+        const bool isHex = (name[1] == 'x');
+        const uint32_t radix = isHex ? 16 : 10;
+        uint32_t i = isHex ? 2 : 1;
+        if (i >= nameLength)
+            return false;
 
-    if (expectedType == TextTree::Node::TypeComment)
+        for (; i < nameLength; ++i)
+        {
+            const char16_t digit = name[i];
+            uint32_t digitValue;
+            if (digit >= '0' && digit <= '9')
+                digitValue = digit - '0';
+            else if (isHex && digit >= 'a' && digit <= 'f')
+                digitValue = digit - 'a' + 10;
+            else if (isHex && digit >= 'A' && digit <= 'F')
+                digitValue = digit - 'A' + 10;
+            else
+                return false;
+
+            ch = ch * radix + digitValue;
+            if (ch > 0x10FFFF)
+                return false;
+        }
+        if (ch == 0)
+            return false;
+    }
+    else
     {
-        node.type = TextTree::Node::TypeComment;
-        for (; textIndex_ < textLength_; ++textIndex_)
+        static const struct { const char16_t* name; char16_t ch; } predefinedEntities[] =
         {
-            char16_t ch = text_[textIndex_];
-            if (IniIsNewLineCharacter(ch))
+            {u"lt", '<'},
+            {u"gt", '>'},
+            {u"amp", '&'},
+            {u"quot", '"'},
+            {u"apos", '\''},
+        };
+        for (auto const& entity : predefinedEntities)
+        {
+            if (std::char_traits<char16_t>::length(entity.name) == nameLength
+            &&  std::equal(name, name + nameLength, entity.name))
             {
+                ch = entity.ch;
                 break;
             }
-
-            nodeText.push_back(char16_t(ch));
         }
+        if (ch == 0)
+            return false;
     }
-    else if (firstCh == '"') // Word is quoted.
+
+    AppendCharacter(/*inout*/ nodeText, ch);
+    textIndex_ = endIndex + 1;
+    return true;
+}
+
+
+void XmlParser::ReadCharacterData(
+    char16_t closingQuote,
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    // Plain runs are appended in bulk, or not at all if the node can just
+    // refer to the source text. Only references require decoding.
+    const uint32_t oldNodeTextSize = static_cast<uint32_t>(nodeText.size());
+    const uint32_t dataStartIndex = textIndex_;
+    uint32_t runStartIndex = textIndex_;
+    bool isDecoded = !isReferencingText_;
+
+    while (true)
     {
-        node.type = TextTree::Node::TypeValue;
+        switch (closingQuote)
+        {
+        case '"':  textIndex_ = FindFirstMatch<XmlQuotedValueClassifier<'"'>>(text_, textIndex_, textLength_);  break;
+        case '\'': textIndex_ = FindFirstMatch<XmlQuotedValueClassifier<'\''>>(text_, textIndex_, textLength_); break;
+        default:   textIndex_ = FindFirstMatch<XmlTextClassifier>(text_, textIndex_, textLength_);               break;
+        }
 
-        ++textIndex_;
-        while (textIndex_ < textLength_)
+        if (textIndex_ >= textLength_)
         {
-            char16_t ch = text_[textIndex_];
-            if (IniIsNewLineCharacter(ch))
+            if (closingQuote != '\0')
             {
-                ReportError(textIndex_, u"Quoted word ends before closing quote '\"'.");
-                break;
+                ReportError(dataStartIndex - 1, u"Attribute value is missing its closing quote.");
             }
+            break;
+        }
 
-            ++textIndex_;
-            if (ch == '"')
-            {
-                break;
-            }
-            else if (ch == '\\' && !(options_ & OptionsNoEscapeSequence))
+        const char16_t ch = text_[textIndex_];
+        if (ch == '&')
+        {
+            nodeText.append(text_ + runStartIndex, textIndex_ - runStartIndex);
+            isDecoded = true;
+            runStartIndex = textIndex_;
+            if (ReadReference(/*inout*/ nodeText))
             {
-                AppendCharacter(/*inout*/ nodeText, ReadCStyleEscapeCharacter());
+                runStartIndex = textIndex_;
             }
             else
             {
-                nodeText.push_back(char16_t(ch));
+                ReportError(textIndex_, u"Unknown entity or invalid character reference.");
+                ++textIndex_; // Keep the ampersand as is.
             }
+            continue;
         }
+        if (ch == '<' && closingQuote != '\0')
+        {
+            ReportError(textIndex_, u"Attribute values cannot contain '<'.");
+            ++textIndex_;
+            continue;
+        }
+
+        break; // Closing quote or markup.
     }
-    else // Unquoted identifier or value.
+
+    const uint32_t dataEndIndex = textIndex_;
+    if (closingQuote != '\0' && textIndex_ < textLength_)
     {
-        while (textIndex_ < textLength_)
-        {
-            char16_t ch = text_[textIndex_];
-            if (IniIsNewLineCharacter(ch))
-                break;
+        ++textIndex_;
+    }
 
-            // Break if we reach the end of the section name or key name.
-            if (ch == ']' && expectedType == TextTree::Node::TypeSection)
-                break;
+    if (isDecoded)
+    {
+        nodeText.append(text_ + runStartIndex, dataEndIndex - runStartIndex);
+        node.start  = nodeTextBase_ + oldNodeTextSize;
+        node.length = static_cast<uint32_t>(nodeText.size()) - oldNodeTextSize;
+    }
+    else // Refer directly to the source text.
+    {
+        node.start  = dataStartIndex;
+        node.length = dataEndIndex - dataStartIndex;
+    }
+}
 
-            if ((ch == ':' || ch == '=') && expectedType == TextTree::Node::TypeAttribute)
-                break;
 
-            ++textIndex_;
-            if (ch == '\\' && !(options_ & OptionsNoEscapeSequence))
-            {
-                AppendCharacter(/*inout*/ nodeText, ReadCStyleEscapeCharacter());
-            }
-            else
-            {
-                nodeText.push_back(char16_t(ch));
-            }
+void XmlParser::ReadMarkup(
+    __out TextTree::Node& node,
+    __inout std::u16string& nodeText
+    )
+{
+    // Comments, CDATA sections, processing instructions, and DOCTYPE are
+    // read verbatim up to their terminator, found by its first character.
+    uint32_t contentStartIndex;
+    uint32_t contentEndIndex;
+    uint32_t terminatorLength;
+
+    auto findTerminator = [&](auto classifier, __in_z char16_t const* terminator, uint32_t searchStartIndex) -> uint32_t
+    {
+        terminatorLength = static_cast<uint32_t>(std::char_traits<char16_t>::length(terminator));
+        for (uint32_t i = searchStartIndex; ; ++i)
+        {
+            i = FindFirstMatch<decltype(classifier)>(text_, i, textLength_);
+            if (i >= textLength_ || IsMatchingText(i, terminator))
+                return i;
         }
-        // Remove any trailing whitespace.
-        while (nodeText.size() > startingTextIndex && nodeText.back() == ' ')
+    };
+
+    if (IsMatchingText(textIndex_, u"<!--"))
+    {
+        node.type = TextTree::Node::TypeComment;
+        contentStartIndex = textIndex_ + 4;
+        contentEndIndex = findTerminator(SingleCharacterClassifier<'-'>(), u"-->", contentStartIndex);
+    }
+    else if (IsMatchingText(textIndex_, u"<![CDATA["))
+    {
+        node.type = TextTree::Node::TypeData;
+        contentStartIndex = textIndex_ + 9;
+        contentEndIndex = findTerminator(SingleCharacterClassifier<']'>(), u"]]>", contentStartIndex);
+    }
+    else if (IsMatchingText(textIndex_, u"<?"))
+    {
+        // The XML declaration is just a processing instruction named xml.
+        contentStartIndex = textIndex_ + 2;
+        contentEndIndex = findTerminator(SingleCharacterClassifier<'?'>(), u"?>", contentStartIndex);
+        const bool isDeclaration = IsMatchingText(contentStartIndex, u"xml")
+                                && (contentStartIndex + 3 >= contentEndIndex || XmlNameEndClassifier::Match(text_[contentStartIndex + 3]));
+        node.type = isDeclaration ? TextTree::Node::TypeDeclaration : TextTree::Node::TypeDirective;
+    }
+    else // <!DOCTYPE ...>, whose internal subset may contain '>' within brackets.
+    {
+        node.type = TextTree::Node::TypeDirective;
+        contentStartIndex = textIndex_ + 2;
+        contentEndIndex = findTerminator(SingleCharacterClassifier<'>'>(), u">", contentStartIndex);
+        const uint32_t subsetStartIndex = FindFirstMatch<SingleCharacterClassifier<'['>>(text_, contentStartIndex, contentEndIndex);
+        if (subsetStartIndex < contentEndIndex)
         {
-            nodeText.pop_back();
+            const uint32_t subsetEndIndex = FindFirstMatch<SingleCharacterClassifier<']'>>(text_, subsetStartIndex, textLength_);
+            contentEndIndex = findTerminator(SingleCharacterClassifier<'>'>(), u">", subsetEndIndex);
         }
     }
 
-    uint32_t newNodeTextSize = static_cast<uint32_t>(nodeText.size());
-    node.type = expectedType;
-    node.start  = oldNodeTextSize;
-    node.length = newNodeTextSize - oldNodeTextSize;
+    if (contentEndIndex >= textLength_)
+    {
+        ReportError(textIndex_, u"Comment or other markup is missing its terminator.");
+        contentEndIndex = textLength_;
+        terminatorLength = 0;
+    }
 
-    return true;
+    SetNodeText(contentStartIndex, contentEndIndex - contentStartIndex, /*inout*/ node, /*inout*/ nodeText);
+    textIndex_ = contentEndIndex + terminatorLength;
 }
 
 
-bool IniParser::ReadNode(
+void XmlParser::ReadEndTag()
+{
+    const uint32_t tagIndex = textIndex_;
+    textIndex_ += 2; // </
+    const uint32_t nameStartIndex = textIndex_;
+    const uint32_t nameLength = ReadName();
+
+    textIndex_ = FindFirstMatch<NonWhitespaceClassifier>(text_, textIndex_, textLength_);
+    if (PeekCodeUnit() == '>')
+    {
+        AdvanceCodeUnit();
+    }
+    else
+    {
+        ReportError(textIndex_, u"End tag is missing its closing '>'.");
+    }
+
+    // Close the matching element, along with any left unclosed within it.
+    auto isMatchingElement = [&](OpenElement const& openElement)
+    {
+        return openElement.nameStart == InvalidSourceStart
+            || (openElement.nameLength == nameLength
+                && std::equal(text_ + nameStartIndex, text_ + nameStartIndex + nameLength, text_ + openElement.nameStart));
+    };
+    auto match = std::find_if(openElements_.rbegin(), openElements_.rend(), isMatchingElement);
+    if (match == openElements_.rend())
+    {
+        ReportError(tagIndex, u"End tag does not match any open element.");
+        return;
+    }
+    if (match != openElements_.rbegin())
+    {
+        ReportError(tagIndex, u"Element is missing its end tag.");
+    }
+
+    const uint32_t closedCount = static_cast<uint32_t>(match - openElements_.rbegin()) + 1;
+    openElements_.resize(openElements_.size() - closedCount);
+    treeLevel_ -= closedCount;
+}
+
+
+bool XmlParser::ReadNode(
     __out TextTree::Node& node,
     __inout std::u16string& nodeText
     )
 {
-    if (textIndex_ >= textLength_)
-        return false;
-
     node.start = 0;
     node.length = 0;
     node.level = treeLevel_;
     node.type = TextTree::Node::TypeNone;
 
-    // We read the word but do not know what type the node is.
-    // So read ahead one to decide that.
-    SkipSpaces();
-    char32_t ch = PeekCodeUnit();
-    switch (ch)
+    while (true)
     {
-    case '[':
-        treeLevel_ = 0;
-        sectionLevel_ = 1; // Nested inside a section after this point - no longer in the global section.
+        switch (state_)
+        {
+        case StateContent:
+            if (textIndex_ >= textLength_)
+            {
+                // Close any elements left open, naming the innermost one
+                // rather than reporting just the unbalanced levels.
+                if (!openElements_.empty())
+                {
+                    const uint32_t nameStart = openElements_.back().nameStart;
+                    ReportError((nameStart != InvalidSourceStart && nameStart > 0) ? nameStart - 1 : textIndex_, u"Element is missing its end tag.");
+                    treeLevel_ -= static_cast<uint32_t>(openElements_.size());
+                    openElements_.clear();
+                }
+                return false;
+            }
+
+            nodeTextBegin_ = textIndex_;
+            if (text_[textIndex_] != '<')
+            {
+                const uint32_t oldNodeTextSize = static_cast<uint32_t>(nodeText.size());
+                ReadCharacterData('\0', /*out*/ node, /*inout*/ nodeText);
+                node.type = TextTree::Node::TypeText;
+                node.level = treeLevel_;
+
+                if (options_ & OptionsDiscardPureWhitespace)
+                {
+                    const char16_t* text = GetNodeText(node, nodeText);
+                    if (FindFirstMatch<NonWhitespaceClassifier>(text, 0, node.length) >= node.length)
+                    {
+                        nodeText.resize(oldNodeTextSize);
+                        continue;
+                    }
+                }
+                return true;
+            }
+
+            switch (PeekCodeUnit(1))
+            {
+            case '/':
+                ReadEndTag();
+                continue;
+
+            case '!':
+            case '?':
+                ReadMarkup(/*out*/ node, /*inout*/ nodeText);
+                node.level = treeLevel_;
+                return true;
+            }
 
-        AdvanceCodeUnit();
-        SkipSpaces();
-        ReadWord(TextTree::Node::TypeSection, /*inout*/ node, /*inout*/ nodeText);
-        SkipSpaces();
-        if (PeekCodeUnit() == ']')
-        {
+            // Start tag, whose attributes are read as the first children.
             AdvanceCodeUnit();
-        }
-        else
-        {
-            ReportError(textIndex_, u"Section name is missing closing bracket ']'.");
-        }
-        SkipSpacesAndLineBreaks();
-        break;
+            {
+                const uint32_t nameStartIndex = textIndex_;
+                const uint32_t nameLength = ReadName();
+                if (nameLength == 0)
+                {
+                    ReportError(nameStartIndex, u"Expected an element name after '<'.");
+                    continue;
+                }
 
-    case '#':
-    case ';':
-        treeLevel_ = sectionLevel_;
-        AdvanceCodeUnit();
-        ReadWord(TextTree::Node::TypeComment, /*inout*/ node, /*inout*/ nodeText);
-        SkipSpacesAndLineBreaks();
-        break;
+                node.type = TextTree::Node::TypeElement;
+                node.level = treeLevel_;
+                SetNodeText(nameStartIndex, nameLength, /*inout*/ node, /*inout*/ nodeText);
+                openElements_.push_back({nameStartIndex, nameLength});
+                ++treeLevel_;
+                state_ = StateAttributeName;
+            }
+            return true;
 
-    case ':':
-    case '=':
-        treeLevel_ = sectionLevel_ + 1;
-        AdvanceCodeUnit();
-        SkipSpaces();
-        ReadWord(TextTree::Node::TypeValue, /*inout*/ node, /*inout*/ nodeText);
-        SkipSpacesAndLineBreaks();
-        break;
+        case StateAttributeName:
+            textIndex_ = FindFirstMatch<NonWhitespaceClassifier>(text_, textIndex_, textLength_);
+            if (textIndex_ >= textLength_)
+            {
+                ReportError(nodeTextBegin_, u"Start tag is missing its closing '>'.");
+                state_ = StateContent;
+                continue;
+            }
+            if (text_[textIndex_] == '>')
+            {
+                AdvanceCodeUnit();
+                state_ = StateContent;
+                continue;
+            }
+            if (IsMatchingText(textIndex_, u"/>"))
+            {
+                // Empty element, closed already.
+                textIndex_ += 2;
+                openElements_.pop_back();
+                --treeLevel_;
+                state_ = StateContent;
+                continue;
+            }
 
-    case '\0':
-        treeLevel_ = 0;
-        return false;
+            nodeTextBegin_ = textIndex_;
+            {
+                const uint32_t nameStartIndex = textIndex_;
+                const uint32_t nameLength = ReadName();
+                if (nameLength == 0)
+                {
+                    ReportError(nameStartIndex, u"Expected an attribute name or the end of the start tag.");
+                    AdvanceCodeUnit();
+                    continue;
+                }
 
-    default:
-        // Assume key.
-        treeLevel_ = sectionLevel_;
-        SkipSpaces();
-        ReadWord(TextTree::Node::TypeAttribute, /*inout*/ node, /*inout*/ nodeText);
-        SkipSpaces();
-        break;
-    }
+                node.type = TextTree::Node::TypeAttribute;
+                node.level = treeLevel_;
+                SetNodeText(nameStartIndex, nameLength, /*inout*/ node, /*inout*/ nodeText);
+                state_ = StateAttributeValue;
+            }
+            return true;
 
-    node.level = treeLevel_;
+        case StateAttributeValue:
+            state_ = StateAttributeName;
+            textIndex_ = FindFirstMatch<NonWhitespaceClassifier>(text_, textIndex_, textLength_);
+            if (PeekCodeUnit() != '=')
+            {
+                ReportError(textIndex_, u"Attribute is missing its '=' and quoted value.");
+                continue;
+            }
+            AdvanceCodeUnit();
+            textIndex_ = FindFirstMatch<NonWhitespaceClassifier>(text_, textIndex_, textLength_);
 
-    return true;
+            nodeTextBegin_ = textIndex_;
+            {
+                const char32_t quote = PeekCodeUnit();
+                if (quote == '"' || quote == '\'')
+                {
+                    AdvanceCodeUnit();
+                    ReadCharacterData(char16_t(quote), /*out*/ node, /*inout*/ nodeText);
+                }
+                else
+                {
+                    // Read an unquoted value up to the next space or tag end.
+                    ReportError(textIndex_, u"Attribute value must be quoted.");
+                    const uint32_t valueStartIndex = textIndex_;
+                    const uint32_t valueLength = ReadName();
+                    SetNodeText(valueStartIndex, valueLength, /*inout*/ node, /*inout*/ nodeText);
+                }
+            }
+            node.type = TextTree::Node::TypeString;
+            node.level = treeLevel_ + 1;
+            return true;
+
+        default:
+            return false;
+        }
+    }
 }
 
 
+
 TextTreeWriter::TextTreeWriter(Options options)
     :   options_(options)
 {
@@ -2058,6 +4906,112 @@ void TextTreeWriter::GetText(/*out*/ std::u16string& text) const
 }
 
 
+void TextTreeWriter::SetSink(Sink sink, uint32_t bufferSize)
+{
+    sink_ = std::move(sink);
+    sinkBufferSize_ = std::max(bufferSize, 4u); // Room for at least one code point.
+    sinkBuffer_.resize(sinkBufferSize_);
+}
+
+
+HRESULT TextTreeWriter::Flush()
+{
+    return FlushText(/*isFinal*/ true);
+}
+
+
+HRESULT TextTreeWriter::FlushIfFull()
+{
+    if (sink_ == nullptr || text_.size() < sinkBufferSize_)
+        return S_OK;
+
+    return FlushText(/*isFinal*/ false);
+}
+
+
+HRESULT TextTreeWriter::FlushText(bool isFinal)
+{
+    if (sink_ == nullptr)
+        return S_OK;
+
+    // Convert the text to UTF-8 in the fixed size buffer, sending it to the
+    // sink each time it fills. A trailing high surrogate waits for its low
+    // surrogate unless this is the end. Unpaired surrogates become U+FFFD.
+    uint8_t* const buffer = sinkBuffer_.data();
+    uint32_t bufferIndex = 0;
+    size_t textIndex = 0;
+    const size_t textLength = text_.size();
+
+    while (textIndex < textLength)
+    {
+        char32_t ch = text_[textIndex];
+        size_t codeUnitCount = 1;
+        if (ch >= 0xD800 && ch <= 0xDFFF)
+        {
+            if (ch <= 0xDBFF && textIndex + 1 >= textLength && !isFinal)
+                break; // Keep for the next flush.
+
+            char32_t lowSurrogate = (textIndex + 1 < textLength) ? text_[textIndex + 1] : 0;
+            if (ch <= 0xDBFF && lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF)
+            {
+                ch = 0x10000 + ((ch - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                codeUnitCount = 2;
+            }
+            else
+            {
+                ch = 0xFFFD;
+            }
+        }
+
+        if (bufferIndex + 4 > sinkBufferSize_)
+        {
+            IFR(sink_({buffer, bufferIndex}));
+            bufferIndex = 0;
+        }
+
+        if (ch < 0x80)
+        {
+            buffer[bufferIndex++] = uint8_t(ch);
+        }
+        else if (ch < 0x800)
+        {
+            buffer[bufferIndex++] = uint8_t(0xC0 | (ch >> 6));
+            buffer[bufferIndex++] = uint8_t(0x80 | (ch & 0x3F));
+        }
+        else if (ch < 0x10000)
+        {
+            buffer[bufferIndex++] = uint8_t(0xE0 | (ch >> 12));
+            buffer[bufferIndex++] = uint8_t(0x80 | ((ch >> 6) & 0x3F));
+            buffer[bufferIndex++] = uint8_t(0x80 | (ch & 0x3F));
+        }
+        else
+        {
+            buffer[bufferIndex++] = uint8_t(0xF0 | (ch >> 18));
+            buffer[bufferIndex++] = uint8_t(0x80 | ((ch >> 12) & 0x3F));
+            buffer[bufferIndex++] = uint8_t(0x80 | ((ch >> 6) & 0x3F));
+            buffer[bufferIndex++] = uint8_t(0x80 | (ch & 0x3F));
+        }
+        textIndex += codeUnitCount;
+    }
+
+    if (bufferIndex > 0)
+    {
+        IFR(sink_({buffer, bufferIndex}));
+    }
+
+    hasFlushedText_ |= (textIndex > 0);
+    text_.erase(0, textIndex); // Keeps the capacity for the following text.
+
+    return S_OK;
+}
+
+
+bool TextTreeWriter::HasWrittenText() const noexcept
+{
+    return hasFlushedText_ || !text_.empty();
+}
+
+
 uint32_t TextTreeWriter::GetTextLength(
     __in_ecount_opt(textLength) const char16_t* text,
     uint32_t textLength
@@ -2112,6 +5066,7 @@ HRESULT TextTreeWriter::WriteNodes(const TextTree& textTree)
             ++currentLevel;
             IFR(EnterNode());
         }
+        IFR(FlushIfFull());
 
         previousLevel = currentLevel;
     }
@@ -2220,7 +5175,7 @@ HRESULT JsonexWriter::WriteNode(
     }
     if (wantNewLine)
     {
-        if (!text_.empty()) // Write new line, but never start the text file with a leading return (would be a pointless blank line).
+        if (HasWrittenText()) // Write new line, but never start the text file with a leading return (would be a pointless blank line).
             text_.append(u"\r\n");
 
         WriteIndentation();
@@ -2650,7 +5605,7 @@ HRESULT XmlWriter::WriteNode(
                 wantNewLine = (nodeStack_[nodeLevel_ - 1].type != TextTree::Node::TypeAttribute);
             }
         }
-        if (wantNewLine && !text_.empty()) // Never start with a leading return.
+        if (wantNewLine && HasWrittenText()) // Never start with a leading return.
         {
             text_.append(u"\r\n");
             const size_t spacesToIndent = nodeLevel_ * spacesPerIndent_;
@@ -2677,14 +5632,28 @@ HRESULT XmlWriter::WriteNode(
         break;
 
     case TextTree::Node::TypeElement:
+        {
+            // Drop the names of elements already closed.
+            uint32_t elementNamesLength = 0;
+            for (size_t i = 0, ci = nodeStack_.size() - 1; i < ci; ++i)
+            {
+                auto const& openNode = nodeStack_[i];
+                if (openNode.type == TextTree::Node::TypeElement)
+                    elementNamesLength = openNode.start + openNode.length;
+            }
+            elementNames_.resize(elementNamesLength);
+
+            nodeStack_.back().start = elementNamesLength;
+            nodeStack_.back().length = textLength;
+            elementNames_.append(text, textLength);
+        }
         text_.push_back('<');
-        nodeStack_.back().start = static_cast<uint32_t>(text_.size());
-        nodeStack_.back().length = textLength;
         WriteStringInternal(text, textLength, type);
         isInsideOpeningTag_ = true;
         break;
 
     case TextTree::Node::TypeAttribute:
+        text_.push_back(' '); // Separate from the element name or previous attribute.
         WriteStringInternal(text, textLength, type);
         text_.push_back('=');
         break;
@@ -2789,7 +5758,7 @@ HRESULT XmlWriter::ExitNode()
             spaceBuffer_.assign(spacesToIndent, ' ');
             text_.append(spaceBuffer_);
             text_.append(u"</");
-            text_.append(&text_[node.start], node.length);
+            WriteStringInternal(&elementNames_[node.start], node.length, TextTree::Node::TypeElement);
             text_.append(u">");
         }
         break;
@@ -2888,6 +5857,422 @@ HRESULT XmlWriter::EndScope()
 }
 
 
+namespace
+{
+    struct ExpectedNode
+    {
+        TextTree::Node::Type type;
+        uint32_t level;
+        char16_t const* text;
+    };
+
+
+    // Whether the tree holds exactly the expected nodes after the root, in order.
+    bool HasNodes(TextTree const& nodes, array_ref<ExpectedNode const> expectedNodes)
+    {
+        if (nodes.GetNodeCount() != expectedNodes.size() + 1)
+            return false;
+
+        std::u16string text;
+        for (uint32_t i = 0; i < expectedNodes.size(); ++i)
+        {
+            auto const& node = nodes.GetNode(i + 1);
+            auto const& expectedNode = expectedNodes[i];
+            nodes.GetText(i + 1, OUT text);
+            if (node.type != expectedNode.type || node.level != expectedNode.level || text != expectedNode.text)
+                return false;
+        }
+        return true;
+    }
+
+
+    // Whether both trees hold the same nodes, with the same text, key names,
+    // and decoded numbers. The key ids themselves may differ unless required
+    // to match, since reparsing keeps the ids of names no longer used.
+    bool AreTreesEqual(TextTree const& tree1, TextTree const& tree2, bool shouldMatchKeyIds)
+    {
+        if (tree1.GetNodeCount() != tree2.GetNodeCount())
+            return false;
+
+        auto const& keyNames1 = tree1.GetKeyNames();
+        auto const& keyNames2 = tree2.GetKeyNames();
+        std::u16string text1, text2;
+        for (uint32_t nodeIndex = 0, nodeCount = tree1.GetNodeCount(); nodeIndex < nodeCount; ++nodeIndex)
+        {
+            auto const& node1 = tree1.GetNode(nodeIndex);
+            auto const& node2 = tree2.GetNode(nodeIndex);
+            tree1.GetText(nodeIndex, OUT text1);
+            tree2.GetText(nodeIndex, OUT text2);
+            if (node1.type != node2.type || node1.level != node2.level || text1 != text2)
+                return false;
+
+            const uint32_t keyId1 = tree1.GetKeyId(nodeIndex);
+            const uint32_t keyId2 = tree2.GetKeyId(nodeIndex);
+            if ((keyId1 == TextTree::InvalidKeyId) != (keyId2 == TextTree::InvalidKeyId)
+            ||  keyNames1.GetName(keyId1) != keyNames2.GetName(keyId2)
+            ||  (shouldMatchKeyIds && keyId1 != keyId2))
+                return false;
+
+            TextTree::NodeNumber number1, number2;
+            tree1.GetNodeNumber(nodeIndex, OUT number1);
+            tree2.GetNodeNumber(nodeIndex, OUT number2);
+            if (number1.flags != number2.flags
+            || ((number1.flags & TextTree::NodeNumber::FlagsInteger) && number1.integerValue != number2.integerValue)
+            || ((number1.flags & TextTree::NodeNumber::FlagsFloat) && number1.floatValue != number2.floatValue))
+                return false;
+        }
+
+        if (!shouldMatchKeyIds)
+            return true;
+
+        if (keyNames1.GetCount() != keyNames2.GetCount())
+            return false;
+
+        for (uint32_t keyId = 0, keyCount = keyNames1.GetCount(); keyId < keyCount; ++keyId)
+        {
+            if (keyNames1.GetName(keyId) != keyNames2.GetName(keyId))
+                return false;
+        }
+        return true;
+    }
+
+
+    void RunCsvTests()
+    {
+        // Quoted fields keep one quote of each doubled pair, and may contain
+        // separators and line breaks of either form.
+        {
+            std::u16string text = u"text,fontSize\r\n\"Say \"\"hi\"\"\",12\r\n\"two\r\nlines\",\"a,\nb\"\n";
+            TextTree nodes;
+            CsvParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 0);
+
+            auto row = nodes.BeginFirstChild();
+            assert(row[u"text"].GetSubvalue() == u"Say \"hi\"");
+            assert(row[u"fontSize"].GetSubvalue() == u"12");
+            ++row;
+            assert(row[u"text"].GetSubvalue() == u"two\r\nlines");
+            assert(row[u"fontSize"].GetSubvalue() == u"a,\nb");
+            ++row;
+            assert(row == nodes.end());
+        }
+
+        // A quote left open runs to the end of the text.
+        {
+            std::u16string text = u"text,fontSize\r\n\"open,12\r\n";
+            TextTree nodes;
+            CsvParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 1);
+
+            auto row = nodes.BeginFirstChild();
+            assert(row[u"text"].GetSubvalue() == u"open,12\r\n");
+            assert(!row[u"fontSize"].IsValid());
+        }
+
+        // Fields beyond the header are dropped, reporting only the nonempty ones.
+        {
+            std::u16string text = u"text,fontSize\r\na,1,extra\r\nb,2,\r\n";
+            TextTree nodes;
+            CsvParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 1);
+
+            auto row = nodes.BeginFirstChild();
+            assert(row[u"text"].GetSubvalue() == u"a");
+            assert(row[u"fontSize"].GetSubvalue() == u"1");
+            ++row;
+            assert(row[u"text"].GetSubvalue() == u"b");
+            assert(row[u"fontSize"].GetSubvalue() == u"2");
+            ++row;
+            assert(row == nodes.end());
+        }
+
+        // The byte order mark is not part of the first column name.
+        {
+            std::u16string text = u"\xFEFFtext,fontSize\r\nx,1\r\n";
+            TextTree nodes;
+            CsvParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 0);
+            assert(parser.GetColumnCount() == 2);
+            assert(parser.GetColumnName(0) == array_ref<char16_t const>(u"text", 4));
+
+            auto row = nodes.BeginFirstChild();
+            assert(row[u"text"].GetSubvalue() == u"x");
+            assert(row[u"fontSize"].GetSubvalue() == u"1");
+        }
+    }
+
+
+    void RunXmlTests()
+    {
+        using Node = TextTree::Node;
+
+        // Predefined entities and character references decode in both
+        // attribute values and text, including those beyond the BMP.
+        {
+            std::u16string text = u"<a t=\"&lt;&#65;&#x42;&amp;\">x&gt;y&#x1F600;</a>";
+            TextTree nodes;
+            XmlParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 0);
+
+            const ExpectedNode expectedNodes[] =
+            {
+                {Node::TypeElement,   1, u"a"},
+                {Node::TypeAttribute, 2, u"t"},
+                {Node::TypeString,    3, u"<AB&"},
+                {Node::TypeText,      2, u"x>y\xD83D\xDE00"},
+            };
+            assert(HasNodes(nodes, expectedNodes));
+        }
+
+        // References beyond Unicode or to undeclared entities are kept as is.
+        {
+            std::u16string text = u"<a>&#x110000;&bogus;</a>";
+            TextTree nodes;
+            XmlParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 2);
+
+            const ExpectedNode expectedNodes[] =
+            {
+                {Node::TypeElement, 1, u"a"},
+                {Node::TypeText,    2, u"&#x110000;&bogus;"},
+            };
+            assert(HasNodes(nodes, expectedNodes));
+        }
+
+        // Markup is read verbatim, even a '>' inside the DOCTYPE internal subset
+        // or entities inside CDATA.
+        {
+            std::u16string text = u"<!DOCTYPE a [<!ENTITY e \"v>\"><!ELEMENT a ANY>]><a><![CDATA[<b>&amp;]]><!-- c --></a>";
+            TextTree nodes;
+            XmlParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 0);
+
+            const ExpectedNode expectedNodes[] =
+            {
+                {Node::TypeDirective, 1, u"DOCTYPE a [<!ENTITY e \"v>\"><!ELEMENT a ANY>]"},
+                {Node::TypeElement,   1, u"a"},
+                {Node::TypeData,      2, u"<b>&amp;"},
+                {Node::TypeComment,   2, u" c "},
+            };
+            assert(HasNodes(nodes, expectedNodes));
+        }
+
+        // Self-closing elements have no content, and following elements are siblings.
+        {
+            std::u16string text = u"<a><b/><c x=\"1\"/></a>";
+            TextTree nodes;
+            XmlParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 0);
+
+            const ExpectedNode expectedNodes[] =
+            {
+                {Node::TypeElement,   1, u"a"},
+                {Node::TypeElement,   2, u"b"},
+                {Node::TypeElement,   2, u"c"},
+                {Node::TypeAttribute, 3, u"x"},
+                {Node::TypeString,    4, u"1"},
+            };
+            assert(HasNodes(nodes, expectedNodes));
+        }
+
+        // An end tag matching no open element is ignored, whereas one matching
+        // an outer element also closes those within it.
+        {
+            std::u16string text = u"<a><b></c></b><d/></a><e><f></e><g/>";
+            TextTree nodes;
+            XmlParser parser(text, TextTreeParser::OptionsDefault);
+            parser.ReadNodes(/*inout*/ nodes);
+            assert(parser.GetErrorCount() == 2);
+
+            const ExpectedNode expectedNodes[] =
+            {
+                {Node::TypeElement, 1, u"a"},
+                {Node::TypeElement, 2, u"b"},
+                {Node::TypeElement, 2, u"d"},
+                {Node::TypeElement, 1, u"e"},
+                {Node::TypeElement, 2, u"f"},
+                {Node::TypeElement, 1, u"g"},
+            };
+            assert(HasNodes(nodes, expectedNodes));
+        }
+    }
+
+
+    // Exposes reading in chunks split at chosen places.
+    class ChunkedJsonexParser : public JsonexParser
+    {
+    public:
+        using JsonexParser::JsonexParser;
+        using TextTreeParser::ReadNodesInChunks;
+    };
+
+
+    void RunChunkedReadTests()
+    {
+        // A settings file large enough to split, with comments, escapes,
+        // numbers, nested objects, and a key first seen late in the file.
+        std::u16string settingsText = u"{\r\n  \"content\": \"TextLayoutSamplerSettings\",\r\n  \"objects\":[\r\n";
+        for (uint32_t objectIndex = 0; objectIndex < 2000; ++objectIndex)
+        {
+            if (objectIndex % 7 == 0)
+            {
+                settingsText.append(u"    // Comment\r\n");
+            }
+            settingsText.append((objectIndex > 0) ? u"    ,{\"text\": \"Sample \\\"" : u"    {\"text\": \"Sample \\\"");
+            settingsText.push_back(char16_t('A' + objectIndex % 26));
+            settingsText.append(u"\\\" text\", \"font_size\": ");
+            settingsText.push_back(char16_t('1' + objectIndex % 9));
+            settingsText.append((objectIndex % 3 == 0) ? u".5" : u"");
+            settingsText.append(u", \"font_family\": \"Segoe UI\"");
+            if (objectIndex % 5 == 0)
+            {
+                settingsText.append(u", \"nested\": {\"level\": 1}");
+            }
+            if (objectIndex >= 1500)
+            {
+                settingsText.append(u", \"late_key\": \"x\"");
+            }
+            settingsText.append(u"}\r\n");
+        }
+        settingsText.append(u"  ]\r\n}\r\n");
+
+        auto readSequentially = [](std::u16string text, TextTreeParser::Options options, OUT TextTree& nodes) -> uint32_t
+        {
+            JsonexParser parser(nullptr, 0, options);
+            parser.ReadNodes(/*inout*/ nodes, std::move(text));
+            return parser.GetErrorCount();
+        };
+
+        // Reading across threads matches reading on one.
+        for (auto options : {TextTreeParser::OptionsDefault, TextTreeParser::OptionsDecodeNumbers})
+        {
+            TextTree expectedNodes;
+            assert(readSequentially(settingsText, options, OUT expectedNodes) == 0);
+
+            TextTree nodes;
+            JsonexParser parser(nullptr, 0, options);
+            parser.ReadNodesParallel(/*inout*/ nodes, std::u16string(settingsText), /*threadCount*/ 4);
+            assert(parser.GetErrorCount() == 0);
+            assert(AreTreesEqual(nodes, expectedNodes, /*shouldMatchKeyIds*/ true));
+        }
+
+        // Chunks given directly, both at object boundaries and where a chunk
+        // begins within a string, which falls back to reading it all as one.
+        const uint32_t firstObjectBegin = static_cast<uint32_t>(settingsText.find(u"{\"text\""));
+        const uint32_t middleObjectBegin = static_cast<uint32_t>(settingsText.find(u"{\"text\"", settingsText.size() / 2));
+        const uint32_t middleStringBegin = static_cast<uint32_t>(settingsText.find(u"Sample", settingsText.size() / 2));
+        const uint32_t chunkBeginsList[][2] =
+        {
+            {firstObjectBegin, middleObjectBegin},
+            {firstObjectBegin, middleStringBegin},
+        };
+        TextTree expectedNodes;
+        readSequentially(settingsText, TextTreeParser::OptionsDefault, OUT expectedNodes);
+        for (auto const& chunkBegins : chunkBeginsList)
+        {
+            JsonexParser chunkParsers[2];
+            TextTreeParser* const chunkParserPointers[2] = {&chunkParsers[0], &chunkParsers[1]};
+
+            TextTree nodes;
+            ChunkedJsonexParser parser(nullptr, 0, TextTreeParser::OptionsDefault);
+            parser.ReadNodesInChunks(/*inout*/ nodes, std::u16string(settingsText), chunkBegins, chunkParserPointers);
+            assert(parser.GetErrorCount() == 0);
+            assert(AreTreesEqual(nodes, expectedNodes, /*shouldMatchKeyIds*/ true));
+        }
+
+        // Text with errors is read again as one, reporting the same errors.
+        {
+            std::u16string brokenText = settingsText;
+            brokenText.insert(middleObjectBegin + 1, u"]");
+
+            TextTree expectedBrokenNodes;
+            const uint32_t expectedErrorCount = readSequentially(brokenText, TextTreeParser::OptionsDefault, OUT expectedBrokenNodes);
+            assert(expectedErrorCount > 0);
+
+            TextTree nodes;
+            JsonexParser parser(nullptr, 0, TextTreeParser::OptionsDefault);
+            parser.ReadNodesParallel(/*inout*/ nodes, std::move(brokenText), /*threadCount*/ 4);
+            assert(parser.GetErrorCount() == expectedErrorCount);
+            assert(AreTreesEqual(nodes, expectedBrokenNodes, /*shouldMatchKeyIds*/ true));
+        }
+    }
+
+
+    void RunReparseTests()
+    {
+        const std::u16string settingsText =
+            u"{\r\n  \"content\": \"TextLayoutSamplerSettings\",\r\n  \"objects\":[\r\n"
+            u"    {\"text\": \"One\", \"font_size\": 12},\r\n"
+            u"    {\"text\": \"Two \\\"quoted\\\"\", \"font_size\": 14.5, \"nested\": {\"level\": 1}},\r\n"
+            u"    {\"text\": \"Three\", \"font_family\": \"Segoe UI\"},\r\n"
+            u"    {\"text\": \"Four\"}\r\n"
+            u"  ]\r\n}\r\n";
+        const uint32_t objectLevel = 3; // Objects within the array.
+
+        struct Edit
+        {
+            char16_t const* oldText;
+            char16_t const* newText;
+            bool isIncremental; // Only the objects around the change are reread.
+        };
+        const Edit edits[] =
+        {
+            {u"14.5", u"16", true}, // Within one object.
+            {u"12},\r\n    {\"text\": \"Two", u"12, \"text\": \"Two", true}, // Across the boundary of two objects, merging them.
+            {u"\"Three\"", u"\"Three and a longer text\", \"font_size\": 9", true}, // Growing.
+            {u", \"nested\": {\"level\": 1}", u"", true}, // Shrinking.
+            {u"\r\n  ]", u"\r\n  ", false}, // Across the end of the array, so it is all read again.
+        };
+
+        // Reparsing gives the same tree as reading the edited text afresh.
+        for (auto const& edit : edits)
+        {
+            std::u16string editedText = settingsText;
+            editedText.replace(editedText.find(edit.oldText), std::char_traits<char16_t>::length(edit.oldText), edit.newText);
+
+            TextTree nodes;
+            JsonexParser parser(nullptr, 0, TextTreeParser::OptionsDecodeNumbers);
+            parser.ReadNodes(/*inout*/ nodes, std::u16string(settingsText));
+            assert(nodes.GetNode(4).level + 1 == objectLevel);
+
+            uint32_t firstNodeIndex, oldNodeCount, newNodeCount;
+            parser.ReparseNodes(/*inout*/ nodes, std::u16string(editedText), objectLevel, OUT firstNodeIndex, OUT oldNodeCount, OUT newNodeCount);
+            assert((firstNodeIndex > 0) == edit.isIncremental);
+
+            TextTree expectedNodes;
+            JsonexParser expectedParser(nullptr, 0, TextTreeParser::OptionsDecodeNumbers);
+            expectedParser.ReadNodes(/*inout*/ expectedNodes, std::move(editedText));
+            assert(parser.GetErrorCount() == expectedParser.GetErrorCount());
+            assert(AreTreesEqual(nodes, expectedNodes, /*shouldMatchKeyIds*/ false));
+        }
+
+        // Unchanged text leaves the tree as is.
+        {
+            TextTree nodes;
+            JsonexParser parser(nullptr, 0, TextTreeParser::OptionsDecodeNumbers);
+            parser.ReadNodes(/*inout*/ nodes, std::u16string(settingsText));
+
+            TextTree expectedNodes;
+            JsonexParser expectedParser(nullptr, 0, TextTreeParser::OptionsDecodeNumbers);
+            expectedParser.ReadNodes(/*inout*/ expectedNodes, std::u16string(settingsText));
+
+            uint32_t firstNodeIndex, oldNodeCount, newNodeCount;
+            parser.ReparseNodes(/*inout*/ nodes, std::u16string(settingsText), objectLevel, OUT firstNodeIndex, OUT oldNodeCount, OUT newNodeCount);
+            assert(oldNodeCount == 0 && newNodeCount == 0);
+            assert(AreTreesEqual(nodes, expectedNodes, /*shouldMatchKeyIds*/ true));
+        }
+    }
+}
+
+
 void RunTests()
 {
     const char16_t* testString = u"thistest=foo bar(stuff:boo cat[1 2]) singleitem singleitem2";
@@ -2931,4 +6316,9 @@ void RunTests()
     auto s2 = i.GetText();
     auto s3 = i.GetSubvalue();
     auto s4 = i.GetSubvalue(u"Hello", 5);
+
+    RunCsvTests();
+    RunXmlTests();
+    RunChunkedReadTests();
+    RunReparseTests();
 }
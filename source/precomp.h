@@ -79,9 +79,19 @@
 #include <string>
 #include <functional>
 #include <map>
+#include <unordered_map>
 #include <array>
 #include <clocale>
 #include <stdexcept>
+#include <bit>
+#include <thread>
+#include <future>
+#include <shared_mutex>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 //////////////////////////////
 // Windows Header Files: